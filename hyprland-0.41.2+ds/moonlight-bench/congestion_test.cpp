@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <control/congestion.hpp>
+#include <core/logger.hpp>
+#include <streaming/loss_simulator.hpp>
+
+namespace bench {
+
+using namespace std::chrono_literals;
+using clock = std::chrono::steady_clock;
+
+/* Same as the defaults the session is created with, see rtsp/commands.hpp */
+static constexpr int FPS = 60;
+static constexpr int BITRATE_KBPS = 20000;
+static constexpr int FEC_PERCENTAGE = 20;
+static constexpr int MIN_REQUIRED_FEC_PACKETS = 2;
+static constexpr int PACKET_SIZE = 1392;
+
+/* Moonlight reports the frames it lost every 50ms, and only while it's losing some */
+static constexpr auto LOSS_REPORT_INTERVAL = 50ms;
+static constexpr int RTT_MS = 20;
+
+/**
+ * The link keeps the same capacity until `until`, counted from the start of the simulation.
+ * The simulation runs on a fake clock so that the result doesn't depend on how fast the machine running it is.
+ */
+struct Phase {
+  clock::duration until;
+  long capacity_kbps;
+};
+
+struct Stats {
+  int frames = 0;
+  int lost_frames = 0;
+  int decisions = 0;
+};
+
+/**
+ * Encodes and sends frames at the rate decided by the controller through the simulated link, like the payloader
+ * does: a frame is lost when more packets are dropped than it has parity shards (see determine_split() in video.hpp).
+ */
+class Simulation {
+public:
+  Simulation() : controller(control::CongestionLimits{.min_bitrate_kbps = 2000,
+                                                      .max_bitrate_kbps = BITRATE_KBPS,
+                                                      .min_fec_percentage = FEC_PERCENTAGE,
+                                                      .max_fec_percentage = 50},
+                            BITRATE_KBPS,
+                            FEC_PERCENTAGE,
+                            FPS) {}
+
+  /**
+   * Streams until `phase.until`, the stats only cover the frames sent after `measure_from`
+   */
+  Stats run(const Phase &phase, clock::duration measure_from = {}) {
+    streaming::LossSimulator link(0, phase.capacity_kbps);
+    Stats stats;
+    for (; elapsed < phase.until; elapsed += std::chrono::microseconds(1000000 / FPS)) {
+      auto now = start + elapsed;
+
+      auto frame_bytes = bitrate_kbps * 1000 / 8 / FPS;
+      auto data_shards = std::max(1, (frame_bytes + PACKET_SIZE - 1) / PACKET_SIZE);
+      auto parity_shards = std::max((data_shards * fec_percentage + 99) / 100, MIN_REQUIRED_FEC_PACKETS);
+
+      auto dropped = 0;
+      for (int packet = 0; packet < data_shards + parity_shards; packet++) {
+        dropped += link.drop(PACKET_SIZE, now);
+      }
+      auto lost = dropped > parity_shards;
+      lost_since_report += lost;
+      if (elapsed >= measure_from) {
+        stats.frames++;
+        stats.lost_frames += lost;
+      }
+
+      if (now - last_report >= LOSS_REPORT_INTERVAL) {
+        controller.on_rtt(RTT_MS);
+        if (lost_since_report > 0) {
+          controller.on_loss_report(lost_since_report,
+                                    std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report).count());
+        }
+        lost_since_report = 0;
+        last_report = now;
+
+        if (auto decision = controller.update(now)) {
+          bitrate_kbps = decision->bitrate_kbps;
+          fec_percentage = decision->fec_percentage;
+          stats.decisions++;
+        }
+      }
+    }
+    return stats;
+  }
+
+  control::CongestionController controller;
+  int bitrate_kbps = BITRATE_KBPS;
+  int fec_percentage = FEC_PERCENTAGE;
+
+private:
+  clock::time_point start = clock::now();
+  clock::duration elapsed{};
+  clock::time_point last_report = start;
+  int lost_since_report = 0;
+};
+
+static bool check(bool condition, const char *what) {
+  fmt::print("  {} {}\n", condition ? "ok  " : "FAIL", what);
+  return condition;
+}
+
+/**
+ * The link comfortably fits the requested bitrate: nothing must change
+ */
+static bool clean_link() {
+  fmt::print("clean link\n");
+  Simulation sim;
+  auto stats = sim.run({.until = 30s, .capacity_kbps = 100000});
+  fmt::print("  frames lost {}/{}, {} kbps FEC {}%\n",
+             stats.lost_frames,
+             stats.frames,
+             sim.bitrate_kbps,
+             sim.fec_percentage);
+
+  auto ok = check(stats.lost_frames == 0, "no frame is lost");
+  ok &= check(stats.decisions == 0, "the bitrate and FEC are left alone");
+  return ok;
+}
+
+/**
+ * The link shrinks under the requested bitrate then recovers: the controller has to back off until frames stop being
+ * lost, then probe its way back up
+ */
+static bool capacity_drop() {
+  fmt::print("capacity drop\n");
+  constexpr long CONGESTED_KBPS = 8000;
+  Simulation sim;
+  sim.run({.until = 10s, .capacity_kbps = 100000});
+
+  auto congested = sim.run({.until = 40s, .capacity_kbps = CONGESTED_KBPS}, 25s);
+  fmt::print("  congested: frames lost {}/{}, {} kbps FEC {}%\n",
+             congested.lost_frames,
+             congested.frames,
+             sim.bitrate_kbps,
+             sim.fec_percentage);
+  auto ok = check(congested.lost_frames * 20 < congested.frames, "settles under 5% of lost frames");
+  ok &= check(sim.bitrate_kbps < CONGESTED_KBPS, "backs the bitrate off under the link capacity");
+
+  auto recovered = sim.run({.until = 90s, .capacity_kbps = 100000}, 80s);
+  fmt::print("  recovered: frames lost {}/{}, {} kbps FEC {}%\n",
+             recovered.lost_frames,
+             recovered.frames,
+             sim.bitrate_kbps,
+             sim.fec_percentage);
+  ok &= check(recovered.lost_frames == 0, "no frame is lost once the link is back");
+  ok &= check(sim.bitrate_kbps == BITRATE_KBPS, "goes back to the requested bitrate");
+  ok &= check(sim.fec_percentage == FEC_PERCENTAGE, "goes back to the requested FEC");
+  return ok;
+}
+
+} // namespace bench
+
+int main() {
+  logs::init(logs::warning);
+
+  auto ok = bench::clean_link();
+  ok &= bench::capacity_drop();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include "fake_client.hpp"
+#include <arpa/inet.h>
+#include <core/logger.hpp>
+#include <cstring>
+#include <gst-plugin/capture_timestamp.hpp>
+#include <gst-plugin/video.hpp>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace bench {
+
+using namespace gst_moonlight_video;
+
+/* Packets read with a single recvmmsg() call */
+constexpr int RECV_BATCH = 64;
+
+FakeClient::FakeClient(int payload_size, frame_fn on_frame)
+    : payload_size(payload_size), block_size(payload_size + (int)sizeof(VideoRTPHeaders) - MAX_RTP_HEADER_SIZE),
+      on_frame(std::move(on_frame)) {
+  sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    throw std::runtime_error(fmt::format("Unable to create the client socket: {}", strerror(errno)));
+  }
+
+  // A whole IDR at high bitrate has to fit, otherwise the kernel drops what we can't read fast enough
+  int rcvbuf = 16 * 1024 * 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_len = sizeof(addr);
+  if (bind(sock, (sockaddr *)&addr, sizeof(addr)) < 0 || getsockname(sock, (sockaddr *)&addr, &addr_len) < 0) {
+    close(sock);
+    throw std::runtime_error(fmt::format("Unable to bind the client socket: {}", strerror(errno)));
+  }
+  bound_port = ntohs(addr.sin_port);
+}
+
+FakeClient::~FakeClient() {
+  if (running) {
+    stop();
+  }
+  close(sock);
+}
+
+void FakeClient::start() {
+  running = true;
+  receiver = std::thread([this]() { run(); });
+}
+
+ClientStats FakeClient::stop() {
+  running = false;
+  if (receiver.joinable()) {
+    receiver.join();
+  }
+  stats.frames_dropped += pending.size();
+  pending.clear();
+  return stats;
+}
+
+void FakeClient::run() {
+  auto packet_size = payload_size + sizeof(VideoRTPHeaders);
+  std::vector<unsigned char> buffers(RECV_BATCH * packet_size);
+  std::array<iovec, RECV_BATCH> iovs;
+  std::array<mmsghdr, RECV_BATCH> msgs;
+
+  while (running) {
+    pollfd pfd = {.fd = sock, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, 50) <= 0) {
+      continue;
+    }
+
+    for (int i = 0; i < RECV_BATCH; i++) {
+      iovs[i] = {.iov_base = buffers.data() + i * packet_size, .iov_len = packet_size};
+      msgs[i] = {};
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    auto received = recvmmsg(sock, msgs.data(), RECV_BATCH, MSG_DONTWAIT, nullptr);
+    auto now = monotonic_now_ns();
+    for (int i = 0; i < received; i++) {
+      on_packet((unsigned char *)iovs[i].iov_base, msgs[i].msg_len, now);
+    }
+  }
+
+  rusage usage = {};
+  getrusage(RUSAGE_THREAD, &usage);
+  stats.cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1'000'000'000ull +
+                 (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1'000ull;
+}
+
+void FakeClient::on_packet(const unsigned char *data, std::size_t size, uint64_t now_ns) {
+  stats.packets_received++;
+  stats.bytes_received += size;
+
+  if (size <= sizeof(VideoRTPHeaders) || size > (std::size_t)block_size) {
+    stats.malformed_packets++;
+    return;
+  }
+
+  auto header = (const VideoRTPHeaders *)data;
+  uint32_t frame_index = header->packet.frameIndex;
+  if (frame_index < next_frame) {
+    stats.late_packets++;
+    return;
+  }
+
+  uint32_t fec_info = header->packet.fecInfo;
+  int shard_idx = (fec_info >> 12) & 0x3FF;
+  int data_shards = (fec_info >> 22) & 0x3FF;
+  int fec_percentage = (fec_info >> 4) & 0xFF;
+  int block_idx = (header->packet.multiFecBlocks >> 4) & 0x3;
+  int last_block = (header->packet.multiFecBlocks >> 6) & 0x3;
+  // Same as moonlight-common-c, the payloader bumps fec_percentage so that this gives back its parity shards
+  int parity_shards = (data_shards * fec_percentage + 99) / 100;
+
+  auto &frame = pending[frame_index];
+  auto &block = frame.blocks[block_idx];
+  if (frame.first_packet_ns == 0) {
+    frame.first_packet_ns = now_ns;
+    frame.last_block = last_block;
+  }
+  if (block.shards.empty()) {
+    block.data_shards = data_shards;
+    block.parity_shards = parity_shards;
+    block.shards.resize(data_shards + parity_shards);
+  }
+
+  if (data_shards == 0 || block.data_shards != data_shards || block_idx > frame.last_block ||
+      shard_idx >= (int)block.shards.size()) {
+    stats.malformed_packets++;
+    return;
+  }
+  if (!block.shards[shard_idx].empty() || block.received >= block.data_shards) {
+    return; // duplicated or not needed anymore
+  }
+
+  // Shorter packets (no padding) are zero extended, that's what the payloader encoded
+  block.shards[shard_idx].assign(block_size, 0);
+  std::memcpy(block.shards[shard_idx].data(), data, size);
+  block.received++;
+
+  if (block.received == block.data_shards && ++frame.complete_blocks == frame.last_block + 1) {
+    deliver(frame_index, frame, now_ns);
+  }
+}
+
+void FakeClient::deliver(uint32_t frame_index, PendingFrame &frame, uint64_t complete_ns) {
+  ReceivedFrame received = {.frame_index = frame_index,
+                            .key_frame = false,
+                            .payload = {},
+                            .first_packet_ns = frame.first_packet_ns,
+                            .complete_ns = complete_ns,
+                            .delivered_ns = 0,
+                            .recovered_shards = 0};
+
+  std::vector<unsigned char> stream;
+  int total_data_shards = 0;
+  for (int block_idx = 0; block_idx <= frame.last_block; block_idx++) {
+    auto &block = frame.blocks[block_idx];
+    int nr_shards = block.data_shards + block.parity_shards;
+
+    // Frames too big for FEC are sent with more than DATA_SHARDS_MAX data shards and no parity
+    std::vector<unsigned char *> shards(nr_shards);
+    std::vector<unsigned char> marks(nr_shards);
+    int missing = 0;
+    for (int shard_idx = 0; shard_idx < nr_shards; shard_idx++) {
+      marks[shard_idx] = block.shards[shard_idx].empty();
+      if (marks[shard_idx]) {
+        block.shards[shard_idx].assign(block_size, 0);
+        missing += shard_idx < block.data_shards;
+      }
+      shards[shard_idx] = block.shards[shard_idx].data();
+    }
+
+    if (missing > 0) {
+      auto decode_start = monotonic_now_ns();
+      auto rs = rs_cache.get(block.data_shards, block.parity_shards);
+      if (moonlight::fec::decode(rs.get(), shards.data(), marks.data(), nr_shards, block_size) != 0) {
+        logs::log(logs::warning, "[CLIENT] Unable to recover frame {} block {}", frame_index, block_idx);
+      }
+      stats.fec_decode_ns += monotonic_now_ns() - decode_start;
+      received.recovered_shards += missing;
+    }
+
+    // Only the payload columns are meaningful in a rebuilt shard, the headers are updated after encoding
+    for (int shard_idx = 0; shard_idx < block.data_shards; shard_idx++) {
+      stream.insert(stream.end(), shards[shard_idx] + sizeof(VideoRTPHeaders), shards[shard_idx] + block_size);
+    }
+    total_data_shards += block.data_shards;
+  }
+
+  // The last data shard is only partially used, the video short header tells how much of it
+  auto chunk_size = block_size - sizeof(VideoRTPHeaders);
+  auto video_header = (const VideoShortHeader *)stream.data();
+  auto total_size = (total_data_shards - 1) * chunk_size + video_header->last_payload_len;
+  if (video_header->header_type != 0x01 || total_size > stream.size() || total_size < sizeof(VideoShortHeader)) {
+    stats.frames_malformed++;
+  } else {
+    received.key_frame = video_header->frame_type == 0x02;
+    received.payload.assign(stream.begin() + sizeof(VideoShortHeader), stream.begin() + total_size);
+    received.delivered_ns = monotonic_now_ns();
+    stats.recovered_shards += received.recovered_shards;
+    on_frame(std::move(received));
+  }
+
+  // Anything older is never going to be shown
+  auto it = pending.begin();
+  while (it != pending.end() && it->first < frame_index) {
+    stats.frames_dropped++;
+    it = pending.erase(it);
+  }
+  pending.erase(frame_index);
+  next_frame = frame_index + 1;
+}
+
+} // namespace bench
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <moonlight/fec.hpp>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+/**
+ * A video frame as the client would hand it over to the decoder
+ */
+struct ReceivedFrame {
+  uint32_t frame_index; // frameIndex of the RTP packets, as set by the payloader
+  bool key_frame;
+  std::vector<unsigned char> payload; // encoded frame, without the video short header
+
+  /* CLOCK_MONOTONIC ns */
+  uint64_t first_packet_ns;
+  uint64_t complete_ns;  // enough shards received to rebuild all the blocks
+  uint64_t delivered_ns; // after FEC recovery and reassembly
+
+  int recovered_shards; // data shards that had to be rebuilt from parity
+};
+
+struct ClientStats {
+  uint64_t packets_received = 0;
+  uint64_t bytes_received = 0;
+  uint64_t late_packets = 0;      // for a frame that was already delivered or given up
+  uint64_t malformed_packets = 0; // too short or with inconsistent FEC info
+  uint64_t frames_dropped = 0;    // never got enough shards, or a newer frame completed first
+  uint64_t frames_malformed = 0;  // rebuilt but the video short header doesn't add up
+  uint64_t recovered_shards = 0;
+  uint64_t fec_decode_ns = 0;
+  uint64_t cpu_ns = 0; // user + system time of the receiving thread
+};
+
+/**
+ * A minimal Moonlight video receiver: it listens on a loopback UDP port and does what moonlight-common-c does
+ * with the packets coming out of `rtpmoonlightpay_video`:
+ *  - groups them by frameIndex and FEC block (multiFecBlocks)
+ *  - once a block has at least `data_shards` packets the missing data shards are rebuilt with nanors
+ *  - the data shards are concatenated back and the video short header stripped
+ *
+ * Frames are handed over in order to on_frame from the receiving thread; a frame that is still incomplete when a
+ * newer one completes is dropped, like a real client would do before asking for an IDR.
+ */
+class FakeClient {
+public:
+  using frame_fn = std::function<void(ReceivedFrame &&)>;
+
+  /**
+   * @param payload_size the `payload_size` the payloader has been configured with
+   */
+  FakeClient(int payload_size, frame_fn on_frame);
+  ~FakeClient();
+
+  FakeClient(const FakeClient &) = delete;
+  FakeClient &operator=(const FakeClient &) = delete;
+
+  /**
+   * @return the loopback port the client is listening on
+   */
+  [[nodiscard]] unsigned short port() const {
+    return bound_port;
+  }
+
+  void start();
+
+  /**
+   * Waits for the receiving thread to finish, frames that are still incomplete are counted as dropped
+   */
+  ClientStats stop();
+
+private:
+  struct PendingBlock {
+    int data_shards = 0;
+    int parity_shards = 0;
+    int received = 0;
+    std::vector<std::vector<unsigned char>> shards; // empty when not received (yet)
+  };
+
+  struct PendingFrame {
+    uint64_t first_packet_ns = 0;
+    int last_block = 0;
+    int complete_blocks = 0;
+    std::array<PendingBlock, 4> blocks;
+  };
+
+  void run();
+  void on_packet(const unsigned char *data, std::size_t size, uint64_t now_ns);
+  void deliver(uint32_t frame_index, PendingFrame &frame, uint64_t complete_ns);
+
+  int payload_size;
+  int block_size;
+  frame_fn on_frame;
+
+  int sock = -1;
+  unsigned short bound_port = 0;
+  std::atomic<bool> running = false;
+  std::thread receiver;
+
+  /* Only accessed from the receiving thread */
+  std::map<uint32_t, PendingFrame> pending;
+  uint32_t next_frame = 0; // frames before this one have been delivered or dropped
+  moonlight::fec::rs_cache rs_cache;
+  ClientStats stats;
+};
+
+} // namespace bench
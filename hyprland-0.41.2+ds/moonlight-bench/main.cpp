@@ -0,0 +1,588 @@
+#include "fake_client.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <chrono>
+#include <core/logger.hpp>
+#include <gst-plugin/HyprlandFrameSource.hpp>
+#include <gst-plugin/capture_timestamp.hpp>
+#include <gst-plugin/gstrtpmoonlightpay_video.hpp>
+#include <gst-plugin/video.hpp>
+#include <gst/app/gstappsink.h>
+#include <gst/gst.h>
+#include <gst/video/gstvideometa.h>
+#include <moonlight/fec.hpp>
+#include <mutex>
+#include <optional>
+#include <streaming/udp_sink.hpp>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+
+using boost::asio::ip::udp;
+
+/*
+ * Scope: from the rendered frame to the client. A scripted workload is handed to the real capture source
+ * (hyprlandframesrc: latest-wins mailbox, capture timestamp driven PTS, damage ROI) the way the compositor does on
+ * each vblank, then goes through the encoder, the real rtpmoonlightpay_video payloader and the same UDPSink the video
+ * streams use.
+ * Not covered: the compositor itself (rendering, damage scheduling, the keep-alive repeats) and the DMA-BUF import,
+ * frames are rendered on the CPU and pushed as system memory. Those need Hyprland on the wlroots headless backend
+ * (WLR_BACKENDS=headless) streaming to a real Moonlight client.
+ */
+
+struct Options {
+  int width = 1920;
+  int height = 1080;
+  int fps = 60;
+  int duration = 10; // seconds, after warmup
+  int warmup = 1;    // seconds excluded from the report
+  Workload::Kind workload = Workload::Kind::video;
+  std::string workload_name = "video";
+  int bitrate = 20000; // kbps
+  int payload_size = 1392;
+  int fec_percentage = 20;
+  double loss_percentage = 0;
+  long capacity_kbps = 0;
+  std::optional<std::string> encoder;
+  bool verbose = false;
+};
+
+static void print_usage() {
+  fmt::print(R"(Usage: moonlight-bench [options]
+
+Streams a scripted desktop through rtpmoonlightpay_video and Wolf's UDP sink to an in-process Moonlight client
+over loopback UDP and reports the latency of each stage, the packet rate and the CPU time spent per frame.
+Frames are rendered on the CPU and pushed into hyprlandframesrc like the compositor does on each vblank, the
+compositor itself (damage scheduling, keep-alive repeats, DMA-BUF import) is not part of it.
+
+  --width <px>          (default 1920)
+  --height <px>         (default 1080)
+  --fps <n>             (default 60)
+  --duration <s>        measured seconds (default 10)
+  --warmup <s>          seconds streamed before measuring (default 1)
+  --workload <name>     idle, cursor, scroll or video (default video)
+  --bitrate <kbps>      (default 20000)
+  --payload-size <n>    RTP payload size, as negotiated by Moonlight (default 1392)
+  --fec <percentage>    (default 20)
+  --loss <percentage>   randomly drop this share of the packets before they reach the socket (default 0)
+  --capacity <kbps>     tail-drop packets above this link capacity (default unlimited)
+  --encoder <pipeline>  GStreamer encoder fragment, {{bitrate}} is replaced (default x264enc as in config.toml)
+  --verbose             log the pipeline and payloader debug messages
+)");
+}
+
+static std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      return std::nullopt;
+    }
+    if (arg == "--verbose") {
+      opts.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      logs::log(logs::error, "Missing value for {}", arg);
+      return std::nullopt;
+    }
+
+    std::string value = argv[++i];
+    try {
+      if (arg == "--width") {
+        opts.width = std::stoi(value);
+      } else if (arg == "--height") {
+        opts.height = std::stoi(value);
+      } else if (arg == "--fps") {
+        opts.fps = std::stoi(value);
+      } else if (arg == "--duration") {
+        opts.duration = std::stoi(value);
+      } else if (arg == "--warmup") {
+        opts.warmup = std::stoi(value);
+      } else if (arg == "--workload") {
+        auto kind = Workload::parse(value);
+        if (!kind) {
+          logs::log(logs::error, "Unknown workload {}", value);
+          return std::nullopt;
+        }
+        opts.workload = *kind;
+        opts.workload_name = value;
+      } else if (arg == "--bitrate") {
+        opts.bitrate = std::stoi(value);
+      } else if (arg == "--payload-size") {
+        opts.payload_size = std::stoi(value);
+      } else if (arg == "--fec") {
+        opts.fec_percentage = std::stoi(value);
+      } else if (arg == "--loss") {
+        opts.loss_percentage = std::stod(value);
+      } else if (arg == "--capacity") {
+        opts.capacity_kbps = std::stol(value);
+      } else if (arg == "--encoder") {
+        opts.encoder = value;
+      } else {
+        logs::log(logs::error, "Unknown option {}", arg);
+        return std::nullopt;
+      }
+    } catch (const std::exception &) {
+      logs::log(logs::error, "Invalid value for {}: {}", arg, value);
+      return std::nullopt;
+    }
+  }
+
+  if (opts.width <= 0 || opts.height <= 0 || opts.fps <= 0 || opts.duration <= 0 || opts.warmup < 0 ||
+      opts.payload_size <= MAX_RTP_HEADER_SIZE + (int)sizeof(gst_moonlight_video::VideoShortHeader)) {
+    logs::log(logs::error, "Invalid stream settings");
+    return std::nullopt;
+  }
+  return opts;
+}
+
+/**
+ * FNV-1a, enough to tell whether the client rebuilt exactly what the encoder produced
+ */
+static uint64_t hash_bytes(const unsigned char *data, std::size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/**
+ * What happened to a single workload frame on the server side, CLOCK_MONOTONIC ns
+ */
+struct FrameRecord {
+  uint64_t capture_ns = 0;
+  uint64_t encoded_ns = 0;   // reached the payloader
+  uint64_t payloaded_ns = 0; // RTP packets handed to the sink
+  uint64_t sent_ns = 0;      // the last packet left the socket
+  std::size_t encoded_size = 0;
+  uint64_t encoded_hash = 0;
+  bool delivered = false;
+};
+
+/**
+ * Latency samples of a single stage, in ns
+ */
+struct Samples {
+  std::vector<uint64_t> values;
+
+  void add(uint64_t from, uint64_t to) {
+    values.push_back(to > from ? to - from : 0);
+  }
+
+  void print(const char *name) {
+    if (values.empty()) {
+      fmt::print("  {:<10} {:>9}\n", name, "-");
+      return;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+      return values[std::min(values.size() - 1, (std::size_t)(p * values.size()))] / 1'000'000.0;
+    };
+    fmt::print("  {:<10} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}\n",
+               name,
+               percentile(0.50),
+               percentile(0.90),
+               percentile(0.99),
+               values.back() / 1'000'000.0);
+  }
+};
+
+struct BenchState {
+  Options opts;
+  std::size_t warmup_frames;
+
+  std::mutex lock;
+  std::vector<FrameRecord> frames; // indexed by workload frame number, sized upfront
+  /* hyprlandframesrc rewrites PTS from the capture time, frames are told apart by their capture timestamp until the
+   * encoder, by the PTS it kept after that */
+  std::unordered_map<uint64_t, std::size_t> capture_frames;  // capture_ns -> workload frame number
+  std::unordered_map<GstClockTime, std::size_t> pts_frames; // encoded PTS -> workload frame number
+  std::unordered_map<uint32_t, std::size_t> rtp_frames;     // payloader frameIndex -> workload frame number
+
+  /* The same sink Wolf sends the video with, only used from the appsink streaming thread */
+  streaming::custom_sink::UDPSink udp_sink;
+
+  /* Results, protected by lock */
+  uint64_t packets_sent = 0; // handed to the sink, including the ones the simulated link dropped
+  uint64_t bytes_sent = 0;
+  uint64_t frames_verified = 0;
+  uint64_t frames_corrupt = 0;
+  uint64_t key_frames = 0;
+  Samples encode, packetize, send, transmit, recover, total;
+};
+
+/**
+ * @return the workload frame number, or frames.size() for a buffer that can't be matched; state.lock must be held
+ */
+static std::size_t frame_number(const BenchState &state,
+                                const std::unordered_map<uint64_t, std::size_t> &frames,
+                                uint64_t key) {
+  auto frame = frames.find(key);
+  return frame != frames.end() ? frame->second : state.frames.size();
+}
+
+/**
+ * Probe on the payloader sink pad: the encoded frame, before it's split into RTP packets
+ */
+static GstPadProbeReturn on_encoded(GstPad *, GstPadProbeInfo *info, gpointer user_data) {
+  auto state = (BenchState *)user_data;
+  auto buf = GST_PAD_PROBE_INFO_BUFFER(info);
+  auto now = monotonic_now_ns();
+
+  GstMapInfo map;
+  gst_buffer_map(buf, &map, GST_MAP_READ);
+  auto hash = hash_bytes(map.data, map.size);
+  auto size = map.size;
+  gst_buffer_unmap(buf, &map);
+
+  std::lock_guard guard(state->lock);
+  auto nr = frame_number(*state, state->capture_frames, gst_buffer_get_capture_timestamp(buf));
+  if (nr < state->frames.size()) {
+    state->pts_frames[GST_BUFFER_PTS(buf)] = nr;
+    state->frames[nr].encoded_ns = now;
+    state->frames[nr].encoded_size = size;
+    state->frames[nr].encoded_hash = hash;
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * Sends all the RTP packets of a frame to the client through streaming::custom_sink::UDPSink, timing the send
+ */
+static GstFlowReturn on_packets(GstAppSink *appsink, gpointer user_data) {
+  auto state = (BenchState *)user_data;
+  auto payloaded_ns = monotonic_now_ns();
+
+  GstSample *sample = gst_app_sink_pull_sample(appsink);
+  if (!sample) {
+    return GST_FLOW_EOS;
+  }
+  GstBufferList *packets = gst_sample_get_buffer_list(sample);
+  auto nr_packets = packets ? gst_buffer_list_length(packets) : 0;
+  if (nr_packets == 0) {
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+  }
+
+  // Has to be known before the client can possibly get the frame
+  auto first_packet = gst_buffer_list_get(packets, 0);
+  GstMapInfo map;
+  gst_buffer_map(first_packet, &map, GST_MAP_READ);
+  auto frame_index = ((gst_moonlight_video::VideoRTPHeaders *)map.data)->packet.frameIndex;
+  gst_buffer_unmap(first_packet, &map);
+  uint64_t bytes = 0;
+  for (guint i = 0; i < nr_packets; i++) {
+    bytes += gst_buffer_get_size(gst_buffer_list_get(packets, i));
+  }
+  std::size_t nr;
+  {
+    std::lock_guard guard(state->lock);
+    nr = frame_number(*state, state->pts_frames, GST_BUFFER_PTS(first_packet));
+    state->rtp_frames[frame_index] = nr;
+    if (nr < state->frames.size()) {
+      state->frames[nr].payloaded_ns = payloaded_ns;
+    }
+  }
+
+  auto res = streaming::custom_sink::send_buffer_list(packets, &state->udp_sink);
+  auto sent_ns = monotonic_now_ns();
+  gst_sample_unref(sample);
+
+  std::lock_guard guard(state->lock);
+  state->packets_sent += nr_packets;
+  state->bytes_sent += bytes;
+  if (nr < state->frames.size()) {
+    state->frames[nr].sent_ns = sent_ns;
+    if (nr >= state->warmup_frames) {
+      state->send.add(payloaded_ns, sent_ns);
+    }
+  }
+  return res;
+}
+
+/**
+ * Called by the fake client for every frame it managed to rebuild
+ */
+static void on_frame(BenchState &state, ReceivedFrame &&frame) {
+  auto hash = hash_bytes(frame.payload.data(), frame.payload.size());
+
+  std::lock_guard guard(state.lock);
+  auto rtp_frame = state.rtp_frames.find(frame.frame_index);
+  if (rtp_frame == state.rtp_frames.end() || rtp_frame->second >= state.frames.size()) {
+    logs::log(logs::warning, "[CLIENT] Received unknown frame {}", frame.frame_index);
+    state.frames_corrupt++;
+    return;
+  }
+
+  auto nr = rtp_frame->second;
+  auto &record = state.frames[nr];
+  record.delivered = true;
+  if (frame.payload.size() != record.encoded_size || hash != record.encoded_hash) {
+    logs::log(logs::warning,
+              "[CLIENT] Frame {} doesn't match: {} bytes received, {} encoded",
+              nr,
+              frame.payload.size(),
+              record.encoded_size);
+    state.frames_corrupt++;
+    return;
+  }
+
+  state.frames_verified++;
+  state.key_frames += frame.key_frame;
+  if (nr >= state.warmup_frames) {
+    state.encode.add(record.capture_ns, record.encoded_ns);
+    state.packetize.add(record.encoded_ns, record.payloaded_ns);
+    state.transmit.add(record.payloaded_ns, frame.complete_ns);
+    state.recover.add(frame.complete_ns, frame.delivered_ns);
+    state.total.add(record.capture_ns, frame.delivered_ns);
+  }
+}
+
+static uint64_t process_cpu_ns() {
+  rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1'000'000'000ull +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1'000ull;
+}
+
+static std::string default_encoder(const Options &opts) {
+  return fmt::format("x264enc pass=qual tune=zerolatency speed-preset=superfast b-adapt=false bframes=0 ref=1 "
+                     "sliced-threads=true threads=1 option-string=\"slices=1:keyint=infinite:open-gop=0\" "
+                     "bitrate={} aud=false ! video/x-h264, profile=high, stream-format=byte-stream",
+                     opts.bitrate);
+}
+
+/**
+ * @return false if the pipeline posted an error
+ */
+static bool check_bus(GstElement *pipeline, GstClockTime timeout, GstMessageType types = GST_MESSAGE_ERROR) {
+  auto bus = gst_element_get_bus(pipeline);
+  auto msg = gst_bus_timed_pop_filtered(bus, timeout, (GstMessageType)(types | GST_MESSAGE_ERROR));
+  gst_object_unref(bus);
+  if (!msg) {
+    return true;
+  }
+
+  bool ok = GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR;
+  if (!ok) {
+    GError *error = nullptr;
+    gchar *debug = nullptr;
+    gst_message_parse_error(msg, &error, &debug);
+    logs::log(logs::error, "[GSTREAMER] {}: {}", error->message, debug ? debug : "");
+    g_clear_error(&error);
+    g_free(debug);
+  }
+  gst_message_unref(msg);
+  return ok;
+}
+
+static int run(const Options &opts) {
+  BenchState state;
+  state.opts = opts;
+  state.warmup_frames = opts.warmup * opts.fps;
+  auto total_frames = state.warmup_frames + opts.duration * opts.fps;
+  state.frames.resize(total_frames);
+  if (opts.loss_percentage > 0 || opts.capacity_kbps > 0) {
+    state.udp_sink.loss_simulator.emplace(opts.loss_percentage / 100, opts.capacity_kbps);
+  }
+
+  FakeClient client(opts.payload_size, [&state](ReceivedFrame &&frame) { on_frame(state, std::move(frame)); });
+  boost::asio::io_context io_context;
+  state.udp_sink.socket = std::make_shared<udp::socket>(io_context, udp::v4());
+  state.udp_sink.socket->set_option(boost::asio::socket_base::send_buffer_size(16 * 1024 * 1024));
+  state.udp_sink.client_endpoint = std::make_shared<udp::endpoint>(boost::asio::ip::address_v4::loopback(),
+                                                                   client.port());
+
+  auto encoder = opts.encoder ? fmt::format(fmt::runtime(*opts.encoder), fmt::arg("bitrate", opts.bitrate))
+                              : default_encoder(opts);
+  auto pipeline_desc = fmt::format(
+      "hyprlandframesrc name=workload width={} height={} framerate={}/1 format=BGRx ! "
+      "video/x-raw,format=BGRx ! videoconvert ! video/x-raw,format=I420 ! {} ! "
+      "rtpmoonlightpay_video name=moonlight_pay payload_size={} fec_percentage={} min_required_fec_packets=2 ! "
+      "appsink name=wolf_udp_sink sync=false buffer-list=true",
+      opts.width,
+      opts.height,
+      opts.fps,
+      encoder,
+      opts.payload_size,
+      opts.fec_percentage);
+  logs::log(logs::debug, "Pipeline: {}", pipeline_desc);
+
+  GError *error = nullptr;
+  auto pipeline = gst_parse_launch(pipeline_desc.c_str(), &error);
+  if (!pipeline || error) {
+    logs::log(logs::error, "Unable to create the pipeline: {}", error ? error->message : "unknown error");
+    g_clear_error(&error);
+    return 2;
+  }
+
+  auto frame_src = gst_bin_get_by_name(GST_BIN(pipeline), "workload");
+  auto payloader = gst_bin_get_by_name(GST_BIN(pipeline), "moonlight_pay");
+  auto appsink = gst_bin_get_by_name(GST_BIN(pipeline), "wolf_udp_sink");
+
+  auto payloader_sink = gst_element_get_static_pad(payloader, "sink");
+  gst_pad_add_probe(payloader_sink, GST_PAD_PROBE_TYPE_BUFFER, on_encoded, &state, nullptr);
+  gst_object_unref(payloader_sink);
+
+  GstAppSinkCallbacks callbacks = {nullptr};
+  callbacks.new_sample = on_packets;
+  gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, &state, nullptr);
+
+  client.start();
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  Workload workload(opts.workload, opts.width, opts.height);
+  auto frame_size = (gsize)opts.width * opts.height * sizeof(uint32_t);
+  auto frame_duration = gst_util_uint64_scale_int(GST_SECOND, 1, opts.fps);
+  auto next_frame = std::chrono::steady_clock::now();
+  uint64_t cpu_start = process_cpu_ns();
+  uint64_t measure_start_ns = monotonic_now_ns();
+  bool ok = true;
+
+  for (std::size_t nr = 0; nr < total_frames && ok; nr++) {
+    if (nr == state.warmup_frames) {
+      cpu_start = process_cpu_ns();
+      measure_start_ns = monotonic_now_ns();
+    }
+
+    // What the compositor does on each vblank: render, then hand the buffer and its damage to the frame source
+    auto damage = workload.next_frame();
+    GstBuffer *buf = gst_buffer_new_allocate(nullptr, frame_size, nullptr);
+    gst_buffer_fill(buf, 0, workload.pixels().data(), frame_size);
+    for (const auto &rect : damage) {
+      gst_buffer_add_video_region_of_interest_meta(buf, "damage", rect.x, rect.y, rect.width, rect.height);
+    }
+
+    auto capture_ns = monotonic_now_ns();
+    gst_buffer_set_capture_timestamp(buf, capture_ns);
+    {
+      std::lock_guard guard(state.lock);
+      state.frames[nr].capture_ns = capture_ns;
+      state.capture_frames[capture_ns] = nr;
+    }
+    // Never blocks: a frame the encoder hasn't picked up yet is overwritten, like in the compositor
+    gst_hyprland_frame_src_push_gst_buffer(GST_HYPRLAND_FRAME_SRC(frame_src), buf);
+
+    next_frame += std::chrono::nanoseconds(frame_duration);
+    std::this_thread::sleep_until(next_frame);
+    ok = ok && check_bus(pipeline, 0);
+  }
+
+  gst_element_send_event(frame_src, gst_event_new_eos());
+  ok = ok && check_bus(pipeline, 10 * GST_SECOND, GST_MESSAGE_EOS);
+  guint64 frames_pushed = 0, frames_overwritten = 0, frames_dropped = 0;
+  g_object_get(frame_src,
+               "frames-pushed",
+               &frames_pushed,
+               "frames-overwritten",
+               &frames_overwritten,
+               "frames-dropped",
+               &frames_dropped,
+               nullptr);
+  uint64_t cpu_ns = process_cpu_ns() - cpu_start;
+  uint64_t elapsed_ns = monotonic_now_ns() - measure_start_ns;
+
+  // Whatever is still in flight on loopback
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto client_stats = client.stop();
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(frame_src);
+  gst_object_unref(payloader);
+  gst_object_unref(appsink);
+  gst_object_unref(pipeline);
+  state.udp_sink.socket->close();
+
+  std::size_t encoded = 0, delivered = 0;
+  for (std::size_t nr = state.warmup_frames; nr < total_frames; nr++) {
+    encoded += state.frames[nr].encoded_ns != 0;
+    delivered += state.frames[nr].delivered;
+  }
+  auto measured_frames = total_frames - state.warmup_frames;
+  auto seconds = elapsed_ns / 1'000'000'000.0;
+
+  fmt::print("\nWorkload {} {}x{}@{} for {}s, {} kbps, payload {} bytes, FEC {}%, loss {}%{}\n",
+             opts.workload_name,
+             opts.width,
+             opts.height,
+             opts.fps,
+             opts.duration,
+             opts.bitrate,
+             opts.payload_size,
+             opts.fec_percentage,
+             opts.loss_percentage,
+             opts.capacity_kbps > 0 ? fmt::format(", capacity {} kbps", opts.capacity_kbps) : "");
+  fmt::print("\nLatency (ms)       p50       p90       p99       max\n");
+  state.encode.print("encode");       // capture -> encoded frame reaches the payloader
+  state.packetize.print("packetize"); // RTP + FEC
+  state.send.print("send");           // UDPSink: GSO or sendmmsg of all the packets
+  state.transmit.print("transmit");   // first packet handed to the socket -> client has enough shards
+  state.recover.print("recover");     // FEC recovery and reassembly on the client
+  state.total.print("total");         // capture -> frame ready for the decoder
+
+  fmt::print("\nFrames: {} rendered, {} encoded, {} delivered ({} key frames), {} verified, {} corrupt\n",
+             measured_frames,
+             encoded,
+             delivered,
+             state.key_frames,
+             state.frames_verified,
+             state.frames_corrupt);
+  fmt::print("Frame source: {} pushed, {} overwritten before the encoder picked them up, {} dropped\n",
+             frames_pushed,
+             frames_overwritten,
+             frames_dropped);
+  fmt::print("Packets: {} sent ({:.0f}/s, {:.2f} Mbit/s), {} of which dropped by the simulated link\n",
+             state.packets_sent,
+             state.packets_sent / seconds,
+             state.bytes_sent * 8 / seconds / 1'000'000,
+             state.udp_sink.packets_dropped);
+  fmt::print("Client: {} packets received, {} late, {} malformed, {} shards recovered with FEC ({:.3f} ms), "
+             "{} frames dropped, {} malformed\n",
+             client_stats.packets_received,
+             client_stats.late_packets,
+             client_stats.malformed_packets,
+             client_stats.recovered_shards,
+             client_stats.fec_decode_ns / 1'000'000.0,
+             client_stats.frames_dropped,
+             client_stats.frames_malformed);
+  fmt::print("CPU per frame: {:.3f} ms for the whole process, {:.3f} ms of which in the client\n",
+             cpu_ns / 1'000'000.0 / measured_frames,
+             client_stats.cpu_ns / 1'000'000.0 / total_frames);
+
+  if (!ok) {
+    return 2;
+  }
+  // Loss can make frames go missing, but what the client rebuilds must always be what was encoded
+  return state.frames_corrupt > 0 || client_stats.frames_malformed > 0 ? 1 : 0;
+}
+
+} // namespace bench
+
+int main(int argc, char **argv) {
+  gst_init(&argc, &argv);
+
+  auto opts = bench::parse_args(argc, argv);
+  logs::init(opts && opts->verbose ? logs::debug : logs::warning);
+  if (!opts) {
+    bench::print_usage();
+    return 2;
+  }
+
+  gst_element_register(nullptr, "rtpmoonlightpay_video", GST_RANK_PRIMARY, gst_TYPE_rtp_moonlight_pay_video);
+  gst_hyprland_frame_src_plugin_init(nullptr);
+  moonlight::fec::init();
+
+  try {
+    return bench::run(*opts);
+  } catch (const std::exception &e) {
+    logs::log(logs::error, "{}", e.what());
+    return 2;
+  }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace bench {
+
+struct Rect {
+  int x, y, width, height;
+};
+
+/**
+ * Scripted desktop activity, rendered on the CPU into a BGRx canvas.
+ *
+ * Each kind of workload stresses the encoder and the packetizer differently, and reports the same damage that the
+ * compositor would attach to the captured frame:
+ *  - idle: nothing changes, like the keep-alive frames sent while the desktop is still
+ *  - cursor: only a small square moves around
+ *  - scroll: the whole content moves up a few lines every frame
+ *  - video: a 16:9 quarter of the screen is redrawn with noise every frame, the worst case for the encoder
+ */
+class Workload {
+public:
+  enum class Kind {
+    idle,
+    cursor,
+    scroll,
+    video
+  };
+
+  static std::optional<Kind> parse(std::string_view name) {
+    if (name == "idle")
+      return Kind::idle;
+    if (name == "cursor")
+      return Kind::cursor;
+    if (name == "scroll")
+      return Kind::scroll;
+    if (name == "video")
+      return Kind::video;
+    return std::nullopt;
+  }
+
+  Workload(Kind kind, int width, int height) : kind(kind), width(width), height(height), canvas(width * height) {
+    // Some windows over a gradient, so that there's something for the encoder to chew on
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        canvas[y * width + x] = 0xFF000000 | ((x * 255 / width) << 16) | ((y * 255 / height) << 8) | 0x40;
+      }
+    }
+    fill({width / 10, height / 10, width / 2, height / 2}, 0xFFE0E0E0);
+    fill({width / 3, height / 3, width / 2, height / 2}, 0xFF303030);
+  }
+
+  /**
+   * Advances the script by one frame
+   * @return the damaged area since the previous frame, empty when nothing changed
+   */
+  std::vector<Rect> next_frame() {
+    std::vector<Rect> damage;
+    frame++;
+
+    switch (kind) {
+    case Kind::idle:
+      break;
+    case Kind::cursor: {
+      fill(cursor, background(cursor));
+      damage.push_back(cursor);
+      cursor.x = (int)((width - CURSOR_SIZE) * (0.5 + 0.5 * std::sin(frame * 0.05)));
+      cursor.y = (int)((height - CURSOR_SIZE) * (0.5 + 0.5 * std::sin(frame * 0.07)));
+      fill(cursor, 0xFFFFFFFF);
+      damage.push_back(cursor);
+      break;
+    }
+    case Kind::scroll: {
+      auto lines = std::min(SCROLL_LINES, height);
+      std::memmove(canvas.data(), canvas.data() + lines * width, (height - lines) * width * sizeof(uint32_t));
+      for (int y = height - lines; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          // Text-ish stripes, so that scrolled content is not a flat color
+          canvas[y * width + x] = ((x / 6 + (frame + y) / 3) % 5 == 0) ? 0xFF101010 : 0xFFF0F0F0;
+        }
+      }
+      damage.push_back({0, 0, width, height});
+      break;
+    }
+    case Kind::video: {
+      Rect area = {width / 8, height / 8, width / 2, height / 2};
+      for (int y = area.y; y < area.y + area.height; y++) {
+        for (int x = area.x; x < area.x + area.width; x++) {
+          rng ^= rng << 13;
+          rng ^= rng >> 17;
+          rng ^= rng << 5;
+          canvas[y * width + x] = 0xFF000000 | (rng & 0x00FFFFFF);
+        }
+      }
+      damage.push_back(area);
+      break;
+    }
+    }
+
+    return damage;
+  }
+
+  [[nodiscard]] const std::vector<uint32_t> &pixels() const {
+    return canvas;
+  }
+
+private:
+  static constexpr int CURSOR_SIZE = 24;
+  static constexpr int SCROLL_LINES = 8;
+
+  void fill(const Rect &rect, uint32_t color) {
+    for (int y = std::max(rect.y, 0); y < std::min(rect.y + rect.height, height); y++) {
+      std::fill_n(canvas.data() + y * width + std::max(rect.x, 0),
+                  std::min(rect.x + rect.width, width) - std::max(rect.x, 0),
+                  color);
+    }
+  }
+
+  /* Color under the cursor, the gradient is close enough to what was there */
+  uint32_t background(const Rect &rect) const {
+    return canvas[std::clamp(rect.y - 1, 0, height - 1) * width + std::clamp(rect.x - 1, 0, width - 1)];
+  }
+
+  Kind kind;
+  int width;
+  int height;
+  std::vector<uint32_t> canvas;
+
+  int frame = 0;
+  Rect cursor = {0, 0, CURSOR_SIZE, CURSOR_SIZE};
+  uint32_t rng = 0x9E3779B9;
+};
+
+} // namespace bench
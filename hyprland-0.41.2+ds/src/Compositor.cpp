@@ -8,6 +8,7 @@
 #include "managers/eventLoop/EventLoopManager.hpp"
 #include <random>
 #include <unordered_set>
+#include <charconv>
 #include "debug/HyprCtl.hpp"
 #include "debug/CrashReporter.hpp"
 #ifdef USES_SYSTEMD
@@ -60,6 +61,9 @@ void handleUnrecoverableSignal(int sig) {
     });
     alarm(15);
 
+    // the log file is written by a thread that won't run again, get the last lines in before the report
+    Debug::flushFromSignal();
+
     CrashReporter::createAndSaveCrash(sig);
 
     abort();
@@ -348,6 +352,9 @@ void CCompositor::cleanup() {
 
     m_vWorkspaces.clear();
     m_vWindows.clear();
+    m_mWorkspacesByID.clear();
+    m_mWorkspacesByName.clear();
+    m_mWindowsByAddress.clear();
 
     for (auto& m : m_vMonitors) {
         g_pHyprOpenGL->destroyMonitorResources(m.get());
@@ -683,6 +690,8 @@ void CCompositor::removeWindowFromVectorSafe(PHLWINDOW pWindow) {
 
         std::erase_if(m_vWindows, [&](SP<CWindow>& el) { return el == pWindow; });
         std::erase_if(m_vWindowsFadingOut, [&](PHLWINDOWREF el) { return el.lock() == pWindow; });
+        m_mWindowsByAddress.erase(pWindow.get());
+        m_windowHitIndex.invalidateAll();
     }
 }
 
@@ -703,9 +712,12 @@ PHLWINDOW CCompositor::vectorToWindowUnified(const Vector2D& pos, uint8_t proper
     static auto PSPECIALFALLTHRU  = CConfigValue<Hyprlang::INT>("input:special_fallthrough");
     const auto  BORDER_GRAB_AREA  = *PRESIZEONBORDER ? *PBORDERSIZE + *PBORDERGRABEXTEND : 0;
 
+    // only the windows that can be there, in the same order as m_vWindows
+    const auto CANDIDATES = m_windowHitIndex.candidatesAt(pos, g_pPointerManager->position());
+
     // pinned windows on top of floating regardless
     if (properties & ALLOW_FLOATING) {
-        for (auto& w : m_vWindows | std::views::reverse) {
+        for (auto& w : CANDIDATES | std::views::reverse) {
             const auto BB  = w->getWindowBoxUnified(properties);
             CBox       box = BB.copy().expand(w->m_iX11Type == 2 ? BORDER_GRAB_AREA : 0);
             if (w->m_bIsFloating && w->m_bIsMapped && !w->isHidden() && !w->m_bX11ShouldntFocus && w->m_bPinned && !w->m_sAdditionalConfigData.noFocus && w != pIgnoreWindow) {
@@ -722,7 +734,7 @@ PHLWINDOW CCompositor::vectorToWindowUnified(const Vector2D& pos, uint8_t proper
 
     auto windowForWorkspace = [&](bool special) -> PHLWINDOW {
         auto floating = [&](bool aboveFullscreen) -> PHLWINDOW {
-            for (auto& w : m_vWindows | std::views::reverse) {
+            for (auto& w : CANDIDATES | std::views::reverse) {
 
                 if (special && !w->onSpecialWorkspace()) // because special floating may creep up into regular
                     continue;
@@ -785,7 +797,7 @@ PHLWINDOW CCompositor::vectorToWindowUnified(const Vector2D& pos, uint8_t proper
             return found;
 
         // for windows, we need to check their extensions too, first.
-        for (auto& w : m_vWindows) {
+        for (auto& w : CANDIDATES) {
             if (special != w->onSpecialWorkspace())
                 continue;
 
@@ -796,7 +808,7 @@ PHLWINDOW CCompositor::vectorToWindowUnified(const Vector2D& pos, uint8_t proper
             }
         }
 
-        for (auto& w : m_vWindows) {
+        for (auto& w : CANDIDATES) {
             if (special != w->onSpecialWorkspace())
                 continue;
 
@@ -1166,12 +1178,45 @@ bool CCompositor::isWorkspaceVisibleNotCovered(PHLWORKSPACE w) {
 }
 
 PHLWORKSPACE CCompositor::getWorkspaceByID(const int& id) {
-    for (auto& w : m_vWorkspaces) {
-        if (w->m_iID == id && !w->inert())
-            return w;
+    const auto IT = m_mWorkspacesByID.find(id);
+    if (IT == m_mWorkspacesByID.end())
+        return nullptr;
+
+    const auto PWORKSPACE = IT->second.lock();
+    if (!PWORKSPACE || PWORKSPACE->m_iID != id || PWORKSPACE->inert())
+        return nullptr;
+
+    return PWORKSPACE;
+}
+
+PHLWORKSPACE CCompositor::addWorkspace(PHLWORKSPACE pWorkspace) {
+    m_vWorkspaces.emplace_back(pWorkspace);
+    indexWorkspace(pWorkspace);
+    return pWorkspace;
+}
+
+void CCompositor::indexWorkspace(PHLWORKSPACE pWorkspace) {
+    // like the scans these replace, the first one in m_vWorkspaces wins if ids or names collide
+    m_mWorkspacesByID.try_emplace(pWorkspace->m_iID, pWorkspace);
+    m_mWorkspacesByName.try_emplace(pWorkspace->m_szName, pWorkspace);
+}
+
+void CCompositor::unindexWorkspace(PHLWORKSPACE pWorkspace) {
+    if (const auto IT = m_mWorkspacesByID.find(pWorkspace->m_iID); IT != m_mWorkspacesByID.end() && IT->second.lock() == pWorkspace) {
+        m_mWorkspacesByID.erase(IT);
+
+        if (const auto OTHER = std::find_if(m_vWorkspaces.begin(), m_vWorkspaces.end(), [&](const auto& w) { return w != pWorkspace && w->m_iID == pWorkspace->m_iID; });
+            OTHER != m_vWorkspaces.end())
+            m_mWorkspacesByID.emplace(pWorkspace->m_iID, *OTHER);
     }
 
-    return nullptr;
+    if (const auto IT = m_mWorkspacesByName.find(pWorkspace->m_szName); IT != m_mWorkspacesByName.end() && IT->second.lock() == pWorkspace) {
+        m_mWorkspacesByName.erase(IT);
+
+        if (const auto OTHER = std::find_if(m_vWorkspaces.begin(), m_vWorkspaces.end(), [&](const auto& w) { return w != pWorkspace && w->m_szName == pWorkspace->m_szName; });
+            OTHER != m_vWorkspaces.end())
+            m_mWorkspacesByName.emplace(pWorkspace->m_szName, *OTHER);
+    }
 }
 
 void CCompositor::sanityCheckWorkspaces() {
@@ -1181,6 +1226,7 @@ void CCompositor::sanityCheckWorkspaces() {
 
         // If ref == 1, only the compositor holds a ref, which means it's inactive and has no mapped windows.
         if (!WORKSPACE->m_bPersistent && WORKSPACE.strongRef() == 1) {
+            unindexWorkspace(WORKSPACE);
             it = m_vWorkspaces.erase(it);
             continue;
         }
@@ -1302,6 +1348,8 @@ void CCompositor::changeWindowZOrder(PHLWINDOW pWindow, bool top) {
 
         if (pw->m_bIsMapped)
             g_pHyprRenderer->damageMonitor(getMonitorFromID(pw->m_iMonitorID));
+
+        m_windowHitIndex.invalidateAll();
     };
 
     if (top)
@@ -1640,12 +1688,15 @@ int CCompositor::getNextAvailableNamedWorkspace() {
 }
 
 PHLWORKSPACE CCompositor::getWorkspaceByName(const std::string& name) {
-    for (auto& w : m_vWorkspaces) {
-        if (w->m_szName == name && !w->inert())
-            return w;
-    }
+    const auto IT = m_mWorkspacesByName.find(name);
+    if (IT == m_mWorkspacesByName.end())
+        return nullptr;
 
-    return nullptr;
+    const auto PWORKSPACE = IT->second.lock();
+    if (!PWORKSPACE || PWORKSPACE->m_szName != name || PWORKSPACE->inert())
+        return nullptr;
+
+    return PWORKSPACE;
 }
 
 PHLWORKSPACE CCompositor::getWorkspaceByString(const std::string& str) {
@@ -2303,6 +2354,25 @@ PHLWINDOW CCompositor::getWindowByRegex(const std::string& regexp) {
     if (regexp.starts_with("active"))
         return m_pLastWindow.lock();
 
+    // addresses are unique, look it up directly
+    if (regexp.starts_with("address:")) {
+        const auto ADDRESS = std::string_view{regexp}.substr(8);
+        uintptr_t  address = 0;
+        if (!ADDRESS.starts_with("0x"))
+            return nullptr;
+
+        const auto [END, ERR] = std::from_chars(ADDRESS.data() + 2, ADDRESS.data() + ADDRESS.size(), address, 16);
+        // has to be exactly how it's printed, 0X or leading zeroes never matched
+        if (ERR != std::errc{} || END != ADDRESS.data() + ADDRESS.size() || std::format("0x{:x}", address) != ADDRESS)
+            return nullptr;
+
+        const auto PWINDOW = windowForCPointer((CWindow*)address);
+        if (!PWINDOW || !PWINDOW->m_bIsMapped || (PWINDOW->isHidden() && !g_pLayoutManager->getCurrentLayout()->isWindowReachable(PWINDOW)))
+            return nullptr;
+
+        return PWINDOW;
+    }
+
     eFocusWindowMode mode = MODE_CLASS_REGEX;
 
     std::regex       regexCheck(regexp);
@@ -2318,9 +2388,6 @@ PHLWINDOW CCompositor::getWindowByRegex(const std::string& regexp) {
     } else if (regexp.starts_with("initialtitle:")) {
         mode       = MODE_INITIAL_TITLE_REGEX;
         regexCheck = std::regex(regexp.substr(13));
-    } else if (regexp.starts_with("address:")) {
-        mode       = MODE_ADDRESS;
-        matchCheck = regexp.substr(8);
     } else if (regexp.starts_with("pid:")) {
         mode       = MODE_PID;
         matchCheck = regexp.substr(4);
@@ -2370,12 +2437,6 @@ PHLWINDOW CCompositor::getWindowByRegex(const std::string& regexp) {
                     continue;
                 break;
             }
-            case MODE_ADDRESS: {
-                std::string addr = std::format("0x{:x}", (uintptr_t)w.get());
-                if (matchCheck != addr)
-                    continue;
-                break;
-            }
             case MODE_PID: {
                 std::string pid = std::format("{}", w->getPID());
                 if (matchCheck != pid)
@@ -2513,7 +2574,7 @@ PHLWORKSPACE CCompositor::createNewWorkspace(const int& id, const int& monid, co
 
     const bool SPECIAL = id >= SPECIAL_WORKSPACE_START && id <= -2;
 
-    const auto PWORKSPACE = m_vWorkspaces.emplace_back(CWorkspace::create(id, monID, NAME, SPECIAL, isEmtpy));
+    const auto PWORKSPACE = addWorkspace(CWorkspace::create(id, monID, NAME, SPECIAL, isEmtpy));
 
     PWORKSPACE->m_fAlpha.setValueAndWarp(0);
 
@@ -2530,7 +2591,9 @@ void CCompositor::renameWorkspace(const int& id, const std::string& name) {
         return;
 
     Debug::log(LOG, "renameWorkspace: Renaming workspace {} to '{}'", id, name);
+    unindexWorkspace(PWORKSPACE);
     PWORKSPACE->m_szName = name;
+    indexWorkspace(PWORKSPACE);
 
     g_pEventManager->postEvent({"renameworkspace", std::to_string(PWORKSPACE->m_iID) + "," + PWORKSPACE->m_szName});
 }
@@ -2803,12 +2866,15 @@ void CCompositor::updateSuspendedStates() {
 }
 
 PHLWINDOW CCompositor::windowForCPointer(CWindow* pWindow) {
-    for (auto& w : m_vWindows) {
-        if (w.get() != pWindow)
-            continue;
+    const auto IT = m_mWindowsByAddress.find(pWindow);
+    if (IT == m_mWindowsByAddress.end())
+        return {};
 
-        return w;
-    }
+    return IT->second.lock();
+}
 
-    return {};
+void CCompositor::addWindow(PHLWINDOW pWindow) {
+    m_vWindows.emplace_back(pWindow);
+    m_mWindowsByAddress[pWindow.get()] = pWindow;
+    m_windowHitIndex.invalidateAll();
 }
@@ -24,6 +24,7 @@
 #include "helpers/Monitor.hpp"
 #include "desktop/Workspace.hpp"
 #include "desktop/Window.hpp"
+#include "desktop/WindowHitIndex.hpp"
 #include "render/Renderer.hpp"
 #include "render/OpenGL.hpp"
 #include "hyprerror/HyprError.hpp"
@@ -182,6 +183,8 @@ class CCompositor {
     void                   setPreferredTransformForSurface(SP<CWLSurfaceResource> pSurface, wl_output_transform transform);
     void                   updateSuspendedStates();
     PHLWINDOW              windowForCPointer(CWindow*);
+    PHLWORKSPACE           addWorkspace(PHLWORKSPACE);
+    void                   addWindow(PHLWINDOW);
 
     std::string            explicitConfigPath;
 
@@ -192,10 +195,19 @@ class CCompositor {
     void             setRandomSplash();
     void             initManagers(eManagersInitStage stage);
     void             prepareFallbackOutput();
+    void             indexWorkspace(PHLWORKSPACE);
+    void             unindexWorkspace(PHLWORKSPACE);
 
     uint64_t         m_iHyprlandPID    = 0;
     wl_event_source* m_critSigSource   = nullptr;
     rlimit           m_sOriginalNofile = {0};
+
+    CWindowHitIndex  m_windowHitIndex; // for vectorToWindowUnified
+
+    // lookups for dispatchers and IPC, kept in sync with m_vWorkspaces and m_vWindows. Monitors are few enough to be scanned.
+    std::unordered_map<int, PHLWORKSPACEREF>         m_mWorkspacesByID;
+    std::unordered_map<std::string, PHLWORKSPACEREF> m_mWorkspacesByName;
+    std::unordered_map<CWindow*, PHLWINDOWREF>       m_mWindowsByAddress;
 };
 
 inline std::unique_ptr<CCompositor> g_pCompositor;
@@ -765,6 +765,7 @@ std::optional<std::string> CConfigManager::verifyConfigExists() {
 std::optional<std::string> CConfigManager::resetHLConfig() {
     m_dMonitorRules.clear();
     m_dWindowRules.clear();
+    m_iWindowRulesGeneration++;
     g_pKeybindManager->clearKeybinds();
     g_pAnimationManager->removeAllBeziers();
     m_mAdditionalReservedAreas.clear();
@@ -1073,139 +1074,209 @@ SWorkspaceRule CConfigManager::mergeWorkspaceRules(const SWorkspaceRule& rule1,
     return mergedRule;
 }
 
-std::vector<SWindowRule> CConfigManager::getMatchingRules(PHLWINDOW pWindow, bool dynamic, bool shadowExec) {
-    if (!valid(pWindow))
-        return std::vector<SWindowRule>();
+// throws if a regex or the workspace is invalid
+static SP<SCompiledWindowRule> compileWindowRule(const SWindowRule& rule) {
+    auto compiled = makeShared<SCompiledWindowRule>();
 
-    // if the window is unmapped, don't process exec rules yet.
-    shadowExec = shadowExec || !pWindow->m_bIsMapped;
+    if (!rule.v2) {
+        if (rule.szValue.starts_with("tag:"))
+            compiled->dependencies |= RULE_DEP_VOLATILE;
 
-    std::vector<SWindowRule> returns;
+        if (rule.szValue.starts_with("title:")) {
+            compiled->titleRegex = CRuleRegex(rule.szValue.substr(6));
+            compiled->dependencies |= RULE_DEP_TITLE;
+        } else {
+            compiled->classRegex = CRuleRegex(rule.szValue);
+            compiled->dependencies |= RULE_DEP_CLASS;
+        }
 
-    std::string              title      = pWindow->m_szTitle;
-    std::string              appidclass = pWindow->m_szClass;
+        return compiled;
+    }
 
-    Debug::log(LOG, "Searching for matching rules for {} (title: {})", appidclass, title);
+    // tags can be set by the rules before, so can't be cached
+    if (!rule.szTag.empty())
+        compiled->dependencies |= RULE_DEP_VOLATILE;
 
-    // since some rules will be applied later, we need to store some flags
-    bool hasFloating   = pWindow->m_bIsFloating;
-    bool hasFullscreen = pWindow->m_bIsFullscreen;
+    if (!rule.szClass.empty()) {
+        compiled->classRegex = CRuleRegex(rule.szClass);
+        compiled->dependencies |= RULE_DEP_CLASS;
+    }
 
-    // local tags for dynamic tag rule match
-    auto tags = pWindow->m_tags;
+    if (!rule.szTitle.empty()) {
+        compiled->titleRegex = CRuleRegex(rule.szTitle);
+        compiled->dependencies |= RULE_DEP_TITLE;
+    }
 
-    for (auto& rule : m_dWindowRules) {
-        // check if we have a matching rule
-        if (!rule.v2) {
-            try {
-                if (rule.szValue.starts_with("tag:") && !tags.isTagged(rule.szValue.substr(4)))
-                    continue;
+    if (!rule.szInitialClass.empty()) {
+        compiled->initialClassRegex = CRuleRegex(rule.szInitialClass);
+        compiled->dependencies |= RULE_DEP_INITIAL_CLASS;
+    }
 
-                if (rule.szValue.starts_with("title:")) {
-                    std::regex RULECHECK(rule.szValue.substr(6));
+    if (!rule.szInitialTitle.empty()) {
+        compiled->initialTitleRegex = CRuleRegex(rule.szInitialTitle);
+        compiled->dependencies |= RULE_DEP_INITIAL_TITLE;
+    }
 
-                    if (!std::regex_search(title, RULECHECK))
-                        continue;
-                } else {
-                    std::regex classCheck(rule.szValue);
+    if (rule.bX11 != -1)
+        compiled->dependencies |= RULE_DEP_XWAYLAND;
 
-                    if (!std::regex_search(appidclass, classCheck))
-                        continue;
-                }
-            } catch (...) {
-                Debug::log(ERR, "Regex error at {}", rule.szValue);
-                continue;
-            }
-        } else {
-            try {
-                if (!rule.szTag.empty() && !tags.isTagged(rule.szTag))
-                    continue;
+    if (rule.bFloating != -1)
+        compiled->dependencies |= RULE_DEP_FLOATING;
 
-                if (!rule.szClass.empty()) {
-                    std::regex RULECHECK(rule.szClass);
+    if (rule.bFullscreen != -1)
+        compiled->dependencies |= RULE_DEP_FULLSCREEN;
 
-                    if (!std::regex_search(appidclass, RULECHECK))
-                        continue;
-                }
+    if (rule.bPinned != -1)
+        compiled->dependencies |= RULE_DEP_PINNED;
 
-                if (!rule.szTitle.empty()) {
-                    std::regex RULECHECK(rule.szTitle);
+    if (rule.bFocus != -1)
+        compiled->dependencies |= RULE_DEP_FOCUS;
 
-                    if (!std::regex_search(title, RULECHECK))
-                        continue;
-                }
+    // selectors depend on the other windows on the workspace
+    if (!rule.szOnWorkspace.empty())
+        compiled->dependencies |= RULE_DEP_VOLATILE;
 
-                if (!rule.szInitialTitle.empty()) {
-                    std::regex RULECHECK(rule.szInitialTitle);
+    if (!rule.szWorkspace.empty()) {
+        compiled->dependencies |= RULE_DEP_WORKSPACE;
 
-                    if (!std::regex_search(pWindow->m_szInitialTitle, RULECHECK))
-                        continue;
-                }
+        if (!rule.szWorkspace.starts_with("name:")) {
+            if (!isNumber(rule.szWorkspace))
+                throw std::runtime_error("workspace not name: or number");
 
-                if (!rule.szInitialClass.empty()) {
-                    std::regex RULECHECK(rule.szInitialClass);
+            compiled->workspaceID = std::stoll(rule.szWorkspace);
+        }
+    }
 
-                    if (!std::regex_search(pWindow->m_szInitialClass, RULECHECK))
-                        continue;
-                }
+    return compiled;
+}
 
-                if (rule.bX11 != -1) {
-                    if (pWindow->m_bIsX11 != rule.bX11)
-                        continue;
-                }
+static bool windowRuleMatches(const SWindowRule& rule, const SWindowRuleInputs& inputs, CTagKeeper& tags, PHLWINDOW pWindow) {
+    const auto& COMPILED = *rule.compiled;
 
-                if (rule.bFloating != -1) {
-                    if (hasFloating != rule.bFloating)
-                        continue;
-                }
+    if (!rule.v2) {
+        if (rule.szValue.starts_with("tag:") && !tags.isTagged(rule.szValue.substr(4)))
+            return false;
 
-                if (rule.bFullscreen != -1) {
-                    if (hasFullscreen != rule.bFullscreen)
-                        continue;
-                }
+        // one of them matches anything, depending on title: or not
+        return COMPILED.titleRegex.matches(inputs.szTitle) && COMPILED.classRegex.matches(inputs.szClass);
+    }
 
-                if (rule.bPinned != -1) {
-                    if (pWindow->m_bPinned != rule.bPinned)
-                        continue;
-                }
+    if (!rule.szTag.empty() && !tags.isTagged(rule.szTag))
+        return false;
 
-                if (rule.bFocus != -1) {
-                    if (rule.bFocus != (g_pCompositor->m_pLastWindow.lock() == pWindow))
-                        continue;
-                }
+    if (!COMPILED.classRegex.matches(inputs.szClass) || !COMPILED.titleRegex.matches(inputs.szTitle) || !COMPILED.initialTitleRegex.matches(inputs.szInitialTitle) ||
+        !COMPILED.initialClassRegex.matches(inputs.szInitialClass))
+        return false;
 
-                if (!rule.szOnWorkspace.empty()) {
-                    const auto PWORKSPACE = pWindow->m_pWorkspace;
-                    if (!PWORKSPACE || !PWORKSPACE->matchesStaticSelector(rule.szOnWorkspace))
-                        continue;
-                }
+    if (rule.bX11 != -1 && inputs.bX11 != rule.bX11)
+        return false;
 
-                if (!rule.szWorkspace.empty()) {
-                    const auto PWORKSPACE = pWindow->m_pWorkspace;
+    if (rule.bFloating != -1 && inputs.bFloating != rule.bFloating)
+        return false;
 
-                    if (!PWORKSPACE)
-                        continue;
+    if (rule.bFullscreen != -1 && inputs.bFullscreen != rule.bFullscreen)
+        return false;
 
-                    if (rule.szWorkspace.starts_with("name:")) {
-                        if (PWORKSPACE->m_szName != rule.szWorkspace.substr(5))
-                            continue;
-                    } else {
-                        // number
-                        if (!isNumber(rule.szWorkspace))
-                            throw std::runtime_error("szWorkspace not name: or number");
+    if (rule.bPinned != -1 && inputs.bPinned != rule.bPinned)
+        return false;
 
-                        const int64_t ID = std::stoll(rule.szWorkspace);
+    if (rule.bFocus != -1 && inputs.bFocused != rule.bFocus)
+        return false;
 
-                        if (PWORKSPACE->m_iID != ID)
-                            continue;
-                    }
-                }
-            } catch (std::exception& e) {
-                Debug::log(ERR, "Regex error at {} ({})", rule.szValue, e.what());
-                continue;
-            }
+    if (!rule.szOnWorkspace.empty()) {
+        const auto PWORKSPACE = pWindow->m_pWorkspace;
+        if (!PWORKSPACE || !PWORKSPACE->matchesStaticSelector(rule.szOnWorkspace))
+            return false;
+    }
+
+    if (!rule.szWorkspace.empty()) {
+        if (!inputs.bWorkspace)
+            return false;
+
+        if (COMPILED.workspaceID.has_value())
+            return inputs.iWorkspaceID == *COMPILED.workspaceID;
+
+        return inputs.szWorkspaceName == std::string_view{rule.szWorkspace}.substr(5);
+    }
+
+    return true;
+}
+
+std::vector<SWindowRule> CConfigManager::getMatchingRules(PHLWINDOW pWindow, bool dynamic, bool shadowExec) {
+    if (!valid(pWindow))
+        return std::vector<SWindowRule>();
+
+    // if the window is unmapped, don't process exec rules yet.
+    shadowExec = shadowExec || !pWindow->m_bIsMapped;
+
+    std::vector<SWindowRule> returns;
+
+    const auto PWORKSPACE = pWindow->m_pWorkspace;
+
+    SWindowRuleInputs inputs = {
+        .szClass         = pWindow->m_szClass,
+        .szTitle         = pWindow->m_szTitle,
+        .szInitialClass  = pWindow->m_szInitialClass,
+        .szInitialTitle  = pWindow->m_szInitialTitle,
+        .bX11            = pWindow->m_bIsX11,
+        .bFloating       = pWindow->m_bIsFloating,
+        .bFullscreen     = pWindow->m_bIsFullscreen,
+        .bPinned         = pWindow->m_bPinned,
+        .bFocused        = g_pCompositor->m_pLastWindow.lock() == pWindow,
+        .bWorkspace      = PWORKSPACE != nullptr,
+        .iWorkspaceID    = PWORKSPACE ? PWORKSPACE->m_iID : 0,
+        .szWorkspaceName = PWORKSPACE ? PWORKSPACE->m_szName : "",
+    };
+
+    Debug::log(LOG, "Searching for matching rules for {} (title: {})", inputs.szClass, inputs.szTitle);
+
+    // rules pushed by plugins straight into m_dWindowRules
+    for (auto& rule : m_dWindowRules) {
+        if (rule.compiled)
+            continue;
+
+        m_iWindowRulesGeneration++;
+        try {
+            rule.compiled = compileWindowRule(rule);
+        } catch (std::exception& e) { Debug::log(ERR, "Invalid window rule {} -> {} ({})", rule.szRule, rule.szValue, e.what()); }
+    }
+
+    // rules only need to be evaluated again if something they depend on changed since the last time. Non-dynamic
+    // evaluations see the float and fullscreen rules matched before them instead of the window state, they don't
+    // use nor update the cache.
+    auto&    cache   = pWindow->m_sRuleMatchCache;
+    uint32_t changed = RULE_DEP_ALL;
+    if (dynamic) {
+        if (cache.generation == m_iWindowRulesGeneration && cache.matched.size() == m_dWindowRules.size())
+            changed = inputs.diff(cache.inputs);
+
+        cache.matched.resize(m_dWindowRules.size());
+    }
+
+    // local tags for dynamic tag rule match
+    auto tags = pWindow->m_tags;
+
+    for (size_t i = 0; i < m_dWindowRules.size(); ++i) {
+        const auto& rule = m_dWindowRules[i];
+        if (!rule.compiled)
+            continue;
+
+        // check if we have a matching rule
+        bool matches = false;
+        if (dynamic && !(rule.compiled->dependencies & (changed | RULE_DEP_VOLATILE)))
+            matches = cache.matched[i];
+        else {
+            try {
+                matches = windowRuleMatches(rule, inputs, tags, pWindow);
+            } catch (std::exception& e) { Debug::log(ERR, "Window rule error at {} ({})", rule.szValue, e.what()); }
         }
 
+        if (dynamic)
+            cache.matched[i] = matches;
+
+        if (!matches)
+            continue;
+
         // applies. Read the rule and behave accordingly
         Debug::log(LOG, "Window rule {} -> {} matched {}", rule.szRule, rule.szValue, pWindow);
 
@@ -1222,9 +1293,14 @@ std::vector<SWindowRule> CConfigManager::getMatchingRules(PHLWINDOW pWindow, boo
             continue;
 
         if (rule.szRule == "float")
-            hasFloating = true;
+            inputs.bFloating = true;
         else if (rule.szRule == "fullscreen")
-            hasFullscreen = true;
+            inputs.bFullscreen = true;
+    }
+
+    if (dynamic) {
+        cache.generation = m_iWindowRulesGeneration;
+        cache.inputs     = std::move(inputs);
     }
 
     std::vector<uint64_t> PIDs = {(uint64_t)pWindow->getPID()};
@@ -1258,9 +1334,17 @@ std::vector<SLayerRule> CConfigManager::getMatchingRules(PHLLS pLS) {
             if (std::format("address:0x{:x}", (uintptr_t)pLS.get()) != lr.targetNamespace)
                 continue;
         } else {
-            std::regex NSCHECK(lr.targetNamespace);
+            // rules pushed by plugins straight into m_dLayerRules
+            if (!lr.namespaceRegex) {
+                try {
+                    lr.namespaceRegex = makeShared<CRuleRegex>(lr.targetNamespace);
+                } catch (std::exception& e) {
+                    Debug::log(ERR, "Invalid layer rule namespace {} ({})", lr.targetNamespace, e.what());
+                    continue;
+                }
+            }
 
-            if (!std::regex_search(pLS->layerSurface->layerNamespace, NSCHECK))
+            if (!lr.namespaceRegex->matches(pLS->layerSurface->layerNamespace))
                 continue;
         }
 
@@ -2110,6 +2194,7 @@ std::optional<std::string> CConfigManager::handleWindowRule(const std::string& c
 
     if (RULE == "unset") {
         std::erase_if(m_dWindowRules, [&](const SWindowRule& other) { return other.szValue == VALUE; });
+        m_iWindowRulesGeneration++;
         return {};
     }
 
@@ -2119,10 +2204,20 @@ std::optional<std::string> CConfigManager::handleWindowRule(const std::string& c
         return "Invalid rule: " + RULE;
     }
 
+    SWindowRule rule{RULE, VALUE};
+    try {
+        rule.compiled = compileWindowRule(rule);
+    } catch (std::exception& e) {
+        Debug::log(ERR, "Invalid rule value: {} ({})", VALUE, e.what());
+        return "Invalid rule value: " + VALUE;
+    }
+
     if (RULE.starts_with("size") || RULE.starts_with("maxsize") || RULE.starts_with("minsize"))
-        m_dWindowRules.push_front({RULE, VALUE});
+        m_dWindowRules.push_front(rule);
     else
-        m_dWindowRules.push_back({RULE, VALUE});
+        m_dWindowRules.push_back(rule);
+
+    m_iWindowRulesGeneration++;
 
     return {};
 }
@@ -2145,7 +2240,17 @@ std::optional<std::string> CConfigManager::handleLayerRule(const std::string& co
         return "Invalid rule found: " + RULE;
     }
 
-    m_dLayerRules.push_back({VALUE, RULE});
+    SLayerRule rule{VALUE, RULE};
+    if (!VALUE.starts_with("address:0x")) {
+        try {
+            rule.namespaceRegex = makeShared<CRuleRegex>(VALUE);
+        } catch (std::exception& e) {
+            Debug::log(ERR, "Invalid layer rule namespace: {} ({})", VALUE, e.what());
+            return "Invalid layer rule namespace: " + VALUE;
+        }
+    }
+
+    m_dLayerRules.push_back(rule);
 
     for (auto& m : g_pCompositor->m_vMonitors)
         for (auto& lsl : m->m_aLayerSurfaceLayers)
@@ -2321,14 +2426,24 @@ std::optional<std::string> CConfigManager::handleWindowRuleV2(const std::string&
                 return true;
             }
         });
+        m_iWindowRulesGeneration++;
         return {};
     }
 
+    try {
+        rule.compiled = compileWindowRule(rule);
+    } catch (std::exception& e) {
+        Debug::log(ERR, "Invalid rulev2 value: {} ({})", VALUE, e.what());
+        return "Invalid rulev2 value: " + VALUE;
+    }
+
     if (RULE.starts_with("size") || RULE.starts_with("maxsize") || RULE.starts_with("minsize"))
         m_dWindowRules.push_front(rule);
     else
         m_dWindowRules.push_back(rule);
 
+    m_iWindowRulesGeneration++;
+
     return {};
 }
 
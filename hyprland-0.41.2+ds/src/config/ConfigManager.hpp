@@ -171,6 +171,8 @@ class CConfigManager {
   private:
     std::unique_ptr<Hyprlang::CConfig>                        m_pConfig;
 
+    uint64_t                                                  m_iWindowRulesGeneration = 1; // bumped whenever m_dWindowRules changes
+
     std::deque<std::string>                                   configPaths;       // stores all the config paths
     std::unordered_map<std::string, time_t>                   configModifyTimes; // stores modify times
 
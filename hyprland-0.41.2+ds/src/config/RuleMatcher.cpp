@@ -0,0 +1,114 @@
+#include "RuleMatcher.hpp"
+
+#include <string_view>
+
+// characters that make a pattern a regex, unless escaped
+static bool isRegexSpecial(char c) {
+    return std::string_view{".[]{}()*+?|^$\\/"}.find(c) != std::string_view::npos;
+}
+
+// the literal a pattern matches, if it doesn't use anything but escaped special characters
+static std::optional<std::string> unescapeLiteral(std::string_view body) {
+    std::string literal;
+    literal.reserve(body.size());
+
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (body[i] == '\\') {
+            if (i + 1 >= body.size() || !isRegexSpecial(body[i + 1]))
+                return {}; // \d, \w, \b...
+
+            literal += body[++i];
+        } else if (isRegexSpecial(body[i]))
+            return {};
+        else
+            literal += body[i];
+    }
+
+    return literal;
+}
+
+CRuleRegex::CRuleRegex(const std::string& pattern) {
+    std::string_view body = pattern;
+
+    const bool       ANCHOREDSTART = body.starts_with('^');
+    if (ANCHOREDSTART)
+        body.remove_prefix(1);
+
+    bool anchoredEnd = false;
+    if (body.ends_with('$')) {
+        // \$ is a literal dollar sign, \\$ an anchor
+        size_t backslashes = 0;
+        while (backslashes + 1 < body.size() && body[body.size() - 2 - backslashes] == '\\')
+            backslashes++;
+
+        anchoredEnd = backslashes % 2 == 0;
+        if (anchoredEnd)
+            body.remove_suffix(1);
+    }
+
+    // the wiki's ^(name)$, a group around a single literal doesn't change what's matched
+    if (body.size() >= 2 && body.front() == '(' && body.back() == ')' && !body.ends_with("\\)"))
+        body = body.substr(1, body.size() - 2);
+
+    // .* matches at any position, but ^.*$ has to span the whole string, and . doesn't match newlines
+    if (body == ".*" && !(ANCHOREDSTART && anchoredEnd))
+        return;
+
+    if (const auto LITERAL = unescapeLiteral(body); LITERAL.has_value()) {
+        m_szLiteral = *LITERAL;
+
+        if (ANCHOREDSTART && anchoredEnd)
+            m_eType = MATCH_EXACT;
+        else if (ANCHOREDSTART)
+            m_eType = MATCH_PREFIX;
+        else if (anchoredEnd)
+            m_eType = MATCH_SUFFIX;
+        else
+            m_eType = m_szLiteral.empty() ? MATCH_ANY : MATCH_CONTAINS;
+
+        return;
+    }
+
+    m_rRegex = std::regex(pattern);
+    m_eType  = MATCH_REGEX;
+}
+
+bool CRuleRegex::matches(const std::string& str) const {
+    switch (m_eType) {
+        case MATCH_ANY: return true;
+        case MATCH_CONTAINS: return str.find(m_szLiteral) != std::string::npos;
+        case MATCH_PREFIX: return str.starts_with(m_szLiteral);
+        case MATCH_SUFFIX: return str.ends_with(m_szLiteral);
+        case MATCH_EXACT: return str == m_szLiteral;
+        case MATCH_REGEX: return std::regex_search(str, *m_rRegex);
+    }
+
+    return false;
+}
+
+uint32_t SWindowRuleInputs::diff(const SWindowRuleInputs& other) const {
+    uint32_t changed = RULE_DEP_NONE;
+
+    if (szClass != other.szClass)
+        changed |= RULE_DEP_CLASS;
+    if (szTitle != other.szTitle)
+        changed |= RULE_DEP_TITLE;
+    if (szInitialClass != other.szInitialClass)
+        changed |= RULE_DEP_INITIAL_CLASS;
+    if (szInitialTitle != other.szInitialTitle)
+        changed |= RULE_DEP_INITIAL_TITLE;
+    if (bX11 != other.bX11)
+        changed |= RULE_DEP_XWAYLAND;
+    if (bFloating != other.bFloating)
+        changed |= RULE_DEP_FLOATING;
+    if (bFullscreen != other.bFullscreen)
+        changed |= RULE_DEP_FULLSCREEN;
+    if (bPinned != other.bPinned)
+        changed |= RULE_DEP_PINNED;
+    if (bFocused != other.bFocused)
+        changed |= RULE_DEP_FOCUS;
+    if (bWorkspace != other.bWorkspace || iWorkspaceID != other.iWorkspaceID || szWorkspaceName != other.szWorkspaceName)
+        changed |= RULE_DEP_WORKSPACE;
+
+    return changed;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+// window properties a rule reads, to only re-evaluate the rules whose inputs changed
+enum eRuleDependency : uint32_t {
+    RULE_DEP_NONE          = 0,
+    RULE_DEP_CLASS         = 1 << 0,
+    RULE_DEP_TITLE         = 1 << 1,
+    RULE_DEP_INITIAL_CLASS = 1 << 2,
+    RULE_DEP_INITIAL_TITLE = 1 << 3,
+    RULE_DEP_XWAYLAND      = 1 << 4,
+    RULE_DEP_FLOATING      = 1 << 5,
+    RULE_DEP_FULLSCREEN    = 1 << 6,
+    RULE_DEP_PINNED        = 1 << 7,
+    RULE_DEP_FOCUS         = 1 << 8,
+    RULE_DEP_WORKSPACE     = 1 << 9,
+    // can change without the window changing: tags set by earlier rules, onworkspace selectors (window counts...)
+    RULE_DEP_VOLATILE = 1 << 10,
+    RULE_DEP_ALL      = ~0u,
+};
+
+/*
+    A regex_search() pattern, compiled once.
+    Most rules are plain names ("kitty", "^(firefox)$", "^org\.gnome\.Nautilus$"), those
+    are matched with string compares and never reach std::regex.
+*/
+class CRuleRegex {
+  public:
+    CRuleRegex() = default; // matches anything
+
+    // throws std::regex_error if the pattern is invalid
+    explicit CRuleRegex(const std::string& pattern);
+
+    bool matches(const std::string& str) const;
+
+  private:
+    enum eMatchType {
+        MATCH_ANY = 0,
+        MATCH_CONTAINS,
+        MATCH_PREFIX,
+        MATCH_SUFFIX,
+        MATCH_EXACT,
+        MATCH_REGEX,
+    };
+
+    eMatchType                m_eType = MATCH_ANY;
+    std::string               m_szLiteral;
+    std::optional<std::regex> m_rRegex;
+};
+
+struct SCompiledWindowRule {
+    CRuleRegex             classRegex;
+    CRuleRegex             titleRegex;
+    CRuleRegex             initialClassRegex;
+    CRuleRegex             initialTitleRegex;
+    std::optional<int64_t> workspaceID;  // for workspace:<id>, workspace:name:<name> compares the name
+    uint32_t               dependencies = RULE_DEP_NONE;
+};
+
+// what a window looked like to the rules
+struct SWindowRuleInputs {
+    std::string szClass;
+    std::string szTitle;
+    std::string szInitialClass;
+    std::string szInitialTitle;
+    bool        bX11        = false;
+    bool        bFloating   = false;
+    bool        bFullscreen = false;
+    bool        bPinned     = false;
+    bool        bFocused    = false;
+    bool        bWorkspace  = false;
+    int64_t     iWorkspaceID = 0;
+    std::string szWorkspaceName;
+
+    // eRuleDependency mask of what differs
+    uint32_t diff(const SWindowRuleInputs& other) const;
+};
+
+// last dynamic evaluation of the window rules for a window
+struct SWindowRuleMatchCache {
+    uint64_t          generation = 0; // CConfigManager::m_iWindowRulesGeneration, 0 is never valid
+    SWindowRuleInputs inputs;
+    std::vector<bool> matched;
+};
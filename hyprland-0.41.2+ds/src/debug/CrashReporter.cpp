@@ -228,5 +228,6 @@ void CrashReporter::createAndSaveCrash(int sig) {
 
     finalCrashReport += "\n\nLog tail:\n";
 
-    finalCrashReport += std::string_view(Debug::rollingLog).substr(Debug::rollingLog.find("\n") + 1);
+    const auto ROLLINGLOG = Debug::rollingLogTail(true);
+    finalCrashReport += std::string_view(ROLLINGLOG).substr(ROLLINGLOG.find("\n") + 1);
 }
@@ -11,7 +11,7 @@
 #include <sys/utsname.h>
 #include <sys/un.h>
 #include <unistd.h>
-#include <sys/poll.h>
+#include <fcntl.h>
 
 #include <sstream>
 #include <string>
@@ -750,10 +750,10 @@ std::string rollinglogRequest(eHyprCtlOutputFormat format, std::string request)
 
     if (format == eHyprCtlOutputFormat::FORMAT_JSON) {
         result += "[\n\"log\":\"";
-        result += escapeJSONStrings(Debug::rollingLog);
+        result += escapeJSONStrings(Debug::rollingLogTail());
         result += "\"]";
     } else {
-        result = Debug::rollingLog;
+        result = Debug::rollingLogTail();
     }
 
     return result;
@@ -1290,6 +1290,7 @@ std::string dispatchSetProp(eHyprCtlOutputFormat format, std::string request) {
     } catch (std::exception& e) { return "error in parsing prop value: " + std::string(e.what()); }
 
     g_pCompositor->updateAllWindowsAnimatedDecorationValues();
+    g_pCompositor->m_windowHitIndex.invalidate(PWINDOW);
 
     if (!(PWINDOW->m_sAdditionalConfigData.noFocus.toUnderlying() == noFocus.toUnderlying())) {
         g_pCompositor->focusWindow(nullptr);
@@ -1629,8 +1630,15 @@ CHyprCtl::CHyprCtl() {
 }
 
 CHyprCtl::~CHyprCtl() {
+    while (!m_vClients.empty()) {
+        removeClient(m_vClients.back().get());
+    }
+
     if (m_eventSource)
         wl_event_source_remove(m_eventSource);
+
+    if (m_iSocketFD >= 0)
+        close(m_iSocketFD);
 }
 
 SP<SHyprCtlCommand> CHyprCtl::registerCommand(SHyprCtlCommand cmd) {
@@ -1775,72 +1783,185 @@ bool isFollowUpRollingLogRequest(const std::string& request) {
     return request.contains("rollinglog") && request.contains("f");
 }
 
-int hyprCtlFDTick(int fd, uint32_t mask, void* data) {
+// a client that doesn't make progress for this long is dropped
+constexpr int    CLIENT_TIMEOUT_MS = 5000;
+constexpr size_t MAX_CLIENTS       = 64;
+constexpr size_t MAX_REQUEST_SIZE  = 1024 * 1024;
+
+int CHyprCtl::onServerEvent(int fd, uint32_t mask, void* data) {
     if (mask & WL_EVENT_ERROR || mask & WL_EVENT_HANGUP)
         return 0;
 
-    sockaddr_in            clientAddress;
-    socklen_t              clientSize = sizeof(clientAddress);
+    g_pHyprCtl->acceptClients();
+    return 0;
+}
 
-    const auto             ACCEPTEDCONNECTION = accept4(g_pHyprCtl->m_iSocketFD, (sockaddr*)&clientAddress, &clientSize, SOCK_CLOEXEC);
+int CHyprCtl::onClientEvent(int fd, uint32_t mask, void* data) {
+    const auto PCLIENT = (SClient*)data;
 
-    std::array<char, 1024> readBuffer;
+    if (mask & WL_EVENT_READABLE) {
+        g_pHyprCtl->readRequest(PCLIENT);
+        return 0;
+    }
 
-    //
-    pollfd pollfds[1] = {
-        {
-            .fd     = ACCEPTEDCONNECTION,
-            .events = POLLIN,
-        },
-    };
+    if (mask & WL_EVENT_WRITABLE) {
+        g_pHyprCtl->writeReply(PCLIENT);
+        return 0;
+    }
 
-    int ret = poll(pollfds, 1, 5000);
+    if (mask & WL_EVENT_ERROR || mask & WL_EVENT_HANGUP)
+        g_pHyprCtl->removeClient(PCLIENT);
 
-    if (ret <= 0) {
-        close(ACCEPTEDCONNECTION);
-        return 0;
+    return 0;
+}
+
+int CHyprCtl::onClientTimeout(void* data) {
+    const auto PCLIENT = (SClient*)data;
+
+    Debug::log(WARN, "hyprctl client at fd {} timed out, dropping it", PCLIENT->fd);
+    g_pHyprCtl->removeClient(PCLIENT);
+
+    return 0;
+}
+
+void CHyprCtl::acceptClients() {
+    while (true) {
+        const auto ACCEPTEDCONNECTION = accept4(m_iSocketFD, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+        if (ACCEPTEDCONNECTION < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                Debug::log(ERR, "hyprctl socket failed receiving a connection, errno: {}", errno);
+            return;
+        }
+
+        if (m_vClients.size() >= MAX_CLIENTS) {
+            Debug::log(WARN, "Too many hyprctl clients, refusing fd {}", ACCEPTEDCONNECTION);
+            close(ACCEPTEDCONNECTION);
+            continue;
+        }
+
+        const auto PCLIENT = m_vClients.emplace_back(std::make_unique<SClient>()).get();
+        PCLIENT->fd        = ACCEPTEDCONNECTION;
+
+        PCLIENT->eventSource   = wl_event_loop_add_fd(g_pCompositor->m_sWLEventLoop, ACCEPTEDCONNECTION, WL_EVENT_READABLE, onClientEvent, PCLIENT);
+        PCLIENT->timeoutSource = wl_event_loop_add_timer(g_pCompositor->m_sWLEventLoop, onClientTimeout, PCLIENT);
+        wl_event_source_timer_update(PCLIENT->timeoutSource, CLIENT_TIMEOUT_MS);
     }
+}
+
+void CHyprCtl::readRequest(SClient* client) {
+    std::array<char, 8192> readBuffer;
+    bool                   complete = false;
 
-    std::string request;
     while (true) {
-        readBuffer.fill(0);
-        auto messageSize = read(ACCEPTEDCONNECTION, readBuffer.data(), 1023);
-        if (messageSize < 1)
-            break;
-        std::string recvd = readBuffer.data();
-        request += recvd;
-        if (messageSize < 1023)
+        const auto LEN = read(client->fd, readBuffer.data(), readBuffer.size());
+
+        if (LEN > 0) {
+            client->request.append(readBuffer.data(), LEN);
+
+            if (client->request.size() > MAX_REQUEST_SIZE) {
+                Debug::log(WARN, "hyprctl request at fd {} is over {} bytes, dropping it", client->fd, MAX_REQUEST_SIZE);
+                removeClient(client);
+                return;
+            }
+
+            continue;
+        }
+
+        if (LEN < 0 && errno == EINTR)
+            continue;
+
+        if (LEN < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // clients send the request in one write and wait for the reply, so it's complete once we've read everything there is
+            complete = !client->request.empty();
             break;
+        }
+
+        // eof or error. Nothing to reply to if nothing came.
+        if (client->request.empty()) {
+            removeClient(client);
+            return;
+        }
+
+        complete = true;
+        break;
     }
 
-    std::string reply = "";
+    if (!complete) {
+        wl_event_source_timer_update(client->timeoutSource, CLIENT_TIMEOUT_MS);
+        return;
+    }
 
     try {
-        reply = g_pHyprCtl->getReply(request);
+        client->reply = getReply(client->request);
     } catch (std::exception& e) {
         Debug::log(ERR, "Error in request: {}", e.what());
-        reply = "Err: " + std::string(e.what());
+        client->reply = "Err: " + std::string(e.what());
     }
 
-    successWrite(ACCEPTEDCONNECTION, reply);
-
-    if (isFollowUpRollingLogRequest(request)) {
-        Debug::log(LOG, "Followup rollinglog request received. Starting thread to write to socket.");
-        Debug::RollingLogFollow::Get().StartFor(ACCEPTEDCONNECTION);
-        runWritingDebugLogThread(ACCEPTEDCONNECTION);
-        Debug::log(LOG, Debug::RollingLogFollow::Get().DebugInfo());
-    } else
-        close(ACCEPTEDCONNECTION);
+    client->followLog = isFollowUpRollingLogRequest(client->request);
 
     if (g_pConfigManager->m_bWantsMonitorReload)
         g_pConfigManager->ensureMonitorStatus();
 
-    return 0;
+    // most replies fit in the socket buffer, only wait for the fd if this one didn't
+    wl_event_source_fd_update(client->eventSource, 0);
+    writeReply(client);
+}
+
+void CHyprCtl::writeReply(SClient* client) {
+    while (client->replyWritten < client->reply.size()) {
+        const auto LEN = write(client->fd, client->reply.data() + client->replyWritten, client->reply.size() - client->replyWritten);
+
+        if (LEN < 0 && errno == EINTR)
+            continue;
+
+        if (LEN < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            wl_event_source_fd_update(client->eventSource, WL_EVENT_WRITABLE);
+            wl_event_source_timer_update(client->timeoutSource, CLIENT_TIMEOUT_MS);
+            return;
+        }
+
+        if (LEN <= 0) {
+            Debug::log(ERR, "Couldn't write to socket. Error: {}", strerror(errno));
+            removeClient(client);
+            return;
+        }
+
+        client->replyWritten += LEN;
+    }
+
+    if (!client->followLog) {
+        removeClient(client);
+        return;
+    }
+
+    // the follow thread owns the connection from now on, and writes to it blocking
+    const int CONN = client->fd;
+    client->fd     = -1;
+    removeClient(client);
+
+    fcntl(CONN, F_SETFL, fcntl(CONN, F_GETFL) & ~O_NONBLOCK);
+
+    Debug::log(LOG, "Followup rollinglog request received. Starting thread to write to socket.");
+    Debug::RollingLogFollow::Get().StartFor(CONN);
+    runWritingDebugLogThread(CONN);
+    Debug::log(LOG, Debug::RollingLogFollow::Get().DebugInfo());
+}
+
+void CHyprCtl::removeClient(SClient* client) {
+    wl_event_source_remove(client->eventSource);
+    wl_event_source_remove(client->timeoutSource);
+
+    if (client->fd >= 0)
+        close(client->fd);
+
+    std::erase_if(m_vClients, [client](const auto& other) { return other.get() == client; });
 }
 
 void CHyprCtl::startHyprCtlSocket() {
 
-    m_iSocketFD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    m_iSocketFD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
 
     if (m_iSocketFD < 0) {
         Debug::log(ERR, "Couldn't start the Hyprland Socket. (1) IPC will not work.");
@@ -1863,5 +1984,5 @@ void CHyprCtl::startHyprCtlSocket() {
 
     Debug::log(LOG, "Hypr socket started at {}", socketPath);
 
-    m_eventSource = wl_event_loop_add_fd(g_pCompositor->m_sWLEventLoop, m_iSocketFD, WL_EVENT_READABLE, hyprCtlFDTick, nullptr);
+    m_eventSource = wl_event_loop_add_fd(g_pCompositor->m_sWLEventLoop, m_iSocketFD, WL_EVENT_READABLE, onServerEvent, nullptr);
 }
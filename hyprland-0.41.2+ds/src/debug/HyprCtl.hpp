@@ -23,10 +23,30 @@ class CHyprCtl {
     } m_sCurrentRequestParams;
 
   private:
-    void                             startHyprCtlSocket();
-
-    std::vector<SP<SHyprCtlCommand>> m_vCommands;
-    wl_event_source*                 m_eventSource = nullptr;
+    // one connection, a request comes in, the reply goes out, then it's closed (or handed over to rollinglog -f)
+    struct SClient {
+        int              fd = -1;
+        std::string      request;
+        std::string      reply;
+        size_t           replyWritten  = 0;
+        bool             followLog     = false;
+        wl_event_source* eventSource   = nullptr;
+        wl_event_source* timeoutSource = nullptr;
+    };
+
+    static int                            onServerEvent(int fd, uint32_t mask, void* data);
+    static int                            onClientEvent(int fd, uint32_t mask, void* data);
+    static int                            onClientTimeout(void* data);
+
+    void                                  startHyprCtlSocket();
+    void                                  acceptClients();
+    void                                  readRequest(SClient* client);
+    void                                  writeReply(SClient* client);
+    void                                  removeClient(SClient* client);
+
+    std::vector<SP<SHyprCtlCommand>>      m_vCommands;
+    std::vector<std::unique_ptr<SClient>> m_vClients;
+    wl_event_source*                      m_eventSource = nullptr;
 };
 
 inline std::unique_ptr<CHyprCtl> g_pHyprCtl;
@@ -3,11 +3,321 @@
 #include "../Compositor.hpp"
 #include "RollingLogFollow.hpp"
 
-#include <fstream>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr size_t LOG_SLOT_SIZE          = 256;
+constexpr size_t LOG_SLOTS              = 4096; // power of 2, 1MiB in total
+constexpr size_t LOG_MAX_SLOTS_PER_LINE = LOG_SLOTS / 8;
+constexpr size_t LOG_WRITE_BATCH        = 64; // slots per writev
+
+/*
+    The log file is written by a background thread. log() copies the line into a preallocated ring of fixed size
+    slots (long lines take consecutive ones) and returns, the writer drains the ring with writev() on a file it keeps open.
+    Any thread can log. When the writer can't keep up, lines are dropped and counted instead of blocking the caller,
+    the count ends up in the file.
+    On a crash the handler drains the ring itself (flushFromSignal), the writer thread won't get to run again.
+*/
+class CAsyncLogWriter {
+  public:
+    CAsyncLogWriter() {
+        m_pSlots = std::make_unique<SSlot[]>(LOG_SLOTS);
+        for (size_t i = 0; i < LOG_SLOTS; ++i) {
+            m_pSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~CAsyncLogWriter() {
+        stop();
+    }
+
+    void start(const std::string& path) {
+        if (m_bRunning)
+            return;
+
+        m_szPath  = path;
+        m_iWakeFD = eventfd(0, EFD_CLOEXEC);
+        if (m_iWakeFD < 0) {
+            std::cerr << "[ERR] Couldn't create the log eventfd, logging to the file is disabled\n";
+            return;
+        }
+
+        m_bRunning = true;
+        m_tWriter  = std::thread([this] { writerMain(); });
+    }
+
+    // writes what's left and joins the writer
+    void stop() {
+        if (!m_bRunning.exchange(false))
+            return;
+
+        wake();
+        m_tWriter.join();
+
+        close(m_iWakeFD);
+        m_iWakeFD = -1;
+        if (m_iFileFD >= 0) {
+            close(m_iFileFD);
+            m_iFileFD = -1;
+        }
+    }
+
+    // writes what's queued on the calling thread, only uses async-signal-safe calls
+    void flushFromSignal() {
+        if (!m_bRunning)
+            return;
+
+        // the writer may be in the middle of a batch. If it doesn't let go, it's the one that crashed
+        const timespec WAIT = {.tv_sec = 0, .tv_nsec = 1000000};
+        int            tries = 0;
+        while (m_bDraining.exchange(true, std::memory_order_acquire)) {
+            if (++tries > 100)
+                return;
+
+            nanosleep(&WAIT, nullptr);
+        }
+
+        drain();
+        m_bDraining.store(false, std::memory_order_release);
+    }
+
+    // a newline is added
+    void push(std::string_view line) {
+        if (!m_bRunning)
+            return;
+
+        const size_t TOTAL = std::min(line.size() + 1, LOG_MAX_SLOTS_PER_LINE * LOG_SLOT_SIZE);
+        const size_t COUNT = (TOTAL + LOG_SLOT_SIZE - 1) / LOG_SLOT_SIZE;
+
+        // reserve COUNT consecutive slots. They're freed in order, so if the last one is free all of them are.
+        uint64_t pos = m_iEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            const auto    LAST = pos + COUNT - 1;
+            const int64_t DIFF = (int64_t)m_pSlots[LAST & (LOG_SLOTS - 1)].sequence.load(std::memory_order_acquire) - (int64_t)LAST;
+
+            if (DIFF == 0) {
+                if (m_iEnqueuePos.compare_exchange_weak(pos, pos + COUNT, std::memory_order_relaxed))
+                    break;
+            } else if (DIFF < 0) {
+                m_iDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else
+                pos = m_iEnqueuePos.load(std::memory_order_relaxed);
+        }
+
+        // the last byte is the newline, the line is cut if it didn't fit
+        const size_t FROMLINE = TOTAL - 1;
+        for (size_t i = 0, offset = 0; i < COUNT; ++i, offset += LOG_SLOT_SIZE) {
+            auto&        slot   = m_pSlots[(pos + i) & (LOG_SLOTS - 1)];
+            const size_t LENGTH = std::min(LOG_SLOT_SIZE, TOTAL - offset);
+
+            std::memcpy(slot.data, line.data() + offset, std::min(LENGTH, FROMLINE - offset));
+            if (offset + LENGTH == TOTAL)
+                slot.data[LENGTH - 1] = '\n';
+
+            slot.length  = LENGTH;
+            slot.lineEnd = offset + LENGTH == TOTAL;
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+
+        wake();
+    }
+
+  private:
+    struct SSlot {
+        std::atomic<uint64_t> sequence = 0; // position + 1 when it holds data for position, position + LOG_SLOTS when free again
+        size_t                length   = 0;
+        bool                  lineEnd  = false; // last slot of its line
+        char                  data[LOG_SLOT_SIZE];
+    };
+
+    // once per batch, the exchange also makes what was pushed before visible to the writer
+    void wake() {
+        if (m_bWakePending.exchange(true))
+            return;
+
+        uint64_t one = 1;
+        if (write(m_iWakeFD, &one, sizeof(one)) < 0)
+            m_bWakePending = false;
+    }
+
+    void writerMain() {
+        while (true) {
+            uint64_t value = 0;
+            if (read(m_iWakeFD, &value, sizeof(value)) < 0 && errno != EINTR)
+                break;
+
+            // before draining, so that lines pushed meanwhile wake us up again
+            m_bWakePending.exchange(false);
+
+            drainExclusive();
+
+            if (!m_bRunning)
+                break;
+        }
+
+        drainExclusive();
+    }
+
+    // the crash handler can drain too
+    void drainExclusive() {
+        while (m_bDraining.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+
+        drain();
+        m_bDraining.store(false, std::memory_order_release);
+    }
+
+    void drain() {
+        std::array<iovec, LOG_WRITE_BATCH> iov;
+
+        while (true) {
+            uint64_t pos   = m_iDequeuePos;
+            size_t   count = 0;
+            while (count < LOG_WRITE_BATCH) {
+                auto& slot = m_pSlots[pos & (LOG_SLOTS - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                    break;
+
+                iov[count++] = {slot.data, slot.length};
+                m_bMidLine   = !slot.lineEnd;
+                pos++;
+            }
+
+            if (count == 0)
+                break;
+
+            writeAll(iov.data(), count);
+
+            for (auto p = m_iDequeuePos; p < pos; ++p) {
+                m_pSlots[p & (LOG_SLOTS - 1)].sequence.store(p + LOG_SLOTS, std::memory_order_release);
+            }
+
+            m_iDequeuePos = pos;
+        }
+
+        // the rest of a long line may still be getting copied, the note waits for it
+        if (m_bMidLine)
+            return;
+
+        // no allocation, this can run in a signal handler
+        if (const auto DROPPED = m_iDropped.exchange(0); DROPPED > 0) {
+            char       number[24];
+            const auto END    = std::to_chars(number, number + sizeof(number), DROPPED).ptr;
+            char       head[] = "[WARN] Logging couldn't keep up, ";
+            char       tail[] = " lines were dropped\n";
+            iovec      vec[]  = {{head, sizeof(head) - 1}, {number, (size_t)(END - number)}, {tail, sizeof(tail) - 1}};
+            writeAll(vec, 3);
+        }
+    }
+
+    void writeAll(iovec* iov, size_t count) {
+        if (m_iFileFD < 0) {
+            m_iFileFD = open(m_szPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (m_iFileFD < 0)
+                return;
+        }
+
+        while (count > 0) {
+            const auto WRITTEN = writev(m_iFileFD, iov, count);
+            if (WRITTEN < 0) {
+                if (errno == EINTR)
+                    continue;
+                return; // disk full or such, there's no one to tell
+            }
+
+            // short write, skip what's done
+            size_t left = WRITTEN;
+            while (count > 0 && left >= iov->iov_len) {
+                left -= iov->iov_len;
+                iov++;
+                count--;
+            }
+
+            if (count > 0) {
+                iov->iov_base = (char*)iov->iov_base + left;
+                iov->iov_len -= left;
+            }
+        }
+    }
+
+    std::unique_ptr<SSlot[]> m_pSlots;
+    alignas(64) std::atomic<uint64_t> m_iEnqueuePos = 0;
+    alignas(64) uint64_t m_iDequeuePos              = 0; // whoever holds m_bDraining
+    bool                  m_bMidLine                = false; // whoever holds m_bDraining
+    std::atomic<bool>     m_bDraining               = false;
+    std::atomic<uint64_t> m_iDropped                = 0;
+    std::atomic<bool>     m_bWakePending            = false;
+    std::atomic<bool>     m_bRunning                = false;
+    int                   m_iWakeFD                 = -1;
+    int                   m_iFileFD                 = -1;
+    std::string           m_szPath;
+    std::thread           m_tWriter;
+};
+
+static CAsyncLogWriter asyncLogWriter;
+
+// fixed circular buffer for the rolling log
+static std::mutex rollingLogMutex;
+static char       rollingLogBuffer[ROLLING_LOG_SIZE];
+static size_t     rollingLogWritten = 0; // in total, the next byte goes to % ROLLING_LOG_SIZE
+
+static void appendRollingLog(std::string_view str) {
+    std::lock_guard<std::mutex> lg(rollingLogMutex);
+
+    // only the tail of a huge line can stay
+    if (str.size() >= ROLLING_LOG_SIZE) {
+        rollingLogWritten += str.size() - (ROLLING_LOG_SIZE - 1);
+        str = str.substr(str.size() - (ROLLING_LOG_SIZE - 1));
+    }
+
+    for (const auto& part : {str, std::string_view{"\n"}}) {
+        const size_t START = rollingLogWritten % ROLLING_LOG_SIZE;
+        const size_t FIRST = std::min(part.size(), ROLLING_LOG_SIZE - START);
+        std::memcpy(rollingLogBuffer + START, part.data(), FIRST);
+        std::memcpy(rollingLogBuffer, part.data() + FIRST, part.size() - FIRST);
+        rollingLogWritten += part.size();
+    }
+}
+
+std::string Debug::rollingLogTail(bool fromSignal) {
+    // the crashing thread may be the one holding the lock, a torn tail beats a deadlock
+    std::unique_lock<std::mutex> lk(rollingLogMutex, std::defer_lock);
+    if (fromSignal)
+        (void)lk.try_lock();
+    else
+        lk.lock();
+
+    if (rollingLogWritten <= ROLLING_LOG_SIZE)
+        return std::string(rollingLogBuffer, rollingLogWritten);
+
+    const size_t START = rollingLogWritten % ROLLING_LOG_SIZE;
+    std::string  tail;
+    tail.reserve(ROLLING_LOG_SIZE);
+    tail.append(rollingLogBuffer + START, ROLLING_LOG_SIZE - START);
+    tail.append(rollingLogBuffer, START);
+    return tail;
+}
+
+void Debug::flushFromSignal() {
+    asyncLogWriter.flushFromSignal();
+}
 
 void Debug::init(const std::string& IS) {
     logFile = IS + (ISDEBUG ? "/hyprlandd.log" : "/hyprland.log");
+
+    asyncLogWriter.start(logFile);
 }
 
 void Debug::wlrLog(wlr_log_importance level, const char* fmt, va_list args) {
@@ -21,14 +331,10 @@ void Debug::wlrLog(wlr_log_importance level, const char* fmt, va_list args) {
     std::string output = std::string(outputStr);
     free(outputStr);
 
-    rollingLog += output + "\n";
+    appendRollingLog(output);
 
-    if (!disableLogs || !**disableLogs) {
-        std::ofstream ofs;
-        ofs.open(logFile, std::ios::out | std::ios::app);
-        ofs << "[wlr] " << output << "\n";
-        ofs.close();
-    }
+    if (!disableLogs || !**disableLogs)
+        asyncLogWriter.push("[wlr] " + output);
 
     if (!disableStdout)
         std::cout << output << "\n";
@@ -70,21 +376,14 @@ void Debug::log(LogLevel level, std::string str) {
         default: break;
     }
 
-    rollingLog += str + "\n";
-    if (rollingLog.size() > ROLLING_LOG_SIZE)
-        rollingLog = rollingLog.substr(rollingLog.size() - ROLLING_LOG_SIZE);
+    appendRollingLog(str);
 
     if (RollingLogFollow::Get().IsRunning())
         RollingLogFollow::Get().AddLog(str);
 
-    if (!disableLogs || !**disableLogs) {
-        // log to a file
-        std::ofstream ofs;
-        ofs.open(logFile, std::ios::out | std::ios::app);
-        ofs << str << "\n";
-
-        ofs.close();
-    }
+    // log to a file
+    if (!disableLogs || !**disableLogs)
+        asyncLogWriter.push(str);
 
     // log it to the stdout too.
     if (!disableStdout)
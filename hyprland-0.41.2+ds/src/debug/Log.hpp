@@ -29,10 +29,14 @@ namespace Debug {
     inline bool            shuttingDown  = false;
     inline int64_t* const* coloredLogs   = nullptr;
 
-    inline std::string     rollingLog = ""; // rolling log contains the ROLLING_LOG_SIZE tail of the log
-
     void                   init(const std::string& IS);
 
+    // the ROLLING_LOG_SIZE tail of the log. fromSignal: don't wait for the lock, for the crash handler
+    std::string rollingLogTail(bool fromSignal = false);
+
+    // writes whatever the log file writer didn't get to yet, from the crash handler
+    void flushFromSignal();
+
     //
     void log(LogLevel level, std::string str);
 
@@ -4,10 +4,13 @@
 #include "../defines.hpp"
 #include "WLSurface.hpp"
 #include "../helpers/AnimatedVariable.hpp"
+#include "../config/RuleMatcher.hpp"
 
 struct SLayerRule {
     std::string targetNamespace = "";
     std::string rule            = "";
+
+    SP<CRuleRegex> namespaceRegex; // set by CConfigManager when the rule is added
 };
 
 class CLayerShellResource;
@@ -57,6 +57,10 @@ void CPopup::initAllSignals() {
 void CPopup::onNewPopup(SP<CXDGPopupResource> popup) {
     const auto POPUP = m_vChildren.emplace_back(std::make_unique<CPopup>(popup, this)).get();
     Debug::log(LOG, "New popup at {:x}", (uintptr_t)POPUP);
+
+    // windows with popups are candidates everywhere
+    if (!m_pWindowOwner.expired())
+        g_pCompositor->m_windowHitIndex.invalidate(m_pWindowOwner.lock());
 }
 
 void CPopup::onDestroy() {
@@ -65,6 +69,9 @@ void CPopup::onDestroy() {
     if (!m_pParent)
         return; // head node
 
+    if (!m_pWindowOwner.expired())
+        g_pCompositor->m_windowHitIndex.invalidate(m_pWindowOwner.lock());
+
     std::erase_if(m_pParent->m_vChildren, [this](const auto& other) { return other.get() == this; });
 }
 
@@ -303,6 +310,10 @@ void CPopup::breadthfirst(std::function<void(CPopup*, void*)> fn, void* data) {
     bfHelper(popups, fn, data);
 }
 
+bool CPopup::hasChildren() {
+    return !m_vChildren.empty();
+}
+
 CPopup* CPopup::at(const Vector2D& globalCoords, bool allowsInput) {
     std::vector<CPopup*> popups;
     breadthfirst([](CPopup* popup, void* data) { ((std::vector<CPopup*>*)data)->push_back(popup); }, &popups);
@@ -33,6 +33,7 @@ class CPopup {
     void     recheckTree();
 
     bool     visible();
+    bool     hasChildren();
 
     // will also loop over this node
     void    breadthfirst(std::function<void(CPopup*, void*)> fn, void* data);
@@ -557,6 +557,10 @@ void CWindow::onMap() {
 
     m_fBorderAngleAnimationProgress.setCallbackOnEnd([&](void* ptr) { onBorderAngleAnimEnd(ptr); }, false);
 
+    // warps don't go through the animation manager
+    m_vRealPosition.setUpdateCallback([this](void*) { g_pCompositor->m_windowHitIndex.invalidate(m_pSelf.lock()); });
+    m_vRealSize.setUpdateCallback([this](void*) { g_pCompositor->m_windowHitIndex.invalidate(m_pSelf.lock()); });
+
     m_fBorderAngleAnimationProgress.setValueAndWarp(0.f);
     m_fBorderAngleAnimationProgress = 1.f;
 
@@ -819,6 +823,7 @@ void CWindow::updateDynamicRules() {
 
     EMIT_HOOK_EVENT("windowUpdateRules", m_pSelf.lock());
 
+    g_pCompositor->m_windowHitIndex.invalidate(m_pSelf.lock());
     g_pLayoutManager->getCurrentLayout()->recalculateMonitor(m_iMonitorID);
 }
 
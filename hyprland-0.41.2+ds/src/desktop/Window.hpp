@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../config/ConfigDataValues.hpp"
+#include "../config/RuleMatcher.hpp"
 #include "../defines.hpp"
 #include "../helpers/AnimatedVariable.hpp"
 #include "../helpers/math/Math.hpp"
@@ -198,6 +199,8 @@ struct SWindowRule {
     int         bFocus        = -1;
     std::string szOnWorkspace = ""; // empty means any
     std::string szWorkspace   = ""; // empty means any
+
+    SP<SCompiledWindowRule> compiled; // set by CConfigManager when the rule is added
 };
 
 struct SInitialWorkspaceToken {
@@ -376,6 +379,9 @@ class CWindow {
     // stores the currently matched window rules
     std::vector<SWindowRule> m_vMatchedRules;
 
+    // for re-evaluating only the rules that depend on what changed
+    SWindowRuleMatchCache m_sRuleMatchCache;
+
     // window tags
     CTagKeeper m_tags;
 
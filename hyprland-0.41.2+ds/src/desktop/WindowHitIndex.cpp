@@ -0,0 +1,197 @@
+#include "WindowHitIndex.hpp"
+#include "../Compositor.hpp"
+#include "../config/ConfigValue.hpp"
+#include "Popup.hpp"
+#include <algorithm>
+#include <cmath>
+
+// layout px. Small enough for a few windows per cell, big enough for a handful of cells per window
+constexpr double CELL_SIZE = 128;
+
+static int64_t borderGrabArea() {
+    static auto PRESIZEONBORDER   = CConfigValue<Hyprlang::INT>("general:resize_on_border");
+    static auto PBORDERSIZE       = CConfigValue<Hyprlang::INT>("general:border_size");
+    static auto PBORDERGRABEXTEND = CConfigValue<Hyprlang::INT>("general:extend_border_grab_area");
+
+    return *PRESIZEONBORDER ? *PBORDERSIZE + *PBORDERGRABEXTEND : 0;
+}
+
+// offset from the grid origin to a column / row, clamped. NaN goes to 0.
+static int cellCoord(double offset, int cells) {
+    if (!(offset > 0))
+        return 0;
+
+    return (int)std::min(offset / CELL_SIZE, (double)(cells - 1));
+}
+
+void CWindowHitIndex::invalidate(PHLWINDOW pWindow) {
+    if (!m_bBuilt || !pWindow)
+        return;
+
+    const auto IT = m_mIndices.find(pWindow.get());
+    if (IT == m_mIndices.end()) {
+        m_bBuilt = false; // not indexed yet, m_vWindows is about to change
+        return;
+    }
+
+    auto& entry = m_vWindows[IT->second];
+    if (entry.dirty)
+        return;
+
+    entry.dirty = true;
+    m_vDirty.push_back(IT->second);
+}
+
+void CWindowHitIndex::invalidateAll() {
+    m_bBuilt = false;
+}
+
+bool CWindowHitIndex::isValid() {
+    if (!m_bBuilt || m_iBorderGrabArea != borderGrabArea() || m_vWindows.size() != g_pCompositor->m_vWindows.size())
+        return false;
+
+    if (m_vGrids.size() != g_pCompositor->m_vMonitors.size())
+        return false;
+
+    for (size_t i = 0; i < m_vGrids.size(); ++i) {
+        const auto& PMONITOR = g_pCompositor->m_vMonitors[i];
+        if (m_vGrids[i].monitorID != PMONITOR->ID || !(m_vGrids[i].box.pos() == PMONITOR->vecPosition) || !(m_vGrids[i].box.size() == PMONITOR->vecSize))
+            return false;
+    }
+
+    return true;
+}
+
+void CWindowHitIndex::rebuild() {
+    m_vWindows.clear();
+    m_mIndices.clear();
+    m_vDirty.clear();
+    m_vAnywhereWindows.clear();
+    m_vGrids.clear();
+    m_iBorderGrabArea = borderGrabArea();
+    m_bBuilt          = true;
+
+    for (auto& m : g_pCompositor->m_vMonitors) {
+        SMonitorGrid grid = {.monitorID = m->ID, .box = {m->vecPosition, m->vecSize}};
+        grid.cols         = std::max(1, (int)std::ceil(grid.box.w / CELL_SIZE));
+        grid.rows         = std::max(1, (int)std::ceil(grid.box.h / CELL_SIZE));
+        grid.cells.resize(grid.cols * grid.rows);
+        m_vGrids.emplace_back(std::move(grid));
+    }
+
+    for (uint32_t i = 0; i < g_pCompositor->m_vWindows.size(); ++i) {
+        const auto PWINDOW = g_pCompositor->m_vWindows[i].get();
+        m_vWindows.push_back({.pWindow = PWINDOW, .cells = std::vector<SCellRange>(m_vGrids.size())});
+        m_mIndices[PWINDOW] = i;
+        place(i);
+    }
+}
+
+void CWindowHitIndex::place(uint32_t index) {
+    auto&      entry = m_vWindows[index];
+    const auto w     = entry.pWindow;
+
+    // dim_around windows take the input of their whole monitor
+    entry.anywhere = w->m_sAdditionalConfigData.dimAround.toUnderlying() || (!w->m_bIsX11 && w->m_pPopupHead && w->m_pPopupHead->hasChildren());
+    if (entry.anywhere)
+        m_vAnywhereWindows.push_back(index);
+
+    // the biggest box any of the vectorToWindowUnified checks can use
+    CBox inputBox = w->getWindowBoxUnified(RESERVED_EXTENTS | INPUT_EXTENTS | FULL_EXTENTS);
+    inputBox.expand(w->m_iX11Type == 2 ? m_iBorderGrabArea : 0);
+    const CBox layoutBox = {w->m_vPosition, w->m_vSize};
+
+    const auto X1 = std::min({inputBox.x, inputBox.x + inputBox.w, layoutBox.x, layoutBox.x + layoutBox.w});
+    const auto X2 = std::max({inputBox.x, inputBox.x + inputBox.w, layoutBox.x, layoutBox.x + layoutBox.w});
+    const auto Y1 = std::min({inputBox.y, inputBox.y + inputBox.h, layoutBox.y, layoutBox.y + layoutBox.h});
+    const auto Y2 = std::max({inputBox.y, inputBox.y + inputBox.h, layoutBox.y, layoutBox.y + layoutBox.h});
+
+    for (size_t g = 0; g < m_vGrids.size(); ++g) {
+        auto& grid  = m_vGrids[g];
+        auto& range = entry.cells[g];
+        range       = {};
+
+        // edges count, a point on the edge between two monitors can be looked up in either grid
+        if (X2 < grid.box.x || X1 > grid.box.x + grid.box.w || Y2 < grid.box.y || Y1 > grid.box.y + grid.box.h)
+            continue;
+
+        range = {
+            .col1 = cellCoord(X1 - grid.box.x, grid.cols),
+            .col2 = cellCoord(X2 - grid.box.x, grid.cols),
+            .row1 = cellCoord(Y1 - grid.box.y, grid.rows),
+            .row2 = cellCoord(Y2 - grid.box.y, grid.rows),
+        };
+
+        for (int row = range.row1; row <= range.row2; ++row) {
+            for (int col = range.col1; col <= range.col2; ++col) {
+                grid.cells[row * grid.cols + col].push_back(index);
+            }
+        }
+    }
+}
+
+void CWindowHitIndex::unplace(uint32_t index) {
+    auto& entry = m_vWindows[index];
+
+    if (entry.anywhere)
+        std::erase(m_vAnywhereWindows, index);
+
+    for (size_t g = 0; g < m_vGrids.size(); ++g) {
+        auto&       grid  = m_vGrids[g];
+        const auto& range = entry.cells[g];
+
+        for (int row = range.row1; row <= range.row2; ++row) {
+            for (int col = range.col1; col <= range.col2; ++col) {
+                std::erase(grid.cells[row * grid.cols + col], index);
+            }
+        }
+    }
+}
+
+const std::vector<uint32_t>* CWindowHitIndex::cellAt(const Vector2D& pos) {
+    for (auto& grid : m_vGrids) {
+        if (!(pos.x >= grid.box.x && pos.x <= grid.box.x + grid.box.w && pos.y >= grid.box.y && pos.y <= grid.box.y + grid.box.h))
+            continue;
+
+        return &grid.cells[cellCoord(pos.y - grid.box.y, grid.rows) * grid.cols + cellCoord(pos.x - grid.box.x, grid.cols)];
+    }
+
+    return nullptr;
+}
+
+std::vector<PHLWINDOW> CWindowHitIndex::candidatesAt(const Vector2D& pos, const Vector2D& pointerPos) {
+    if (!isValid())
+        rebuild();
+
+    for (const auto i : m_vDirty) {
+        m_vWindows[i].dirty = false;
+        unplace(i);
+        place(i);
+    }
+    m_vDirty.clear();
+
+    const auto CELL        = cellAt(pos);
+    const auto POINTERCELL = cellAt(pointerPos);
+
+    if (!CELL || !POINTERCELL)
+        return g_pCompositor->m_vWindows;
+
+    std::vector<uint32_t> indices;
+    indices.reserve(CELL->size() + POINTERCELL->size() + m_vAnywhereWindows.size());
+    indices.insert(indices.end(), CELL->begin(), CELL->end());
+    if (POINTERCELL != CELL)
+        indices.insert(indices.end(), POINTERCELL->begin(), POINTERCELL->end());
+    indices.insert(indices.end(), m_vAnywhereWindows.begin(), m_vAnywhereWindows.end());
+
+    // back to z order
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    std::vector<PHLWINDOW> candidates;
+    candidates.reserve(indices.size());
+    for (const auto i : indices) {
+        candidates.push_back(g_pCompositor->m_vWindows[i]);
+    }
+
+    return candidates;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "DesktopTypes.hpp"
+#include "../helpers/math/Math.hpp"
+
+class CWindow;
+
+/*
+    Per-monitor uniform grid over the input boxes of all windows, for vectorToWindowUnified.
+
+    Each window is put in every cell its largest possible input box (all the extents, border grab area, layout box)
+    touches, so a lookup returns a superset of the windows that can be under a point, in m_vWindows (z) order.
+    The caller still does all the exact checks on those.
+
+    Windows are re-placed one by one when they report a change: damage, their position / size animating or warping,
+    decorations being recalculated, popups coming and going. Adding, removing or restacking windows, monitor
+    changes and the border grab area changing rebuild everything.
+*/
+class CWindowHitIndex {
+  public:
+    // windows that may be at pos or at pointerPos, bottom to top. All windows if a point is outside of every monitor.
+    std::vector<PHLWINDOW> candidatesAt(const Vector2D& pos, const Vector2D& pointerPos);
+
+    // the window's geometry, decorations, popups or rules may have changed
+    void invalidate(PHLWINDOW pWindow);
+    // m_vWindows changed
+    void invalidateAll();
+
+  private:
+    struct SCellRange {
+        int col1 = 0, col2 = -1, row1 = 0, row2 = -1; // inclusive, empty by default
+    };
+
+    struct SWindowEntry {
+        CWindow*                pWindow   = nullptr;
+        bool                    anywhere  = false; // popups or dim_around, checked for every lookup
+        bool                    dirty     = false;
+        std::vector<SCellRange> cells; // one per grid
+    };
+
+    struct SMonitorGrid {
+        uint64_t                           monitorID = -1;
+        CBox                               box;
+        int                                cols = 0;
+        int                                rows = 0;
+        std::vector<std::vector<uint32_t>> cells; // indices in m_vWindows
+    };
+
+    bool                                   isValid();
+    void                                   rebuild();
+    void                                   place(uint32_t index);
+    void                                   unplace(uint32_t index);
+    const std::vector<uint32_t>*           cellAt(const Vector2D& pos);
+
+    std::vector<SWindowEntry>              m_vWindows;
+    std::unordered_map<CWindow*, uint32_t> m_mIndices;
+    std::vector<uint32_t>                  m_vDirty;
+    std::vector<uint32_t>                  m_vAnywhereWindows;
+    std::vector<SMonitorGrid>              m_vGrids;
+    int64_t                                m_iBorderGrabArea = 0;
+    bool                                   m_bBuilt          = false;
+};
@@ -106,7 +106,8 @@ class IPointer : public IHID {
     } pointerEvents;
 
     std::string  hlName;
-    bool         connected = false; // means connected to the cursor
+    std::string  boundOutput = ""; // absolute motion is mapped onto this output instead of the focused one
+    bool         connected   = false; // means connected to the cursor
 
     WP<IPointer> self;
 };
@@ -7,6 +7,7 @@
 #include "../protocols/LayerShell.hpp"
 #include "../protocols/PresentationTime.hpp"
 #include "../managers/PointerManager.hpp"
+#include "../moonlight/managers/MoonlightManager.hpp"
 #include <hyprutils/string/String.hpp>
 using namespace Hyprutils::String;
 
@@ -37,6 +38,9 @@ static void onPresented(void* owner, void* data) {
     auto       E        = (wlr_output_event_present*)data;
 
     PROTO::presentation->onPresented(PMONITOR, E->when, E->refresh, E->seq, E->flags);
+
+    if (g_pMoonlightManager)
+        g_pMoonlightManager->onPresented(PMONITOR, E->when, E->refresh);
 }
 
 void CMonitor::onConnect(bool noRule) {
@@ -445,7 +449,7 @@ void CMonitor::setupDefaultWS(const SMonitorRule& monitorRule) {
         if (newDefaultWorkspaceName == "")
             newDefaultWorkspaceName = std::to_string(wsID);
 
-        PNEWWORKSPACE = g_pCompositor->m_vWorkspaces.emplace_back(CWorkspace::create(wsID, ID, newDefaultWorkspaceName));
+        PNEWWORKSPACE = g_pCompositor->addWorkspace(CWorkspace::create(wsID, ID, newDefaultWorkspaceName));
     }
 
     activeWorkspace = PNEWWORKSPACE;
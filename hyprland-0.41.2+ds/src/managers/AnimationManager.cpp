@@ -193,6 +193,11 @@ void CAnimationManager::tick() {
             }
             default: UNREACHABLE();
         }
+
+        // hidden windows aren't damaged, but they can still be hit once their workspace shows up
+        if (PWINDOW && (av == &PWINDOW->m_vRealPosition || av == &PWINDOW->m_vRealSize))
+            g_pCompositor->m_windowHitIndex.invalidate(PWINDOW);
+
         // set size and pos if valid, but only if damage policy entire (dont if border for example)
         if (validMapped(PWINDOW) && av->m_eDamagePolicy == AVARDAMAGE_ENTIRE && PWINDOW->m_iX11Type != 2)
             g_pXWaylandManager->setWindowSize(PWINDOW, PWINDOW->m_vRealSize.goal());
@@ -747,6 +747,16 @@ void CPointerManager::warpAbsolute(Vector2D abs, SP<IHID> dev) {
             }
             break;
         }
+        case HID_TYPE_POINTER: {
+            IPointer* POINTER = reinterpret_cast<IPointer*>(dev.get());
+            if (!POINTER->boundOutput.empty()) {
+                if (const auto PMONITOR = g_pCompositor->getMonitorFromString(POINTER->boundOutput); PMONITOR) {
+                    currentMonitor = PMONITOR->self.lock();
+                    mappedArea     = currentMonitor->logicalBox();
+                }
+            }
+            break;
+        }
         case HID_TYPE_TOUCH: {
             ITouch* TOUCH = reinterpret_cast<ITouch*>(dev.get());
             if (!TOUCH->boundOutput.empty()) {
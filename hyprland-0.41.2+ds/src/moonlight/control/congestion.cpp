@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <control/congestion.hpp>
+#include <core/logger.hpp>
+#include <core/utils.hpp>
+
+namespace control {
+
+using namespace std::chrono_literals;
+
+/* How often the gathered feedback is turned into a decision */
+static constexpr auto EVALUATION_INTERVAL = 500ms;
+/* Minimum time between two changes */
+static constexpr auto CHANGE_COOLDOWN = 1s;
+/* How long the network has to be clean before probing for more bitrate */
+static constexpr auto INCREASE_HOLD = 3s;
+/* How long probing stays under the bitrate that last congested the link, before trying to go past it again */
+static constexpr auto CEILING_HOLD = 20s;
+
+/* Lost frames ratio over which the link is considered congested */
+static constexpr double HIGH_LOSS = 0.05;
+/* Lost frames ratio under which the link is considered clean, in between we only add FEC */
+static constexpr double LOW_LOSS = 0.005;
+/* The RTT is inflated (queues are building up) when it grows this much over the baseline */
+static constexpr double RTT_INFLATION_RATIO = 1.5;
+static constexpr double RTT_INFLATION_MIN_MS = 20;
+
+static constexpr double BITRATE_DECREASE = 0.85;
+static constexpr double BITRATE_INCREASE = 0.05; // of the maximum bitrate
+static constexpr double CEILING_MARGIN = 0.9;     // of the bitrate that congested the link
+static constexpr int FEC_STEP = 10;
+
+static int env_int(const char *name, int fallback) {
+  auto value = utils::get_env(name, "");
+  return value[0] == '\0' ? fallback : std::atoi(value);
+}
+
+CongestionLimits congestion_limits_from_env(int bitrate_kbps, int fec_percentage) {
+  auto limits = CongestionLimits{.min_bitrate_kbps = env_int("WOLF_ABR_MIN_BITRATE", std::min(bitrate_kbps, 2000)),
+                                 .max_bitrate_kbps = env_int("WOLF_ABR_MAX_BITRATE", bitrate_kbps),
+                                 .min_fec_percentage = env_int("WOLF_ABR_MIN_FEC", fec_percentage),
+                                 .max_fec_percentage = env_int("WOLF_ABR_MAX_FEC", 50)};
+  limits.max_bitrate_kbps = std::max(limits.max_bitrate_kbps, limits.min_bitrate_kbps);
+  limits.min_fec_percentage = std::clamp(limits.min_fec_percentage, 0, 255);
+  limits.max_fec_percentage = std::clamp(limits.max_fec_percentage, limits.min_fec_percentage, 255);
+  return limits;
+}
+
+bool adaptive_bitrate_enabled() {
+  return utils::get_env("WOLF_ABR", "") != std::string("FALSE");
+}
+
+CongestionController::CongestionController(CongestionLimits limits, int bitrate_kbps, int fec_percentage, int fps)
+    : limits(limits), bitrate(std::clamp(bitrate_kbps, limits.min_bitrate_kbps, limits.max_bitrate_kbps)),
+      fec(std::clamp(fec_percentage, limits.min_fec_percentage, limits.max_fec_percentage)), fps(std::max(fps, 1)) {}
+
+void CongestionController::on_loss_report(int lost_frames, int interval_ms) {
+  this->lost_frames += std::max(lost_frames, 0);
+  reported_ms += std::max(interval_ms, 0);
+}
+
+void CongestionController::on_frame_invalidated() {
+  invalidated_frames++;
+}
+
+void CongestionController::on_rtt(int rtt_ms) {
+  if (rtt_ms <= 0) {
+    return;
+  }
+  min_rtt_ms = min_rtt_ms ? std::min(*min_rtt_ms, (double)rtt_ms) : rtt_ms;
+  smoothed_rtt_ms = smoothed_rtt_ms ? *smoothed_rtt_ms + (rtt_ms - *smoothed_rtt_ms) / 8 : rtt_ms;
+}
+
+bool CongestionController::rtt_inflated() const {
+  if (!min_rtt_ms || !smoothed_rtt_ms) {
+    return false;
+  }
+  return *smoothed_rtt_ms > std::max(*min_rtt_ms * RTT_INFLATION_RATIO, *min_rtt_ms + RTT_INFLATION_MIN_MS);
+}
+
+std::optional<RateDecision> CongestionController::update(clock::time_point now) {
+  if (!last_evaluation) {
+    last_evaluation = now;
+    last_change = now;
+    clean_since = now;
+    return std::nullopt;
+  }
+
+  auto elapsed = now - *last_evaluation;
+  if (elapsed < EVALUATION_INTERVAL) {
+    return std::nullopt;
+  }
+
+  // The client only reports loss while it's losing frames, whatever isn't covered by a report was clean
+  auto window_ms = std::max<long>(reported_ms, std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+  auto expected_frames = std::max(1.0, window_ms * fps / 1000.0);
+  auto loss = std::min(1.0, (lost_frames + invalidated_frames) / expected_frames);
+  // Once FEC is maxed out, frames that are still lost mean that the parity itself doesn't fit the link anymore
+  auto congested = loss > HIGH_LOSS || rtt_inflated() || (loss > LOW_LOSS && fec >= limits.max_fec_percentage);
+
+  // Slowly let the baseline follow the RTT so that a route change doesn't look like congestion forever
+  if (min_rtt_ms && smoothed_rtt_ms) {
+    *min_rtt_ms += (*smoothed_rtt_ms - *min_rtt_ms) / 64;
+  }
+
+  lost_frames = 0;
+  reported_ms = 0;
+  invalidated_frames = 0;
+  last_evaluation = now;
+
+  auto new_bitrate = bitrate;
+  auto new_fec = fec;
+  if (congested || loss > LOW_LOSS) {
+    clean_since = now;
+    if (now - last_change < CHANGE_COOLDOWN) {
+      return std::nullopt;
+    }
+    // More parity would only add to the queues when the link is already full
+    if (congested) {
+      new_bitrate = std::max((int)(bitrate * BITRATE_DECREASE), limits.min_bitrate_kbps);
+      ceiling_kbps = bitrate;
+      ceiling_since = now;
+    } else {
+      new_fec = std::min(fec + FEC_STEP, limits.max_fec_percentage);
+    }
+  } else if (now - clean_since >= INCREASE_HOLD && now - last_change >= CHANGE_COOLDOWN) {
+    new_fec = std::max(fec - FEC_STEP / 2, limits.min_fec_percentage);
+    auto max_bitrate = limits.max_bitrate_kbps;
+    if (ceiling_kbps && now - ceiling_since < CEILING_HOLD) {
+      max_bitrate = std::min(max_bitrate, (int)(*ceiling_kbps * CEILING_MARGIN));
+    }
+    new_bitrate = std::clamp(bitrate + std::max(1, (int)(limits.max_bitrate_kbps * BITRATE_INCREASE)),
+                             bitrate,
+                             std::max(bitrate, max_bitrate));
+  }
+
+  if (new_bitrate == bitrate && new_fec == fec) {
+    return std::nullopt;
+  }
+
+  logs::log(logs::debug,
+            "[ABR] loss: {:.1f}% rtt: {:.0f}ms (min {:.0f}ms) - bitrate {} -> {} kbps, FEC {}% -> {}%",
+            loss * 100,
+            smoothed_rtt_ms.value_or(0),
+            min_rtt_ms.value_or(0),
+            bitrate,
+            new_bitrate,
+            fec,
+            new_fec);
+
+  bitrate = new_bitrate;
+  fec = new_fec;
+  last_change = now;
+  return RateDecision{.bitrate_kbps = bitrate, .fec_percentage = fec};
+}
+
+} // namespace control
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+namespace control {
+
+/**
+ * The range the congestion controller is allowed to move a session in
+ */
+struct CongestionLimits {
+  int min_bitrate_kbps;
+  int max_bitrate_kbps;
+  int min_fec_percentage;
+  int max_fec_percentage;
+};
+
+/**
+ * Limits for a session that asked for `bitrate_kbps` and `fec_percentage`.
+ * By default the session never goes above what the client asked for, can be overridden with:
+ * WOLF_ABR_MIN_BITRATE, WOLF_ABR_MAX_BITRATE (kbps), WOLF_ABR_MIN_FEC, WOLF_ABR_MAX_FEC (percentage)
+ */
+CongestionLimits congestion_limits_from_env(int bitrate_kbps, int fec_percentage);
+
+/**
+ * @return false when WOLF_ABR=FALSE, sessions then keep the bitrate and FEC they started with
+ */
+bool adaptive_bitrate_enabled();
+
+struct RateDecision {
+  int bitrate_kbps;
+  int fec_percentage;
+};
+
+/**
+ * Adapts the encoder bitrate and the FEC percentage of a session to the feedback sent by the client.
+ *
+ *  - Random loss (lost frames, RTT stable) is first covered by adding FEC.
+ *  - Congestion (lots of lost frames or the RTT growing over its baseline) backs the bitrate off multiplicatively.
+ *  - Once the network has been clean for a while the bitrate is probed back up additively, and FEC removed.
+ *    Probing stays under the bitrate that last congested the link for a while, so that it doesn't keep losing frames
+ *    by going past the same capacity over and over.
+ *
+ * Decreases are rate limited by a cooldown and increases need a clean hold period, so that a single bad report
+ * doesn't make the stream oscillate. Not thread safe, it's expected to be fed from the control thread only.
+ */
+class CongestionController {
+public:
+  using clock = std::chrono::steady_clock;
+
+  CongestionController(CongestionLimits limits, int bitrate_kbps, int fec_percentage, int fps);
+
+  /**
+   * A loss report: `lost_frames` out of the ones sent in the last `interval_ms`
+   */
+  void on_loss_report(int lost_frames, int interval_ms);
+
+  /**
+   * The client couldn't decode a frame and asked for a new IDR
+   */
+  void on_frame_invalidated();
+
+  void on_rtt(int rtt_ms);
+
+  /**
+   * Evaluates the feedback gathered so far
+   * @return the new settings to apply, std::nullopt when nothing has to change
+   */
+  std::optional<RateDecision> update(clock::time_point now = clock::now());
+
+  int bitrate_kbps() const {
+    return bitrate;
+  }
+
+  int fec_percentage() const {
+    return fec;
+  }
+
+private:
+  bool rtt_inflated() const;
+
+  CongestionLimits limits;
+  int bitrate;
+  int fec;
+  int fps;
+
+  /* Feedback gathered since the last evaluation */
+  int lost_frames = 0;
+  int reported_ms = 0;
+  int invalidated_frames = 0;
+
+  /* RTT baseline (lowest seen) and smoothed value */
+  std::optional<double> min_rtt_ms;
+  std::optional<double> smoothed_rtt_ms;
+
+  /* The bitrate the link was last congested at, probing stays under it for a while */
+  std::optional<int> ceiling_kbps;
+  clock::time_point ceiling_since{};
+
+  std::optional<clock::time_point> last_evaluation;
+  clock::time_point last_change{};
+  clock::time_point clean_since{};
+};
+
+} // namespace control
@@ -1,8 +1,11 @@
 #include "core/input.hpp"
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
 #include <control/control.hpp>
 #include <control/input_handler.hpp>
 #include <core/events.hpp>
 #include <immer/box.hpp>
+#include <optional>
 #include <state/sessions.hpp>
 #include <sys/socket.h>
 
@@ -74,41 +77,48 @@ bool send_packet(std::string_view payload, ENetPeer *peer) {
   return true;
 }
 
+std::shared_ptr<PeerEncryptor> make_peer_encryptor(std::string_view aes_key) {
+  // Not movable (mutex member), built in place
+  return std::shared_ptr<PeerEncryptor>(new PeerEncryptor{.encryptor = make_control_encryptor(aes_key)});
+}
+
 bool encrypt_and_send(std::string_view payload,
-                      std::string_view aes_key,
+                      PeerEncryptor &encryptor,
                       immer::box<std::shared_ptr<ENetPeer>> connected_client) {
   if (auto enet_client = connected_client->get()) {
-    auto encrypted = control::encrypt_packet(aes_key, 0, payload); // TODO: seq?
-    return send_packet({(char *)encrypted.get(), encrypted->full_size()}, enet_client);
+    ControlEncryptedPacket encrypted;
+    {
+      std::lock_guard lock(encryptor.mutex);
+      if (!control::encrypt_packet(encryptor.encryptor, 0, payload, encrypted)) { // TODO: seq?
+        logs::log(logs::warning, "[ENET] Payload too big to be encrypted: {} bytes", payload.size());
+        return false;
+      }
+    }
+    return send_packet({(char *)&encrypted, encrypted.full_size()}, enet_client);
   } else {
     logs::log(logs::warning, "[ENET] Failed to send packet, client is not connected");
     return false;
   }
 }
 
-std::optional<events::StreamSession> get_current_session(const enet_clients_map &connected_clients,
-                                                         const state::SessionsAtoms &running_sessions,
-                                                         std::string_view client_ip,
-                                                         const ENetEvent &enet_event) {
-  if (enet_event.type == ENET_EVENT_TYPE_CONNECT) {
-    // A new connection, we should check if there's a session that matches the current client
-    for (const StreamSession &session : *running_sessions->load()) {
-      if (session.enet_secret_payload == enet_event.data) {
-        return session;
-      }
-    }
-    logs::log(logs::warning,
-              "[ENET] Unable to find a session that matches the client secret {}, matching by IP",
-              enet_event.data);
-    for (const StreamSession &session : *running_sessions->load()) {
-      if (session.ip == client_ip) {
-        return session;
-      }
+/**
+ * A new connection, we should check if there's a session that matches the current client.
+ * Once connected the session is kept in the PeerContext, this is only called on ENET_EVENT_TYPE_CONNECT.
+ */
+std::optional<events::StreamSession> find_session(const state::SessionsAtoms &running_sessions,
+                                                  std::string_view client_ip,
+                                                  const ENetEvent &enet_event) {
+  for (const StreamSession &session : *running_sessions->load()) {
+    if (session.enet_secret_payload == enet_event.data) {
+      return session;
     }
-  } else {
-    // The connection has already been established, we'll check for a match in our connected client map
-    if (auto client = connected_clients.find(enet_event.peer)) {
-      return client->get();
+  }
+  logs::log(logs::warning,
+            "[ENET] Unable to find a session that matches the client secret {}, matching by IP",
+            enet_event.data);
+  for (const StreamSession &session : *running_sessions->load()) {
+    if (session.ip == client_ip) {
+      return session;
     }
   }
   return std::nullopt;
@@ -120,6 +130,39 @@ std::shared_ptr<ENetPeer> to_shared_ptr(ENetPeer *peer) {
   });
 }
 
+/**
+ * Forwards the client feedback to whoever adapts the stream to the network (see control/congestion.hpp)
+ */
+static void fire_network_stats(const std::shared_ptr<events::EventBusType> &event_bus,
+                               std::size_t session_id,
+                               ENetPeer *peer,
+                               int lost_frames,
+                               int interval_ms,
+                               bool frame_invalidated) {
+  event_bus->fire_event(immer::box<ClientNetworkStatsEvent>(ClientNetworkStatsEvent{
+      .session_id = session_id,
+      .lost_frames = lost_frames,
+      .interval_ms = interval_ms,
+      .rtt_ms = (int)peer->roundTripTime,
+      .frame_invalidated = frame_invalidated}));
+}
+
+/**
+ * Hands over the merged input of every client whose interval has passed, see control/input_coalescer.hpp
+ * The input still pending for an ended session is dropped.
+ */
+static void flush_input(const enet_clients_map &connected_clients) {
+  auto now = InputCoalescer::clock::now();
+  for (const auto &[peer, ctx] : connected_clients) {
+    if (ctx->session_ended) {
+      ctx->input.discard();
+    } else if (auto next_flush = ctx->input.next_flush(); next_flush && *next_flush <= now) {
+      ctx->input.flush([ctx = ctx.get()](INPUT_PKT *pkt) { handle_input(ctx->session, ctx->enet_client, ctx->encryptor, pkt); },
+                       now);
+    }
+  }
+}
+
 void run_control(int port,
                  const state::SessionsAtoms &running_sessions,
                  const std::shared_ptr<events::EventBusType> &event_bus,
@@ -138,10 +181,10 @@ void run_control(int port,
       [&connected_clients](const immer::box<StopStreamEvent> &ev) {
         auto terminate_pkt = ControlTerminatePacket{};
         std::string plaintext = {(char *)&terminate_pkt, sizeof(terminate_pkt)};
-        for (auto &[peer, session] : *connected_clients.load()) {
-          if (session->session_id == ev->session_id) {
-            immer::box<std::shared_ptr<ENetPeer>> enet_client = {to_shared_ptr(peer)};
-            encrypt_and_send(plaintext, session->aes_key, enet_client);
+        for (auto &[peer, ctx] : *connected_clients.load()) {
+          if (ctx->session.session_id == ev->session_id) {
+            ctx->session_ended = true;
+            encrypt_and_send(plaintext, *ctx->encryptor, ctx->enet_client);
             return;
           }
         }
@@ -149,75 +192,124 @@ void run_control(int port,
       });
 
   while (true) {
-    if (enet_host_service(host.get(), &event, timeout.count()) > 0) {
+    // Wake up in time for the input that is waiting to be merged, an ended session won't get it anyway
+    auto wait = timeout;
+    auto now = InputCoalescer::clock::now();
+    for (const auto &[peer, ctx] : *connected_clients.load()) {
+      if (ctx->session_ended) {
+        continue;
+      }
+      if (auto next_flush = ctx->input.next_flush()) {
+        wait = std::clamp(std::chrono::ceil<std::chrono::milliseconds>(*next_flush - now), 0ms, wait);
+      }
+    }
+
+    auto service_result = enet_host_service(host.get(), &event, wait.count());
+    flush_input(*connected_clients.load());
+    if (service_result > 0) {
       auto [client_ip, client_port] = get_ip(event.peer->address);
-      auto client_session = get_current_session(connected_clients, running_sessions, client_ip, event);
-      if (client_session) {
-        switch (event.type) {
-        case ENET_EVENT_TYPE_NONE:
-          break;
-        case ENET_EVENT_TYPE_CONNECT:
-          logs::log(logs::debug, "[ENET] connected client: {}:{}", client_ip, client_port);
-          connected_clients.update([peer = event.peer, &client_session](const enet_clients_map &m) {
-            return m.set(peer, client_session.value());
-          });
-          event_bus->fire_event(
-              immer::box<ResumeStreamEvent>(ResumeStreamEvent{.session_id = client_session->session_id}));
-          break;
-        case ENET_EVENT_TYPE_DISCONNECT:
-          logs::log(logs::debug, "[ENET] disconnected client: {}:{}", client_ip, client_port);
-          connected_clients.update([peer = event.peer](const enet_clients_map &m) { return m.erase(peer); });
-          event_bus->fire_event(
-              immer::box<PauseStreamEvent>(PauseStreamEvent{.session_id = client_session->session_id}));
-          break;
-        case ENET_EVENT_TYPE_RECEIVE:
-          enet_packet packet = {event.packet, enet_packet_destroy};
-
-          auto type = ((ControlPacket *)packet->data)->type;
-
-          logs::log(logs::trace,
-                    "[ENET] received {} of {} bytes from: {}:{} HEX: {}",
-                    packet_type_to_str(type),
-                    packet->dataLength,
-                    client_ip,
-                    client_port,
-                    crypto::str_to_hex({(char *)packet->data, packet->dataLength}));
 
-          if (type == ENCRYPTED) {
-            try {
-              auto enc_pkt = (ControlEncryptedPacket *)(packet->data);
-              auto decrypted = decrypt_packet(*enc_pkt, client_session->aes_key);
-              auto sub_type = ((ControlPacket *)decrypted.data())->type;
-
-              logs::log(logs::trace,
-                        "[ENET] decrypted sub_type: {} HEX: {}",
-                        packet_type_to_str(sub_type),
-                        crypto::str_to_hex(decrypted));
-
-              if (sub_type == TERMINATION) {
-                event_bus->fire_event(
-                    immer::box<PauseStreamEvent>(PauseStreamEvent{.session_id = client_session->session_id}));
-              } else if (sub_type == INPUT_DATA) {
-                immer::box<std::shared_ptr<ENetPeer>> enet_client = {to_shared_ptr(event.peer)};
-                handle_input(client_session.value(), enet_client, (INPUT_PKT *)decrypted.data());
-              } else if (sub_type == IDR_FRAME) {
-                auto ev = IDRRequestEvent{.session_id = client_session->session_id};
-                event_bus->fire_event(immer::box<IDRRequestEvent>(ev));
-              }
-            } catch (std::runtime_error &e) {
-              logs::log(logs::warning, "[ENET] Unable to decrypt incoming packet: {}", e.what());
-            }
-          } else {
-            logs::log(logs::warning,
-                      "[ENET] Received unencrypted message: {} - {}",
-                      packet_type_to_str(type),
-                      crypto::str_to_hex({(char *)packet->data, packet->dataLength}));
-          }
-          break;
+      if (event.type == ENET_EVENT_TYPE_CONNECT) {
+        auto client_session = find_session(running_sessions, client_ip, event);
+        if (!client_session) {
+          logs::log(logs::warning, "[ENET] Received packet from unrecognised client {}:{}", client_ip, client_port);
+          enet_peer_disconnect_now(event.peer, 0);
+          continue;
         }
-      } else {
+
+        logs::log(logs::debug, "[ENET] connected client: {}:{}", client_ip, client_port);
+        attach_input_sink_devices(*client_session);
+        // Not movable (atomic member), built in place
+        auto ctx = std::shared_ptr<PeerContext>(
+            new PeerContext{.session = *client_session,
+                            .enet_client = immer::box<std::shared_ptr<ENetPeer>>{to_shared_ptr(event.peer)},
+                            .decryptor = make_control_decryptor(client_session->aes_key),
+                            .encryptor = make_peer_encryptor(client_session->aes_key),
+                            .input = InputCoalescer(input_coalesce_interval())});
+        event.peer->data = ctx.get();
+        connected_clients.update([peer = event.peer, ctx](const enet_clients_map &m) { return m.set(peer, ctx); });
+        event_bus->fire_event(
+            immer::box<ResumeStreamEvent>(ResumeStreamEvent{.session_id = client_session->session_id}));
+        continue;
+      }
+
+      auto ctx = static_cast<PeerContext *>(event.peer->data);
+      if (!ctx) {
         logs::log(logs::warning, "[ENET] Received packet from unrecognised client {}:{}", client_ip, client_port);
         enet_peer_disconnect_now(event.peer, 0);
+        continue;
+      }
+      auto session_id = ctx->session.session_id;
+
+      switch (event.type) {
+      case ENET_EVENT_TYPE_NONE:
+      case ENET_EVENT_TYPE_CONNECT:
+        break;
+      case ENET_EVENT_TYPE_DISCONNECT:
+        logs::log(logs::debug, "[ENET] disconnected client: {}:{}", client_ip, client_port);
+        event.peer->data = nullptr;
+        // Last reference to ctx, don't use it after this
+        connected_clients.update([peer = event.peer](const enet_clients_map &m) { return m.erase(peer); });
+        event_bus->fire_event(immer::box<PauseStreamEvent>(PauseStreamEvent{.session_id = session_id}));
+        break;
+      case ENET_EVENT_TYPE_RECEIVE:
+        enet_packet packet = {event.packet, enet_packet_destroy};
+
+        auto type = ((ControlPacket *)packet->data)->type;
+
+        logs::log(logs::trace,
+                  "[ENET] received {} of {} bytes from: {}:{} HEX: {}",
+                  packet_type_to_str(type),
+                  packet->dataLength,
+                  client_ip,
+                  client_port,
+                  crypto::str_to_hex({(char *)packet->data, packet->dataLength}));
+
+        if (ctx->session_ended) {
+          logs::log(logs::debug, "[ENET] Dropping packet for ended session: {}", session_id);
+        } else if (type == ENCRYPTED) {
+          try {
+            auto enc_pkt = (ControlEncryptedPacket *)(packet->data);
+            decrypt_packet(ctx->decryptor, *enc_pkt, ctx->decrypted);
+            auto &decrypted = ctx->decrypted;
+            auto sub_type = ((ControlPacket *)decrypted.data())->type;
+
+            logs::log(logs::trace,
+                      "[ENET] decrypted sub_type: {} HEX: {}",
+                      packet_type_to_str(sub_type),
+                      crypto::str_to_hex(decrypted));
+
+            if (sub_type == TERMINATION) {
+              event_bus->fire_event(immer::box<PauseStreamEvent>(PauseStreamEvent{.session_id = session_id}));
+            } else if (sub_type == INPUT_DATA) {
+              ctx->input.push((INPUT_PKT *)decrypted.data(), [ctx](INPUT_PKT *pkt) {
+                handle_input(ctx->session, ctx->enet_client, ctx->encryptor, pkt);
+              });
+            } else if (sub_type == IDR_FRAME) {
+              auto ev = IDRRequestEvent{.session_id = session_id};
+              event_bus->fire_event(immer::box<IDRRequestEvent>(ev));
+              fire_network_stats(event_bus, session_id, event.peer, 0, 0, true);
+            } else if (sub_type == LOSS_STATS && decrypted.size() >= sizeof(ControlLossStatsPacket)) {
+              auto loss_pkt = (ControlLossStatsPacket *)decrypted.data();
+              fire_network_stats(event_bus,
+                                 session_id,
+                                 event.peer,
+                                 boost::endian::little_to_native(loss_pkt->lost_frames),
+                                 boost::endian::little_to_native(loss_pkt->interval_ms),
+                                 false);
+            } else if (sub_type == PERIODIC_PING) {
+              fire_network_stats(event_bus, session_id, event.peer, 0, 0, false);
+            }
+          } catch (std::runtime_error &e) {
+            logs::log(logs::warning, "[ENET] Unable to decrypt incoming packet: {}", e.what());
+          }
+        } else {
+          logs::log(logs::warning,
+                    "[ENET] Received unencrypted message: {} - {}",
+                    packet_type_to_str(type),
+                    crypto::str_to_hex({(char *)packet->data, packet->dataLength}));
+        }
+        break;
       }
     }
   }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <control/input_coalescer.hpp>
 #include <enet/enet.h>
 #include <core/events.hpp>
 #include <core/logger.hpp>
@@ -21,12 +24,42 @@ void run_control(int port,
                  std::chrono::milliseconds timeout = 1000ms,
                  const std::string &host_ip = "0.0.0.0");
 
-using enet_clients_map = immer::map<ENetPeer *, immer::box<events::StreamSession>>;
+/**
+ * The cipher for packets going to a connected client. Those are sent from the control thread, the event bus
+ * (StopStreamEvent) and the joypad feedback callbacks (rumble, LEDs, motion), hence the lock. Shared, because the
+ * joypads can outlive the PeerContext.
+ */
+struct PeerEncryptor {
+  std::mutex mutex;
+  crypto::aes_encryptor encryptor;
+};
+
+/**
+ * Everything needed to handle a packet from a connected client, resolved once when it connects and attached to
+ * ENetPeer::data so that the hot path doesn't have to look up the session or derive the AES key again.
+ *
+ * Only touched by the control thread, with the exception of session_ended.
+ */
+struct PeerContext {
+  events::StreamSession session;
+  immer::box<std::shared_ptr<ENetPeer>> enet_client;
+  crypto::aes_decryptor decryptor;
+  std::shared_ptr<PeerEncryptor> encryptor;
+  InputCoalescer input;
+  std::string decrypted; // reused between packets
+
+  /* Set from the event bus when the session is stopped, packets coming after that are dropped */
+  std::atomic<bool> session_ended = false;
+};
+
+using enet_clients_map = immer::map<ENetPeer *, std::shared_ptr<PeerContext>>;
 
 std::shared_ptr<ENetPeer> to_shared_ptr(ENetPeer *peer);
 
+std::shared_ptr<PeerEncryptor> make_peer_encryptor(std::string_view aes_key);
+
 bool encrypt_and_send(std::string_view payload,
-                      std::string_view aes_key,
+                      PeerEncryptor &encryptor,
                       immer::box<std::shared_ptr<ENetPeer>> connected_client);
 
 bool init();
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <control/input_coalescer.hpp>
+#include <core/utils.hpp>
+#include <limits>
+
+namespace control {
+
+std::chrono::microseconds input_coalesce_interval() {
+  auto ms = std::max(0.0, std::atof(utils::get_env("WOLF_INPUT_COALESCE_MS", "4")));
+  return std::chrono::microseconds((long)(ms * 1000));
+}
+
+/**
+ * Takes out of total the biggest chunk that fits in a packet field
+ */
+static short take_chunk(int &total) {
+  auto chunk = std::clamp(total, (int)std::numeric_limits<short>::min(), (int)std::numeric_limits<short>::max());
+  total -= chunk;
+  return (short)chunk;
+}
+
+bool InputCoalescer::coalesce(INPUT_PKT *pkt) {
+  switch (pkt->type) {
+  case MOUSE_MOVE_REL: {
+    if (abs_move) {
+      return false; // The relative move has to be applied on top of the absolute one
+    }
+    auto move_pkt = static_cast<MOUSE_MOVE_REL_PACKET *>(pkt);
+    rel_move = *move_pkt;
+    rel_x += boost::endian::big_to_native(move_pkt->delta_x);
+    rel_y += boost::endian::big_to_native(move_pkt->delta_y);
+    return true;
+  }
+  case MOUSE_MOVE_ABS: {
+    if (rel_move) {
+      return false;
+    }
+    abs_move = *static_cast<MOUSE_MOVE_ABS_PACKET *>(pkt);
+    return true;
+  }
+  case MOUSE_SCROLL: {
+    auto scroll_pkt = static_cast<MOUSE_SCROLL_PACKET *>(pkt);
+    scroll = *scroll_pkt;
+    scroll_amount += boost::endian::big_to_native(scroll_pkt->scroll_amt1);
+    return true;
+  }
+  case MOUSE_HSCROLL: {
+    auto scroll_pkt = static_cast<MOUSE_HSCROLL_PACKET *>(pkt);
+    h_scroll = *scroll_pkt;
+    h_scroll_amount += boost::endian::big_to_native(scroll_pkt->scroll_amount);
+    return true;
+  }
+  case CONTROLLER_MULTI: {
+    auto controller_pkt = static_cast<CONTROLLER_MULTI_PACKET *>(pkt);
+    auto pending = controllers.find(controller_pkt->controller_number);
+    // Only sticks and triggers can be merged: buttons and controllers coming and going must all go through
+    if (pending != controllers.end() && (pending->second.button_flags != controller_pkt->button_flags ||
+                                         pending->second.buttonFlags2 != controller_pkt->buttonFlags2 ||
+                                         pending->second.active_gamepad_mask != controller_pkt->active_gamepad_mask)) {
+      return false;
+    }
+    controllers.insert_or_assign(controller_pkt->controller_number, *controller_pkt);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+static bool is_high_rate(INPUT_TYPE type) {
+  return type == MOUSE_MOVE_REL || type == MOUSE_MOVE_ABS || type == MOUSE_SCROLL || type == MOUSE_HSCROLL ||
+         type == CONTROLLER_MULTI;
+}
+
+void InputCoalescer::push(INPUT_PKT *pkt, const dispatch_fn &dispatch, clock::time_point now) {
+  if (interval.count() <= 0) {
+    dispatch(pkt);
+    return;
+  }
+
+  auto pending = next_flush().has_value();
+  if (pending || now - last_flush < interval) {
+    if (coalesce(pkt)) {
+      return;
+    }
+    if (pending) {
+      flush(dispatch, now);
+    }
+  } else if (is_high_rate(pkt->type)) {
+    // First one after being idle, the following ones will be merged until the interval has passed
+    last_flush = now;
+  }
+  dispatch(pkt);
+}
+
+void InputCoalescer::flush(const dispatch_fn &dispatch, clock::time_point now) {
+  last_flush = now;
+
+  if (abs_move) {
+    dispatch(&*abs_move);
+    abs_move.reset();
+  }
+  if (rel_move) {
+    // A 16 bit field might not be enough after summing a lot of packets
+    do {
+      rel_move->delta_x = boost::endian::native_to_big(take_chunk(rel_x));
+      rel_move->delta_y = boost::endian::native_to_big(take_chunk(rel_y));
+      dispatch(&*rel_move);
+    } while (rel_x != 0 || rel_y != 0);
+    rel_move.reset();
+  }
+  if (scroll) {
+    do {
+      scroll->scroll_amt1 = boost::endian::native_to_big(take_chunk(scroll_amount));
+      dispatch(&*scroll);
+    } while (scroll_amount != 0);
+    scroll.reset();
+  }
+  if (h_scroll) {
+    do {
+      h_scroll->scroll_amount = boost::endian::native_to_big(take_chunk(h_scroll_amount));
+      dispatch(&*h_scroll);
+    } while (h_scroll_amount != 0);
+    h_scroll.reset();
+  }
+  for (auto &[controller_number, controller_pkt] : controllers) {
+    dispatch(&controller_pkt);
+  }
+  controllers.clear();
+}
+
+void InputCoalescer::discard() {
+  flush([](INPUT_PKT *) {});
+}
+
+std::optional<InputCoalescer::clock::time_point> InputCoalescer::next_flush() const {
+  if (!abs_move && !rel_move && !scroll && !h_scroll && controllers.empty()) {
+    return std::nullopt;
+  }
+  return last_flush + interval;
+}
+
+} // namespace control
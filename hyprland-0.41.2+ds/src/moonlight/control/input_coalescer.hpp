@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <optional>
+#include <protocol/moonlight/control.hpp>
+
+namespace control {
+
+using namespace moonlight::control::pkts;
+
+/**
+ * Sits between the ENet receive loop and handle_input(): high rate motion packets are merged and handed over at most
+ * once per interval, so that a 8 kHz mouse turns into one move (and one SYN_REPORT) per device per interval instead
+ * of one for each packet.
+ *
+ *  - relative mouse motion and scroll deltas are summed
+ *  - the absolute mouse position and the controller state (sticks, triggers) only keep the latest value
+ *  - everything else (buttons, keys, touch, ...) flushes whatever is pending and is then handled right away,
+ *    this keeps the ordering between motion and buttons
+ *
+ * The first packet after an idle period goes through right away, coalescing only kicks in when packets come faster
+ * than the interval.
+ *
+ * Not thread safe, keep one for each connected client on the control thread.
+ */
+class InputCoalescer {
+public:
+  using clock = std::chrono::steady_clock;
+  using dispatch_fn = std::function<void(INPUT_PKT *)>;
+
+  explicit InputCoalescer(std::chrono::microseconds interval) : interval(interval) {}
+
+  /**
+   * Either handles pkt right away via dispatch or keeps it until the next flush()
+   */
+  void push(INPUT_PKT *pkt, const dispatch_fn &dispatch, clock::time_point now = clock::now());
+
+  /**
+   * Hands over everything that is pending
+   */
+  void flush(const dispatch_fn &dispatch, clock::time_point now = clock::now());
+
+  /**
+   * Drops everything that is pending, ex: the session is over and nobody should get it anymore
+   */
+  void discard();
+
+  /**
+   * @return when flush() has to be called, std::nullopt when there's nothing pending
+   */
+  [[nodiscard]] std::optional<clock::time_point> next_flush() const;
+
+private:
+  bool coalesce(INPUT_PKT *pkt);
+
+  std::chrono::microseconds interval;
+  clock::time_point last_flush = {};
+
+  /* Headers of the last packets received, reused when flushing the summed deltas */
+  std::optional<MOUSE_MOVE_REL_PACKET> rel_move;
+  int rel_x = 0;
+  int rel_y = 0;
+  std::optional<MOUSE_SCROLL_PACKET> scroll;
+  int scroll_amount = 0;
+  std::optional<MOUSE_HSCROLL_PACKET> h_scroll;
+  int h_scroll_amount = 0;
+
+  std::optional<MOUSE_MOVE_ABS_PACKET> abs_move;
+  std::map<short /* controller number */, CONTROLLER_MULTI_PACKET> controllers;
+};
+
+/**
+ * WOLF_INPUT_COALESCE_MS (default 4, 0 disables it) how long high rate input is merged before being sent to the
+ * virtual devices; roughly a compositor frame at 240Hz.
+ */
+std::chrono::microseconds input_coalesce_interval();
+
+} // namespace control
@@ -9,11 +9,18 @@ namespace control {
 using namespace moonlight::control::pkts;
 using namespace wolf::core;
 
+/**
+ * When the compositor registered an InputSink (see core/virtual-display.hpp) the session gets mouse, keyboard and
+ * touch screen that are injected in-process instead of going through uinput
+ */
+void attach_input_sink_devices(events::StreamSession &session);
+
 /**
  * Side effect: session devices might be updated when hotplugging
  */
 void handle_input(events::StreamSession &session,
                   immer::box<std::shared_ptr<ENetPeer>> connected_client,
+                  const std::shared_ptr<PeerEncryptor> &encryptor,
                   INPUT_PKT *pkt);
 
 void mouse_move_rel(const MOUSE_MOVE_REL_PACKET &pkt, events::StreamSession &session);
@@ -36,11 +43,13 @@ void pen(const PEN_PACKET &pkt, events::StreamSession &session);
 
 void controller_arrival(const CONTROLLER_ARRIVAL_PACKET &pkt,
                         events::StreamSession &session,
-                        immer::box<std::shared_ptr<ENetPeer>> connected_client);
+                        immer::box<std::shared_ptr<ENetPeer>> connected_client,
+                        const std::shared_ptr<PeerEncryptor> &encryptor);
 
 void controller_multi(const CONTROLLER_MULTI_PACKET &pkt,
                       events::StreamSession &session,
-                      immer::box<std::shared_ptr<ENetPeer>> connected_client);
+                      immer::box<std::shared_ptr<ENetPeer>> connected_client,
+                      const std::shared_ptr<PeerEncryptor> &encryptor);
 
 void controller_touch(const CONTROLLER_TOUCH_PACKET &pkt, events::StreamSession &session);
 
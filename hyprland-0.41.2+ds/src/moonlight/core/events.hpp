@@ -144,6 +144,18 @@ struct IDRRequestEvent {
   std::size_t session_id;
 };
 
+/**
+ * Network feedback received from the client over the control stream
+ */
+struct ClientNetworkStatsEvent {
+  std::size_t session_id;
+
+  int lost_frames;        // since the previous report, 0 when this is just an RTT update
+  int interval_ms;        // time covered by lost_frames
+  int rtt_ms;             // round trip time as measured by ENet on the control channel
+  bool frame_invalidated; // the client couldn't decode a frame and asked for an IDR
+};
+
 struct PauseStreamEvent {
   std::size_t session_id;
 };
@@ -185,6 +197,7 @@ using EventBusHandlers = dp::handler_registration<immer::box<PlugDeviceEvent>,
                                                   immer::box<VideoSession>,
                                                   immer::box<AudioSession>,
                                                   immer::box<IDRRequestEvent>,
+                                                  immer::box<ClientNetworkStatsEvent>,
                                                   immer::box<PauseStreamEvent>,
                                                   immer::box<ResumeStreamEvent>,
                                                   immer::box<StopStreamEvent>,
@@ -198,6 +211,7 @@ using EventBusType = dp::event_bus<immer::box<PlugDeviceEvent>,
                                    immer::box<VideoSession>,
                                    immer::box<AudioSession>,
                                    immer::box<IDRRequestEvent>,
+                                   immer::box<ClientNetworkStatsEvent>,
                                    immer::box<PauseStreamEvent>,
                                    immer::box<ResumeStreamEvent>,
                                    immer::box<StopStreamEvent>,
@@ -211,6 +225,7 @@ using EventsVariant = std::variant<immer::box<PlugDeviceEvent>,
                                    immer::box<VideoSession>,
                                    immer::box<AudioSession>,
                                    immer::box<IDRRequestEvent>,
+                                   immer::box<ClientNetworkStatsEvent>,
                                    immer::box<PauseStreamEvent>,
                                    immer::box<ResumeStreamEvent>,
                                    immer::box<StopStreamEvent>,
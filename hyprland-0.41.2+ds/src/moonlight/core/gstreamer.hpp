@@ -2,6 +2,7 @@
 
 #include <gst/gst.h>
 #include <core/logger.hpp>
+#include <string_view>
 
 namespace wolf::core::gstreamer {
 
@@ -36,6 +37,35 @@ static void send_message(GstElement *recipient, GstStructure *message) {
   gst_element_send_event(recipient, gst_ev);
 }
 
+/**
+ * Changes the bitrate of every encoder in the pipeline while it's running.
+ * All the encoders used in the default config take kbps, either as `bitrate` or `target-bitrate` (aom, svt)
+ * @return false if no encoder with one of those properties was found
+ */
+static bool set_encoder_bitrate(GstElement *pipeline, int bitrate_kbps) {
+  bool found = false;
+  auto it = gst_bin_iterate_recurse(GST_BIN(pipeline));
+  GValue item = G_VALUE_INIT;
+  while (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+    auto element = GST_ELEMENT(g_value_get_object(&item));
+    auto factory = gst_element_get_factory(element);
+    auto klass = factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : nullptr;
+    if (klass && std::string_view(klass).find("Encoder") != std::string_view::npos) {
+      for (auto property : {"bitrate", "target-bitrate"}) {
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(element), property)) {
+          gst_util_set_object_arg(G_OBJECT(element), property, std::to_string(bitrate_kbps).c_str());
+          found = true;
+          break;
+        }
+      }
+    }
+    g_value_reset(&item);
+  }
+  g_value_unset(&item);
+  gst_iterator_free(it);
+  return found;
+}
+
 /**
  * Given a Gstreamer element returns the supported DRM formats (if any).
  * Ex: "vah265enc" -> ["P010:0x0200000000042305", "NV12:0x0200000000042305"]
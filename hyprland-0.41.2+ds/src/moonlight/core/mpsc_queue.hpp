@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Bounded lock free queue, any number of producers and a single consumer.
+ *
+ * Unlike TSQueue pushing never blocks nor allocates, so it can be called from threads that must not stall
+ * (ex: the ENet control thread); when the queue is full push() fails and it's up to the caller to drop the item.
+ *
+ * Adapted from Dmitry Vyukov's bounded MPMC queue:
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+template <typename T, std::size_t Capacity> class MPSCQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+
+  std::array<Cell, Capacity> cells;
+  alignas(64) std::atomic<std::size_t> enqueue_pos = 0;
+  alignas(64) std::size_t dequeue_pos = 0;
+
+public:
+  MPSCQueue() {
+    for (std::size_t i = 0; i < Capacity; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCQueue(const MPSCQueue &) = delete;
+  MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+  /**
+   * @return false if the queue is full
+   */
+  bool push(const T &item) {
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      auto &cell = cells[pos & (Capacity - 1)];
+      auto seq = cell.sequence.load(std::memory_order_acquire);
+      auto diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.data = item;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Only ever call this from the consumer thread
+   * @return the oldest element, empty optional if there's none
+   */
+  std::optional<T> pop() {
+    auto &cell = cells[dequeue_pos & (Capacity - 1)];
+    if ((std::ptrdiff_t)cell.sequence.load(std::memory_order_acquire) - (std::ptrdiff_t)(dequeue_pos + 1) < 0) {
+      return {};
+    }
+    T item = std::move(cell.data);
+    cell.sequence.store(dequeue_pos + Capacity, std::memory_order_release);
+    dequeue_pos++;
+    return item;
+  }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * Bounded lock free ring of samples, one producer and one consumer.
+ *
+ * The storage is allocated once in the constructor; writing hands out the free slots directly so that the producer
+ * can convert (ex: int16 -> float, stereo -> mono) straight into the ring without going through a temporary buffer.
+ * When the ring is full write() stores what fits and it's up to the caller to account for the rest.
+ */
+template <typename T> class SPSCRing {
+private:
+  std::unique_ptr<T[]> buffer;
+  std::size_t mask;
+  alignas(64) std::atomic<std::size_t> write_pos = 0;
+  alignas(64) std::atomic<std::size_t> read_pos = 0;
+
+public:
+  /**
+   * @param min_capacity rounded up to the next power of 2
+   */
+  explicit SPSCRing(std::size_t min_capacity) {
+    std::size_t capacity = 2;
+    while (capacity < min_capacity) {
+      capacity <<= 1;
+    }
+    buffer = std::make_unique<T[]>(capacity);
+    mask = capacity - 1;
+  }
+
+  SPSCRing(const SPSCRing &) = delete;
+  SPSCRing &operator=(const SPSCRing &) = delete;
+
+  [[nodiscard]] std::size_t capacity() const {
+    return mask + 1;
+  }
+
+  /**
+   * Only ever call this from the producer thread.
+   *
+   * @param fill called once, or twice when the free space wraps around, as `fill(T *dst, std::size_t offset,
+   * std::size_t count)` where offset is the position of dst in the `count` items requested
+   * @return how many items have been written, less than count if the ring is full
+   */
+  template <typename F> std::size_t write(std::size_t count, F &&fill) {
+    auto w = write_pos.load(std::memory_order_relaxed);
+    auto r = read_pos.load(std::memory_order_acquire);
+    count = std::min(count, capacity() - (w - r));
+    if (count == 0) {
+      return 0;
+    }
+
+    auto start = w & mask;
+    auto first = std::min(count, capacity() - start);
+    fill(buffer.get() + start, 0, first);
+    if (first < count) {
+      fill(buffer.get(), first, count - first);
+    }
+
+    write_pos.store(w + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * Only ever call this from the consumer thread
+   * @return how many items have been copied to out
+   */
+  std::size_t read(T *out, std::size_t count) {
+    auto r = read_pos.load(std::memory_order_relaxed);
+    auto w = write_pos.load(std::memory_order_acquire);
+    count = std::min(count, w - r);
+    if (count == 0) {
+      return 0;
+    }
+
+    auto start = r & mask;
+    auto first = std::min(count, capacity() - start);
+    std::copy_n(buffer.get() + start, first, out);
+    std::copy_n(buffer.get(), count - first, out + first);
+
+    read_pos.store(r + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * Readable items; from the producer thread this can be more than what's left, the consumer may be reading
+   */
+  [[nodiscard]] std::size_t size() const {
+    return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_acquire);
+  }
+};
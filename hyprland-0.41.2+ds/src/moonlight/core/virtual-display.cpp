@@ -1,14 +1,41 @@
 #include "virtual-display.hpp"
 #include <core/logger.hpp>
+#include <linux/input-event-codes.h>
+#include <mutex>
+#include <platforms/input.hpp>
 
 namespace wolf::core::virtual_display {
 
 // WaylandState stub implementation
 struct WaylandState {
     std::string socket_name;
+    // Set when the devices are fed straight into the compositor, see InputSink.
+    // Weak: the compositor owns the sink and tears it down on its own thread, sessions just stop being fed
+    std::weak_ptr<InputSink> sink;
     // TODO: Add real Wayland virtual display state
 };
 
+static std::mutex input_sink_mutex;
+static std::shared_ptr<InputSink> input_sink;
+
+void set_input_sink(std::shared_ptr<InputSink> sink) {
+    std::lock_guard<std::mutex> lock(input_sink_mutex);
+    input_sink = std::move(sink);
+}
+
+wl_state_ptr create_input_sink_display() {
+    std::lock_guard<std::mutex> lock(input_sink_mutex);
+    if (!input_sink)
+        return nullptr;
+    auto state  = std::make_shared<WaylandState>();
+    state->sink = input_sink;
+    return state;
+}
+
+static std::shared_ptr<InputSink> sink_of(const wl_state_ptr &w_state) {
+    return w_state ? w_state->sink.lock() : nullptr;
+}
+
 wl_state_ptr create_wayland_display(gstreamer::gst_element_ptr wayland_plugin, const std::string &wayland_socket_name) {
     logs::log(logs::debug, "[VIRTUAL-DISPLAY] create_wayland_display: {}", wayland_socket_name);
     auto state = std::make_shared<WaylandState>();
@@ -26,71 +53,107 @@ bool add_input_device(WaylandState &w_state, const std::string &device_path) {
 }
 
 // WaylandMouse implementation
+
+/**
+ * Moonlight numbers buttons from 1 (left, middle, right, side, extra)
+ */
+static unsigned int moonlight_to_linux_button(unsigned int button) {
+    switch (button) {
+        case 1: return BTN_LEFT;
+        case 2: return BTN_MIDDLE;
+        case 3: return BTN_RIGHT;
+        case 4: return BTN_SIDE;
+        default: return BTN_EXTRA;
+    }
+}
+
 void WaylandMouse::move(int delta_x, int delta_y) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::move({}, {})", delta_x, delta_y);
-    // TODO: Implement Wayland mouse movement
+    if (auto sink = sink_of(w_state))
+        sink->pointer_motion(delta_x, delta_y);
 }
 
 void WaylandMouse::move_abs(int x, int y, int screen_width, int screen_height) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::move_abs({}, {}, {}x{})", x, y, screen_width, screen_height);
-    // TODO: Implement Wayland mouse absolute movement
+    if (auto sink = sink_of(w_state); sink && screen_width > 0 && screen_height > 0)
+        sink->pointer_motion_absolute((double)x / screen_width, (double)y / screen_height);
 }
 
 void WaylandMouse::press(unsigned int button) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::press({})", button);
-    // TODO: Implement Wayland mouse button press
+    if (auto sink = sink_of(w_state))
+        sink->pointer_button(moonlight_to_linux_button(button), true);
 }
 
 void WaylandMouse::release(unsigned int button) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::release({})", button);
-    // TODO: Implement Wayland mouse button release
+    if (auto sink = sink_of(w_state))
+        sink->pointer_button(moonlight_to_linux_button(button), false);
 }
 
 void WaylandMouse::vertical_scroll(int high_res_distance) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::vertical_scroll({})", high_res_distance);
-    // TODO: Implement Wayland mouse vertical scroll
+    // Moonlight scrolls up with positive values, Wayland down
+    if (auto sink = sink_of(w_state))
+        sink->pointer_axis(true, -high_res_distance);
 }
 
 void WaylandMouse::horizontal_scroll(int high_res_distance) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandMouse::horizontal_scroll({})", high_res_distance);
-    // TODO: Implement Wayland mouse horizontal scroll
+    if (auto sink = sink_of(w_state))
+        sink->pointer_axis(false, high_res_distance);
 }
 
 // WaylandKeyboard implementation
 void WaylandKeyboard::press(unsigned int key_code) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandKeyboard::press({})", key_code);
-    // TODO: Implement Wayland keyboard key press
+    auto sink = sink_of(w_state);
+    if (!sink)
+        return;
+    if (auto key = wolf::platforms::input::moonlight_to_linux_key(key_code))
+        sink->keyboard_key(*key, true);
+    else
+        logs::log(logs::warning, "[VIRTUAL-DISPLAY] Unknown Moonlight key code: {:#x}", key_code);
 }
 
 void WaylandKeyboard::release(unsigned int key_code) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandKeyboard::release({})", key_code);
-    // TODO: Implement Wayland keyboard key release
+    auto sink = sink_of(w_state);
+    if (!sink)
+        return;
+    if (auto key = wolf::platforms::input::moonlight_to_linux_key(key_code))
+        sink->keyboard_key(*key, false);
 }
 
 // WaylandTouchScreen implementation
 void WaylandTouchScreen::down(unsigned int touch_id, double x, double y) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandTouchScreen::down({}, {}, {})", touch_id, x, y);
-    // TODO: Implement Wayland touchscreen touch down
+    if (auto sink = sink_of(w_state))
+        sink->touch_down(touch_id, x, y);
 }
 
 void WaylandTouchScreen::up(unsigned int touch_id) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandTouchScreen::up({})", touch_id);
-    // TODO: Implement Wayland touchscreen touch up
+    if (auto sink = sink_of(w_state))
+        sink->touch_up(touch_id);
 }
 
 void WaylandTouchScreen::motion(unsigned int touch_id, double x, double y) {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandTouchScreen::motion({}, {}, {})", touch_id, x, y);
-    // TODO: Implement Wayland touchscreen touch motion
+    if (auto sink = sink_of(w_state))
+        sink->touch_motion(touch_id, x, y);
 }
 
 void WaylandTouchScreen::cancel() {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandTouchScreen::cancel()");
-    // TODO: Implement Wayland touchscreen cancel
+    if (auto sink = sink_of(w_state))
+        sink->touch_cancel();
 }
 
 void WaylandTouchScreen::frame() {
     logs::log(logs::trace, "[VIRTUAL-DISPLAY] WaylandTouchScreen::frame()");
-    // TODO: Implement Wayland touchscreen frame
+    if (auto sink = sink_of(w_state))
+        sink->touch_frame();
 }
 
 } // namespace wolf::core::virtual_display
\ No newline at end of file
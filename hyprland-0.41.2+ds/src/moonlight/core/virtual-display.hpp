@@ -16,6 +16,48 @@ struct DisplayMode {
 
 typedef struct WaylandState WaylandState;
 
+/**
+ * Where the Wayland* devices below deliver their events. Implemented by the compositor hosting the sessions so that
+ * remote input is injected in-process instead of going through uinput, udev and libinput.
+ *
+ * Called from the control thread: implementations must hand the events over to their own thread without blocking.
+ * The devices only keep a weak reference, the owner decides when the sink goes away.
+ */
+class InputSink {
+public:
+  virtual ~InputSink() = default;
+
+  virtual void pointer_motion(double delta_x, double delta_y) = 0;
+
+  /* x and y go from 0 to 1 over the streamed output */
+  virtual void pointer_motion_absolute(double x, double y) = 0;
+
+  /* button is a linux BTN_* code */
+  virtual void pointer_button(unsigned int button, bool pressed) = 0;
+
+  /* distance follows the Wayland axis direction, 120 is a full wheel step */
+  virtual void pointer_axis(bool vertical, int high_res_distance) = 0;
+
+  /* key is a linux KEY_* code */
+  virtual void keyboard_key(unsigned int key, bool pressed) = 0;
+
+  /* x and y go from 0 to 1 over the streamed output */
+  virtual void touch_down(unsigned int touch_id, double x, double y) = 0;
+
+  virtual void touch_up(unsigned int touch_id) = 0;
+
+  virtual void touch_motion(unsigned int touch_id, double x, double y) = 0;
+
+  virtual void touch_cancel() = 0;
+
+  virtual void touch_frame() = 0;
+};
+
+/**
+ * Sets (or removes, with nullptr) the InputSink used by the Wayland* devices created from now on
+ */
+void set_input_sink(std::shared_ptr<InputSink> sink);
+
 using wl_state_ptr = std::shared_ptr<WaylandState>;
 
 wl_state_ptr create_wayland_display(gstreamer::gst_element_ptr wayland_plugin, const std::string &wayland_socket_name);
@@ -24,6 +66,11 @@ std::string get_wayland_socket_name(WaylandState &w_state);
 
 bool add_input_device(WaylandState &w_state, const std::string &device_path);
 
+/**
+ * @return a state for Wayland* devices that feed the registered InputSink, nullptr when there's none
+ */
+wl_state_ptr create_input_sink_display();
+
 class WaylandMouse {
 public:
   WaylandMouse(wl_state_ptr w_state) : w_state(w_state) {};
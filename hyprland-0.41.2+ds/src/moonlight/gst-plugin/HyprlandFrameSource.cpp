@@ -1,7 +1,11 @@
 #include "HyprlandFrameSource.hpp"
-#include "../../debug/Log.hpp"
+#include "capture_timestamp.hpp"
 #include <gst/app/gstappsrc.h>
 #include <gst/video/video.h>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <drm_fourcc.h>
@@ -16,7 +20,10 @@ enum {
     PROP_HEIGHT,
     PROP_FRAMERATE,
     PROP_FORMAT,
-    PROP_MONITOR
+    PROP_MONITOR,
+    PROP_FRAMES_PUSHED,
+    PROP_FRAMES_OVERWRITTEN,
+    PROP_FRAMES_DROPPED
 };
 
 // Default values
@@ -35,16 +42,24 @@ static void gst_hyprland_frame_src_set_property(GObject* object, guint prop_id,
 static void gst_hyprland_frame_src_get_property(GObject* object, guint prop_id, GValue* value, GParamSpec* pspec);
 
 static GstCaps* gst_hyprland_frame_src_get_caps(GstBaseSrc* src, GstCaps* filter);
+static gboolean gst_hyprland_frame_src_set_caps(GstBaseSrc* src, GstCaps* caps);
 static gboolean gst_hyprland_frame_src_start(GstBaseSrc* src);
 static gboolean gst_hyprland_frame_src_stop(GstBaseSrc* src);
+static gboolean gst_hyprland_frame_src_unlock(GstBaseSrc* src);
+static gboolean gst_hyprland_frame_src_unlock_stop(GstBaseSrc* src);
 static GstFlowReturn gst_hyprland_frame_src_create(GstBaseSrc* src, guint64 offset, guint size, GstBuffer** buffer);
 
 // Helper functions
-static GstBuffer* wlr_buffer_to_gst_buffer(wlr_buffer* wlr_buf, guint width, guint height);
+static GstBuffer* wlr_buffer_to_gst_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf);
+static GstBuffer* wlr_dmabuf_to_gst_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf, const wlr_dmabuf_attributes& attrs);
+static GstBuffer* wlr_shm_to_gst_buffer(wlr_buffer* wlr_buf);
 static GstVideoFormat drm_format_to_gst_format(uint32_t drm_format);
+static GstCaps* build_dmabuf_caps(uint32_t drm_format, uint64_t drm_modifier);
 
 // GObject type definition
-G_DEFINE_TYPE(GstHyprlandFrameSrc, gst_hyprland_frame_src, GST_TYPE_BASE_SRC);
+G_DEFINE_TYPE_WITH_CODE(GstHyprlandFrameSrc, gst_hyprland_frame_src, GST_TYPE_BASE_SRC,
+                        GST_DEBUG_CATEGORY_INIT(gst_hyprland_frame_src_debug, "hyprlandframesrc", 0,
+                                                "Hyprland Frame Source"));
 
 static void gst_hyprland_frame_src_class_init(GstHyprlandFrameSrcClass* klass) {
     GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
@@ -56,8 +71,11 @@ static void gst_hyprland_frame_src_class_init(GstHyprlandFrameSrcClass* klass) {
     gobject_class->finalize = gst_hyprland_frame_src_finalize;
 
     basesrc_class->get_caps = gst_hyprland_frame_src_get_caps;
+    basesrc_class->set_caps = gst_hyprland_frame_src_set_caps;
     basesrc_class->start = gst_hyprland_frame_src_start;
     basesrc_class->stop = gst_hyprland_frame_src_stop;
+    basesrc_class->unlock = gst_hyprland_frame_src_unlock;
+    basesrc_class->unlock_stop = gst_hyprland_frame_src_unlock_stop;
     basesrc_class->create = gst_hyprland_frame_src_create;
 
     // Properties
@@ -81,6 +99,23 @@ static void gst_hyprland_frame_src_class_init(GstHyprlandFrameSrcClass* klass) {
                            DEFAULT_FORMAT,
                            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+    g_object_class_install_property(gobject_class, PROP_FRAMES_PUSHED,
+        g_param_spec_uint64("frames-pushed", "Frames pushed", "Frames handed over by the compositor",
+                           0, G_MAXUINT64, 0,
+                           (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_FRAMES_OVERWRITTEN,
+        g_param_spec_uint64("frames-overwritten", "Frames overwritten",
+                           "Frames replaced by a newer one before the pipeline picked them up",
+                           0, G_MAXUINT64, 0,
+                           (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_FRAMES_DROPPED,
+        g_param_spec_uint64("frames-dropped", "Frames dropped",
+                           "Frames rejected because the source wasn't running or the buffer couldn't be wrapped",
+                           0, G_MAXUINT64, 0,
+                           (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
     // Element metadata
     gst_element_class_set_static_metadata(element_class,
         "Hyprland Frame Source",
@@ -88,13 +123,14 @@ static void gst_hyprland_frame_src_class_init(GstHyprlandFrameSrcClass* klass) {
         "Captures frames from Hyprland compositor",
         "Hyprland Moonlight Integration");
 
-    // Pad template
-    GstCaps* caps = gst_caps_new_simple("video/x-raw",
-        "format", G_TYPE_STRING, "RGBx",
-        "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-        "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-        "framerate", GST_TYPE_FRACTION_RANGE, 1, 1, 120, 1,
-        NULL);
+    // Pad template: DMA-BUF first so zero-copy wins negotiation, system memory as fallback
+    GstCaps* caps = gst_caps_from_string(
+        "video/x-raw(" GST_CAPS_FEATURE_MEMORY_DMABUF "), "
+        "format=(string)DMA_DRM, "
+        "width=(int)[1, MAX], height=(int)[1, MAX], framerate=(fraction)[1/1, 120/1]; "
+        "video/x-raw, "
+        "format=(string){ BGRx, BGRA, RGBx, RGBA }, "
+        "width=(int)[1, MAX], height=(int)[1, MAX], framerate=(fraction)[1/1, 120/1]");
 
     GstPadTemplate* src_template = gst_pad_template_new("src", GST_PAD_SRC, GST_PAD_ALWAYS, caps);
     gst_element_class_add_pad_template(element_class, src_template);
@@ -107,17 +143,29 @@ static void gst_hyprland_frame_src_init(GstHyprlandFrameSrc* src) {
     src->framerate_num = DEFAULT_FRAMERATE_NUM;
     src->framerate_den = DEFAULT_FRAMERATE_DEN;
     src->format = g_strdup(DEFAULT_FORMAT);
-    
+
     src->started = FALSE;
     src->timestamp = 0;
     src->frame_count = 0;
-    
-    g_mutex_init(&src->buffer_mutex);
-    g_cond_init(&src->buffer_cond);
-    src->current_buffer = NULL;
-    src->new_frame_available = FALSE;
+
+    src->pending_buffer = NULL;
+    src->flushing = FALSE;
+    src->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (src->wake_fd < 0) {
+        GST_ERROR_OBJECT(src, "Failed to create eventfd: %s", strerror(errno));
+    }
     src->monitor = NULL;
 
+    src->frames_pushed = 0;
+    src->frames_overwritten = 0;
+    src->frames_dropped = 0;
+
+    src->dmabuf_allocator = gst_dmabuf_allocator_new();
+    src->drm_format = DRM_FORMAT_INVALID;
+    src->drm_modifier = DRM_FORMAT_MOD_INVALID;
+    src->caps_dirty = FALSE;
+    src->use_dmabuf = FALSE;
+
     // Set live source properties
     gst_base_src_set_live(GST_BASE_SRC(src), TRUE);
     gst_base_src_set_format(GST_BASE_SRC(src), GST_FORMAT_TIME);
@@ -125,15 +173,21 @@ static void gst_hyprland_frame_src_init(GstHyprlandFrameSrc* src) {
 
 static void gst_hyprland_frame_src_finalize(GObject* object) {
     GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(object);
-    
+
     g_free(src->format);
-    
-    g_mutex_clear(&src->buffer_mutex);
-    g_cond_clear(&src->buffer_cond);
-    
-    if (src->current_buffer) {
-        gst_buffer_unref(src->current_buffer);
-        src->current_buffer = NULL;
+
+    if (GstBuffer* pending = src->pending_buffer.exchange(NULL)) {
+        gst_buffer_unref(pending);
+    }
+
+    if (src->wake_fd >= 0) {
+        close(src->wake_fd);
+        src->wake_fd = -1;
+    }
+
+    if (src->dmabuf_allocator) {
+        gst_object_unref(src->dmabuf_allocator);
+        src->dmabuf_allocator = NULL;
     }
 
     G_OBJECT_CLASS(gst_hyprland_frame_src_parent_class)->finalize(object);
@@ -179,6 +233,15 @@ static void gst_hyprland_frame_src_get_property(GObject* object, guint prop_id,
         case PROP_FORMAT:
             g_value_set_string(value, src->format);
             break;
+        case PROP_FRAMES_PUSHED:
+            g_value_set_uint64(value, src->frames_pushed.load());
+            break;
+        case PROP_FRAMES_OVERWRITTEN:
+            g_value_set_uint64(value, src->frames_overwritten.load());
+            break;
+        case PROP_FRAMES_DROPPED:
+            g_value_set_uint64(value, src->frames_dropped.load());
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -187,13 +250,35 @@ static void gst_hyprland_frame_src_get_property(GObject* object, guint prop_id,
 
 static GstCaps* gst_hyprland_frame_src_get_caps(GstBaseSrc* basesrc, GstCaps* filter) {
     GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
-    
-    GstCaps* caps = gst_caps_new_simple("video/x-raw",
-        "format", G_TYPE_STRING, src->format,
-        "width", G_TYPE_INT, (gint)src->width,
-        "height", G_TYPE_INT, (gint)src->height,
-        "framerate", GST_TYPE_FRACTION, (gint)src->framerate_num, (gint)src->framerate_den,
-        NULL);
+
+    // Until the first frame arrives assume a linear buffer in the configured format
+    uint32_t drm_format = src->drm_format.load();
+    uint64_t drm_modifier = src->drm_modifier.load();
+
+    GstVideoFormat video_format = gst_video_format_from_string(src->format);
+    if (drm_format == DRM_FORMAT_INVALID) {
+        drm_format = gst_video_dma_drm_fourcc_from_format(video_format);
+        drm_modifier = DRM_FORMAT_MOD_LINEAR;
+    } else {
+        video_format = drm_format_to_gst_format(drm_format);
+    }
+
+    GstCaps* caps = build_dmabuf_caps(drm_format, drm_modifier);
+
+    // Tiled/compressed layouts can't be mmapped into something a system-memory element understands
+    if (drm_modifier == DRM_FORMAT_MOD_LINEAR && video_format != GST_VIDEO_FORMAT_UNKNOWN) {
+        gst_caps_append(caps, gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, gst_video_format_to_string(video_format),
+            NULL));
+    }
+
+    for (guint i = 0; i < gst_caps_get_size(caps); i++) {
+        gst_structure_set(gst_caps_get_structure(caps, i),
+            "width", G_TYPE_INT, (gint)src->width,
+            "height", G_TYPE_INT, (gint)src->height,
+            "framerate", GST_TYPE_FRACTION, (gint)src->framerate_num, (gint)src->framerate_den,
+            NULL);
+    }
 
     if (filter) {
         GstCaps* intersection = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
@@ -204,34 +289,65 @@ static GstCaps* gst_hyprland_frame_src_get_caps(GstBaseSrc* basesrc, GstCaps* fi
     return caps;
 }
 
+static gboolean gst_hyprland_frame_src_set_caps(GstBaseSrc* basesrc, GstCaps* caps) {
+    GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
+
+    GstCapsFeatures* features = gst_caps_get_features(caps, 0);
+    src->use_dmabuf = features && gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF);
+
+    GST_INFO_OBJECT(src, "Negotiated %s caps", src->use_dmabuf ? "DMA-BUF" : "system memory");
+
+    return TRUE;
+}
+
 static gboolean gst_hyprland_frame_src_start(GstBaseSrc* basesrc) {
     GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
-    
-    src->started = TRUE;
+
     src->timestamp = 0;
     src->frame_count = 0;
-    
-    Debug::log(LOG, "HyprlandFrameSource: Started ({}x{} @ {}/{} fps)", 
-              src->width, src->height, src->framerate_num, src->framerate_den);
-    
+    src->flushing = FALSE;
+    src->started = TRUE;
+
+    GST_INFO_OBJECT(src, "Started (%ux%u @ %u/%u fps)",
+                    src->width, src->height, src->framerate_num, src->framerate_den);
+
     return TRUE;
 }
 
 static gboolean gst_hyprland_frame_src_stop(GstBaseSrc* basesrc) {
     GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
-    
+
     src->started = FALSE;
-    
-    g_mutex_lock(&src->buffer_mutex);
-    if (src->current_buffer) {
-        gst_buffer_unref(src->current_buffer);
-        src->current_buffer = NULL;
+
+    if (GstBuffer* pending = src->pending_buffer.exchange(NULL)) {
+        gst_buffer_unref(pending);
     }
-    src->new_frame_available = FALSE;
-    g_mutex_unlock(&src->buffer_mutex);
-    
-    Debug::log(LOG, "HyprlandFrameSource: Stopped");
-    
+    src->drm_format = DRM_FORMAT_INVALID;
+    src->drm_modifier = DRM_FORMAT_MOD_INVALID;
+    src->caps_dirty = FALSE;
+
+    GST_INFO_OBJECT(src, "Stopped (%" G_GUINT64_FORMAT " pushed, %" G_GUINT64_FORMAT " overwritten, %" G_GUINT64_FORMAT " dropped)",
+                    src->frames_pushed.load(), src->frames_overwritten.load(), src->frames_dropped.load());
+
+    return TRUE;
+}
+
+// Interrupts a create() waiting for a frame, called by GstBaseSrc before going to READY or flushing
+static gboolean gst_hyprland_frame_src_unlock(GstBaseSrc* basesrc) {
+    GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
+
+    src->flushing = TRUE;
+    if (src->wake_fd >= 0)
+        eventfd_write(src->wake_fd, 1);
+
+    return TRUE;
+}
+
+static gboolean gst_hyprland_frame_src_unlock_stop(GstBaseSrc* basesrc) {
+    GstHyprlandFrameSrc* src = GST_HYPRLAND_FRAME_SRC(basesrc);
+
+    src->flushing = FALSE;
+
     return TRUE;
 }
 
@@ -242,135 +358,238 @@ static GstFlowReturn gst_hyprland_frame_src_create(GstBaseSrc* basesrc, guint64
         return GST_FLOW_FLUSHING;
     }
     
-    // Wait for new frame
-    g_mutex_lock(&src->buffer_mutex);
-    while (!src->new_frame_available && src->started) {
-        g_cond_wait(&src->buffer_cond, &src->buffer_mutex);
+    // Wait for new frame, the eventfd is only a wake up hint: the mailbox is the source of truth
+    GstBuffer* frame = NULL;
+    while (!(frame = src->pending_buffer.exchange(NULL))) {
+        if (src->flushing || !src->started || src->wake_fd < 0) {
+            return GST_FLOW_FLUSHING;
+        }
+
+        pollfd pfd = {.fd = src->wake_fd, .events = POLLIN, .revents = 0};
+        if (poll(&pfd, 1, -1) > 0) {
+            eventfd_t ignored;
+            eventfd_read(src->wake_fd, &ignored);
+        }
     }
     
-    if (!src->started) {
-        g_mutex_unlock(&src->buffer_mutex);
-        return GST_FLOW_FLUSHING;
+    // Take ownership of the newest frame
+    *buffer = frame;
+
+    gboolean renegotiate = src->caps_dirty.exchange(FALSE);
+
+    // The renderer swapped format or modifier (e.g. after a mode change), tell downstream before pushing
+    if (renegotiate && !gst_base_src_negotiate(basesrc)) {
+        GST_ERROR_OBJECT(src, "Failed to renegotiate caps");
+        gst_buffer_unref(*buffer);
+        *buffer = NULL;
+        return GST_FLOW_NOT_NEGOTIATED;
     }
     
-    if (!src->current_buffer) {
-        g_mutex_unlock(&src->buffer_mutex);
-        return GST_FLOW_ERROR;
+    // Stamp with the vblank the compositor rendered this frame for, mapped onto the pipeline clock.
+    // Frames without a capture time (or before we have a clock) fall back to a steady 1/framerate cadence.
+    GstClockTime duration = gst_util_uint64_scale(GST_SECOND, src->framerate_den, src->framerate_num);
+    GstClockTime pts = capture_to_running_time(GST_ELEMENT(src), gst_buffer_get_capture_timestamp(*buffer));
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) {
+        pts = src->frame_count > 0 ? src->timestamp + duration : 0;
+    } else if (src->frame_count > 0 && pts <= src->timestamp) {
+        // The clock offset is sampled per frame, never let that jitter make PTS go backwards
+        pts = src->timestamp + 1;
     }
+
+    GST_BUFFER_PTS(*buffer) = pts;
+    GST_BUFFER_DTS(*buffer) = pts;
+    GST_BUFFER_DURATION(*buffer) = duration;
     
-    // Take ownership of current buffer
-    *buffer = src->current_buffer;
-    src->current_buffer = NULL;
-    src->new_frame_available = FALSE;
-    
-    g_mutex_unlock(&src->buffer_mutex);
-    
-    // Set timestamp
-    GST_BUFFER_PTS(*buffer) = src->timestamp;
-    GST_BUFFER_DTS(*buffer) = src->timestamp;
-    GST_BUFFER_DURATION(*buffer) = gst_util_uint64_scale(GST_SECOND, src->framerate_den, src->framerate_num);
-    
-    src->timestamp += GST_BUFFER_DURATION(*buffer);
+    src->timestamp = pts;
     src->frame_count++;
     
     return GST_FLOW_OK;
 }
 
 // Public API: Push buffer from Hyprland
-void gst_hyprland_frame_src_push_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf) {
-    if (!src->started || !wlr_buf) {
+void gst_hyprland_frame_src_push_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf, const pixman_box32_t* damage, int n_damage,
+                                        GstClockTime capture_ns) {
+    if (!src->started || src->flushing || !wlr_buf) {
+        src->frames_dropped++;
         return;
     }
     
-    // Convert wlr_buffer to GStreamer buffer
-    GstBuffer* gst_buffer = wlr_buffer_to_gst_buffer(wlr_buf, src->width, src->height);
+    // Wrap the wlr_buffer, the returned GstBuffer holds a lock on it until downstream drops it
+    GstBuffer* gst_buffer = wlr_buffer_to_gst_buffer(src, wlr_buf);
     if (!gst_buffer) {
-        Debug::log(ERR, "HyprlandFrameSource: Failed to convert buffer");
+        GST_ERROR_OBJECT(src, "Failed to convert buffer");
+        src->frames_dropped++;
         return;
     }
-    
-    g_mutex_lock(&src->buffer_mutex);
-    
-    // Replace current buffer
-    if (src->current_buffer) {
-        gst_buffer_unref(src->current_buffer);
+
+    for (int i = 0; i < n_damage; i++) {
+        gst_buffer_add_video_region_of_interest_meta(gst_buffer, "damage", damage[i].x1, damage[i].y1,
+                                                     damage[i].x2 - damage[i].x1, damage[i].y2 - damage[i].y1);
     }
-    
-    src->current_buffer = gst_buffer;
-    src->new_frame_available = TRUE;
-    g_cond_signal(&src->buffer_cond);
-    
-    g_mutex_unlock(&src->buffer_mutex);
+
+    if (GST_CLOCK_TIME_IS_VALID(capture_ns))
+        gst_buffer_set_capture_timestamp(gst_buffer, capture_ns);
+
+    gst_hyprland_frame_src_push_gst_buffer(src, gst_buffer);
+}
+
+void gst_hyprland_frame_src_push_gst_buffer(GstHyprlandFrameSrc* src, GstBuffer* gst_buffer) {
+    if (!src->started || src->flushing) {
+        src->frames_dropped++;
+        gst_buffer_unref(gst_buffer);
+        return;
+    }
+
+    // Latest wins: a frame the encoder hasn't picked up yet is replaced, never waited on.
+    // Releasing it here also hands the wlr_buffer back on the compositor thread.
+    src->frames_pushed++;
+    if (GstBuffer* overwritten = src->pending_buffer.exchange(gst_buffer)) {
+        src->frames_overwritten++;
+        gst_buffer_unref(overwritten);
+    }
+
+    if (src->wake_fd >= 0)
+        eventfd_write(src->wake_fd, 1);
 }
 
 // Helper: Convert wlr_buffer to GStreamer buffer
-static GstBuffer* wlr_buffer_to_gst_buffer(wlr_buffer* wlr_buf, guint width, guint height) {
+static GstBuffer* wlr_buffer_to_gst_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf) {
     if (!wlr_buf) {
         return NULL;
     }
-    
-    // Get buffer dimensions
-    // wlr_buffer provides width/height directly
-    int buf_width = wlr_buf->width;
-    int buf_height = wlr_buf->height;
-    
-    // For now, do a simple memory copy approach
-    // TODO: Implement zero-copy DMA-BUF sharing
-    
-    // Calculate buffer size (assuming RGBx format, 4 bytes per pixel)
-    gsize buffer_size = width * height * 4;
-    
-    // Create GStreamer buffer
-    GstBuffer* gst_buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
-    if (!gst_buffer) {
-        Debug::log(ERR, "HyprlandFrameSource: Failed to allocate GStreamer buffer");
+
+    wlr_dmabuf_attributes attrs;
+    if (wlr_buffer_get_dmabuf(wlr_buf, &attrs)) {
+        // Only the compositor thread writes these, create() picks the change up through caps_dirty
+        if (attrs.format != src->drm_format.load() || attrs.modifier != src->drm_modifier.load()) {
+            src->drm_format = attrs.format;
+            src->drm_modifier = attrs.modifier;
+            src->caps_dirty = TRUE;
+        }
+
+        return wlr_dmabuf_to_gst_buffer(src, wlr_buf, attrs);
+    }
+
+    // Software renderer / shm-backed outputs: no fd to share, fall back to a single copy
+    return wlr_shm_to_gst_buffer(wlr_buf);
+}
+
+// Helper: Wrap the DMA-BUF planes of a wlr_buffer without touching the pixels
+static GstBuffer* wlr_dmabuf_to_gst_buffer(GstHyprlandFrameSrc* src, wlr_buffer* wlr_buf, const wlr_dmabuf_attributes& attrs) {
+    if (!src->dmabuf_allocator) {
+        GST_ERROR_OBJECT(src, "No DMA-BUF allocator");
         return NULL;
     }
-    
-    // Map and copy data
-    GstMapInfo map;
-    if (gst_buffer_map(gst_buffer, &map, GST_MAP_WRITE)) {
-        // Here we would normally copy the pixel data from the wlr_buffer
-        // For now, we'll create a test pattern since the actual copy implementation
-        // depends on the specific buffer format and layout
-        
-        // TODO: Implement actual pixel data copy from wlr_buffer
-        // This would involve:
-        // 1. Mapping the DMA-BUF for reading
-        // 2. Converting pixel format if necessary
-        // 3. Copying scanlines with proper stride handling
-        
-        // Placeholder: Fill with test pattern
-        memset(map.data, 0x80, map.size); // Gray fill for now
-        
-        gst_buffer_unmap(gst_buffer, &map);
-    } else {
-        Debug::log(ERR, "HyprlandFrameSource: Failed to map GStreamer buffer");
-        gst_buffer_unref(gst_buffer);
+
+    GstBuffer* gst_buffer = gst_buffer_new();
+
+    gsize offsets[GST_VIDEO_MAX_PLANES] = {0};
+    gint strides[GST_VIDEO_MAX_PLANES] = {0};
+    gsize mem_base = 0;
+    int last_fd = -1;
+
+    for (int i = 0; i < attrs.n_planes && i < GST_VIDEO_MAX_PLANES; i++) {
+        // Planes commonly share one fd, only wrap each distinct fd once
+        if (attrs.fd[i] != last_fd) {
+            off_t fd_size = lseek(attrs.fd[i], 0, SEEK_END);
+            if (fd_size <= 0) {
+                GST_ERROR_OBJECT(src, "Unable to size DMA-BUF fd %d", attrs.fd[i]);
+                gst_buffer_unref(gst_buffer);
+                return NULL;
+            }
+
+            if (last_fd != -1) {
+                mem_base = gst_buffer_get_size(gst_buffer);
+            }
+
+            // wlroots owns the fds, GStreamer must not close them
+            GstMemory* mem = gst_dmabuf_allocator_alloc_with_flags(src->dmabuf_allocator, attrs.fd[i], fd_size,
+                                                                   GST_FD_MEMORY_FLAG_DONT_CLOSE);
+            if (!mem) {
+                GST_ERROR_OBJECT(src, "Failed to wrap DMA-BUF fd %d", attrs.fd[i]);
+                gst_buffer_unref(gst_buffer);
+                return NULL;
+            }
+
+            gst_buffer_append_memory(gst_buffer, mem);
+            last_fd = attrs.fd[i];
+        }
+
+        offsets[i] = mem_base + attrs.offset[i];
+        strides[i] = attrs.stride[i];
+    }
+
+    GstVideoFormat meta_format = src->use_dmabuf ? GST_VIDEO_FORMAT_DMA_DRM : drm_format_to_gst_format(attrs.format);
+    gst_buffer_add_video_meta_full(gst_buffer, GST_VIDEO_FRAME_FLAG_NONE, meta_format, attrs.width, attrs.height,
+                                   attrs.n_planes, offsets, strides);
+
+    // Keep the scanout buffer alive until the last downstream user drops the GstBuffer
+    wlr_buffer_lock(wlr_buf);
+    gst_mini_object_set_qdata(GST_MINI_OBJECT(gst_buffer),
+                              g_quark_from_static_string("wlr_buffer_ref"),
+                              wlr_buf,
+                              (GDestroyNotify)wlr_buffer_unlock);
+
+    return gst_buffer;
+}
+
+// Helper: Copy a data-pointer accessible wlr_buffer into system memory
+static GstBuffer* wlr_shm_to_gst_buffer(wlr_buffer* wlr_buf) {
+    void* data = NULL;
+    uint32_t format = 0;
+    size_t stride = 0;
+    if (!wlr_buffer_begin_data_ptr_access(wlr_buf, WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
+        GST_ERROR("Buffer is neither DMA-BUF nor CPU accessible");
         return NULL;
     }
-    
+
+    gsize buffer_size = stride * wlr_buf->height;
+    GstBuffer* gst_buffer = gst_buffer_new_memdup(data, buffer_size);
+    wlr_buffer_end_data_ptr_access(wlr_buf);
+
+    gsize offsets[GST_VIDEO_MAX_PLANES] = {0};
+    gint strides[GST_VIDEO_MAX_PLANES] = {(gint)stride};
+    gst_buffer_add_video_meta_full(gst_buffer, GST_VIDEO_FRAME_FLAG_NONE, drm_format_to_gst_format(format),
+                                   wlr_buf->width, wlr_buf->height, 1, offsets, strides);
+
     return gst_buffer;
 }
 
 // Helper: Convert DRM format to GStreamer format
 static GstVideoFormat drm_format_to_gst_format(uint32_t drm_format) {
     switch (drm_format) {
+        // DRM fourccs are little-endian packed, GStreamer names are byte order
         case DRM_FORMAT_XRGB8888:
+            return GST_VIDEO_FORMAT_BGRx;
         case DRM_FORMAT_ARGB8888:
-            return GST_VIDEO_FORMAT_RGBx;
+            return GST_VIDEO_FORMAT_BGRA;
         case DRM_FORMAT_XBGR8888:
+            return GST_VIDEO_FORMAT_RGBx;
         case DRM_FORMAT_ABGR8888:
-            return GST_VIDEO_FORMAT_BGRx;
+            return GST_VIDEO_FORMAT_RGBA;
         default:
-            Debug::log(WARN, "HyprlandFrameSource: Unsupported DRM format: {}", drm_format);
-            return GST_VIDEO_FORMAT_RGBx; // Fallback
+            GST_WARNING("Unsupported DRM format: 0x%08x", drm_format);
+            return GST_VIDEO_FORMAT_BGRx; // Fallback
+    }
+}
+
+// Helper: memory:DMABuf caps for a fourcc/modifier pair, e.g. drm-format=XR24:0x0100000000000001
+static GstCaps* build_dmabuf_caps(uint32_t drm_format, uint64_t drm_modifier) {
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+        "format", G_TYPE_STRING, "DMA_DRM",
+        NULL);
+    gst_caps_set_features_simple(caps, gst_caps_features_new(GST_CAPS_FEATURE_MEMORY_DMABUF, NULL));
+
+    // Unknown fourcc: leave drm-format open and let downstream pick
+    if (gchar* drm_format_str = gst_video_dma_drm_fourcc_to_string(drm_format, drm_modifier)) {
+        gst_caps_set_simple(caps, "drm-format", G_TYPE_STRING, drm_format_str, NULL);
+        g_free(drm_format_str);
     }
+
+    return caps;
 }
 
 // Plugin registration
 gboolean gst_hyprland_frame_src_plugin_init(GstPlugin* plugin) {
-    GST_DEBUG_CATEGORY_INIT(gst_hyprland_frame_src_debug, "hyprlandframesrc", 0, "Hyprland Frame Source");
-    
     return gst_element_register(plugin, "hyprlandframesrc", GST_RANK_NONE, GST_TYPE_HYPRLAND_FRAME_SRC);
 }
\ No newline at end of file
@@ -3,8 +3,13 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasesrc.h>
 #include <gst/video/video.h>
+#include <gst/allocators/gstdmabuf.h>
+extern "C" {
 #include <wlr/interfaces/wlr_buffer.h>
-#include "helpers/Monitor.hpp"
+#include <wlr/render/dmabuf.h>
+}
+#include <pixman.h>
+#include <atomic>
 
 G_BEGIN_DECLS
 
@@ -28,15 +33,27 @@ struct _GstHyprlandFrameSrc {
     gchar* format;
     
     // State
-    gboolean started;
-    GstClockTime timestamp;
+    std::atomic<gboolean> started;
+    GstClockTime timestamp; // PTS of the last frame pushed downstream
     guint64 frame_count;
     
-    // Buffer management
-    GMutex buffer_mutex;
-    GCond buffer_cond;
-    GstBuffer* current_buffer;
-    gboolean new_frame_available;
+    // Buffer management: a latest-wins mailbox, the compositor swaps the newest frame in and never blocks,
+    // create() swaps it out and sleeps on the eventfd while it's empty
+    std::atomic<GstBuffer*> pending_buffer;
+    int wake_fd;
+    std::atomic<gboolean> flushing;
+
+    // Frame counters, exposed as read-only properties
+    std::atomic<guint64> frames_pushed;      // handed to the mailbox
+    std::atomic<guint64> frames_overwritten; // replaced by a newer frame before create() picked them up
+    std::atomic<guint64> frames_dropped;     // rejected: not started, flushing or not convertible
+
+    // DMA-BUF export
+    GstAllocator* dmabuf_allocator;
+    std::atomic<guint32> drm_format;   // DRM fourcc of the last pushed frame
+    std::atomic<guint64> drm_modifier; // DRM modifier of the last pushed frame
+    std::atomic<gboolean> caps_dirty;  // format/modifier changed since last negotiation
+    gboolean use_dmabuf;               // negotiated caps carry memory:DMABuf
     
     // Monitor tracking
     gpointer monitor; // PHLMONITOR (void* to avoid header deps)
@@ -49,8 +66,13 @@ struct _GstHyprlandFrameSrcClass {
 // GObject type registration
 GType gst_hyprland_frame_src_get_type(void);
 
-// Public API for pushing frames from Hyprland
-void gst_hyprland_frame_src_push_buffer(GstHyprlandFrameSrc* src, wlr_buffer* buffer);
+// Public API for pushing frames from Hyprland, damage rects (buffer coordinates) become GstVideoRegionOfInterestMeta.
+// capture_ns is the CLOCK_MONOTONIC vblank the frame was rendered for, it drives PTS when known.
+void gst_hyprland_frame_src_push_buffer(GstHyprlandFrameSrc* src, wlr_buffer* buffer, const pixman_box32_t* damage, int n_damage,
+                                        GstClockTime capture_ns = GST_CLOCK_TIME_NONE);
+
+// Same mailbox for a frame that is already a GstBuffer (e.g. copied out of CPU memory), takes ownership of it
+void gst_hyprland_frame_src_push_gst_buffer(GstHyprlandFrameSrc* src, GstBuffer* buffer);
 
 // Registration function
 gboolean gst_hyprland_frame_src_plugin_init(GstPlugin* plugin);
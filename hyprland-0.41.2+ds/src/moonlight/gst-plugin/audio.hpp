@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstring>
 #include <gst-plugin/gstrtpmoonlightpay_audio.hpp>
 #include <gst-plugin/utils.hpp>
 #include <core/logger.hpp>
@@ -27,6 +28,19 @@ struct AudioFECPacket {
 constexpr auto RTP_HEADER_SIZE = sizeof(AudioRTPHeaders);
 constexpr auto FEC_HEADER_SIZE = sizeof(AudioFECPacket);
 
+/**
+ * Writes the RTP header at \p packet, the memory is expected to be zeroed
+ */
+static void fill_rtp_header(const gst_rtp_moonlight_pay_audio &rtpmoonlightpay, AudioRTPHeaders *packet) {
+  packet->rtp.header = 0x80;
+  packet->rtp.packetType = 97;
+  packet->rtp.ssrc = 0;
+
+  auto timestamp = rtpmoonlightpay.cur_seq_number * rtpmoonlightpay.packet_duration;
+  packet->rtp.sequenceNumber = boost::endian::native_to_big((uint16_t)rtpmoonlightpay.cur_seq_number);
+  packet->rtp.timestamp = boost::endian::native_to_big((uint32_t)timestamp);
+}
+
 /**
  * Creates an RTP header and returns a GstBuffer to it
  */
@@ -38,15 +52,7 @@ static GstBuffer *create_rtp_header(const gst_rtp_moonlight_pay_audio &rtpmoonli
   gst_buffer_map(buf, &info, GST_MAP_WRITE);
 
   /* set RTP headers */
-  auto packet = (AudioRTPHeaders *)info.data;
-
-  packet->rtp.header = 0x80;
-  packet->rtp.packetType = 97;
-  packet->rtp.ssrc = 0;
-
-  auto timestamp = rtpmoonlightpay.cur_seq_number * rtpmoonlightpay.packet_duration;
-  packet->rtp.sequenceNumber = boost::endian::native_to_big((uint16_t)rtpmoonlightpay.cur_seq_number);
-  packet->rtp.timestamp = boost::endian::native_to_big((uint32_t)timestamp);
+  fill_rtp_header(rtpmoonlightpay, (AudioRTPHeaders *)info.data);
 
   gst_buffer_unmap(buf, &info);
 
@@ -84,16 +90,50 @@ static GstBuffer *create_rtp_fec_header(const gst_rtp_moonlight_pay_audio &rtpmo
   return buf;
 }
 
-static GstBuffer *create_rtp_audio_buffer(const gst_rtp_moonlight_pay_audio &rtpmoonlightpay, GstBuffer *inbuf) {
-  GstBuffer *payload = inbuf;
+/**
+ * Encrypts the payload straight after the RTP header in a single buffer,
+ * the AES context is created once and only the IV changes between packets
+ */
+static GstBuffer *create_encrypted_rtp_audio_buffer(gst_rtp_moonlight_pay_audio &rtpmoonlightpay, GstBuffer *inbuf) {
+  if (rtpmoonlightpay.encryptor == nullptr) {
+    rtpmoonlightpay.encryptor =
+        new crypto::aes_encryptor(crypto::aes_encryptor::mode::CBC, rtpmoonlightpay.aes_key, true);
+    rtpmoonlightpay.aes_iv_base = std::stoul(rtpmoonlightpay.aes_iv);
+  }
+
+  GstMapInfo in_info;
+  gst_buffer_map(inbuf, &in_info, GST_MAP_READ);
+
+  auto max_size = RTP_HEADER_SIZE + crypto::aes_encryptor::max_encrypted_size(in_info.size);
+  GstBuffer *full_rtp_buf = gst_buffer_new_allocate(nullptr, max_size, nullptr);
+
+  GstMapInfo info;
+  gst_buffer_map(full_rtp_buf, &info, GST_MAP_WRITE);
+
+  std::memset(info.data, 0, RTP_HEADER_SIZE);
+  fill_rtp_header(rtpmoonlightpay, (AudioRTPHeaders *)info.data);
+
+  auto iv = derive_iv(rtpmoonlightpay.aes_iv_base, rtpmoonlightpay.cur_seq_number);
+  auto encrypted_size = rtpmoonlightpay.encryptor->encrypt({(char *)in_info.data, in_info.size},
+                                                           {(char *)iv.data(), iv.size()},
+                                                           info.data + RTP_HEADER_SIZE);
+
+  gst_buffer_unmap(full_rtp_buf, &info);
+  gst_buffer_unmap(inbuf, &in_info);
+
+  gst_buffer_set_size(full_rtp_buf, RTP_HEADER_SIZE + encrypted_size);
+  gst_copy_timestamps(inbuf, full_rtp_buf);
+
+  return full_rtp_buf;
+}
 
+static GstBuffer *create_rtp_audio_buffer(gst_rtp_moonlight_pay_audio &rtpmoonlightpay, GstBuffer *inbuf) {
   if (rtpmoonlightpay.encrypt) {
-    auto derived_iv = derive_iv(rtpmoonlightpay.aes_iv, rtpmoonlightpay.cur_seq_number);
-    payload = encrypt_payload(rtpmoonlightpay.aes_key, derived_iv, inbuf);
+    return create_encrypted_rtp_audio_buffer(rtpmoonlightpay, inbuf);
   }
 
   auto rtp_header = create_rtp_header(rtpmoonlightpay);
-  auto full_rtp_buf = gst_buffer_append(rtp_header, payload);
+  auto full_rtp_buf = gst_buffer_append(rtp_header, gst_buffer_ref(inbuf));
   gst_copy_timestamps(inbuf, full_rtp_buf);
 
   return full_rtp_buf;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <gst/gst.h>
+#include <time.h>
+
+/**
+ * Every captured frame carries the time it was rendered for as a GstReferenceTimestampMeta:
+ * CLOCK_MONOTONIC nanoseconds, the same clock that wlr_output present events (and wp_presentation) report.
+ *
+ * Unlike PTS this survives the pipeline clock being replaced and is still there once the frame has been encoded,
+ * so that the payloader can compute how long it took from capture to the wire.
+ */
+inline GstCaps *capture_timestamp_caps() {
+  static GstCaps *caps = gst_caps_new_empty_simple("timestamp/x-moonlight-capture");
+  return caps;
+}
+
+/**
+ * @return the current CLOCK_MONOTONIC time in nanoseconds
+ */
+inline GstClockTime monotonic_now_ns() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return GST_TIMESPEC_TO_TIME(now);
+}
+
+inline void gst_buffer_set_capture_timestamp(GstBuffer *buf, GstClockTime capture_ns) {
+  gst_buffer_add_reference_timestamp_meta(buf, capture_timestamp_caps(), capture_ns, GST_CLOCK_TIME_NONE);
+}
+
+/**
+ * @return the capture time attached to buf or GST_CLOCK_TIME_NONE if there's none
+ */
+inline GstClockTime gst_buffer_get_capture_timestamp(GstBuffer *buf) {
+  auto meta = gst_buffer_get_reference_timestamp_meta(buf, capture_timestamp_caps());
+  return meta ? meta->timestamp : GST_CLOCK_TIME_NONE;
+}
+
+/**
+ * Maps a CLOCK_MONOTONIC time onto the running time of element.
+ *
+ * The pipeline clock isn't necessarily monotonic based (ex: a network or audio clock),
+ * so the offset between the two is sampled every time instead of assuming they match.
+ *
+ * @return GST_CLOCK_TIME_NONE when the element has no clock yet (not PLAYING)
+ */
+inline GstClockTime capture_to_running_time(GstElement *element, GstClockTime capture_ns) {
+  GstClock *clock = gst_element_get_clock(element);
+  if (!clock || !GST_CLOCK_TIME_IS_VALID(capture_ns)) {
+    if (clock)
+      gst_object_unref(clock);
+    return GST_CLOCK_TIME_NONE;
+  }
+
+  GstClockTimeDiff clock_now = (GstClockTimeDiff)gst_clock_get_time(clock);
+  GstClockTimeDiff age = (GstClockTimeDiff)monotonic_now_ns() - (GstClockTimeDiff)capture_ns;
+  gst_object_unref(clock);
+
+  GstClockTimeDiff running_time = clock_now - age - (GstClockTimeDiff)gst_element_get_base_time(element);
+  return running_time > 0 ? (GstClockTime)running_time : 0;
+}
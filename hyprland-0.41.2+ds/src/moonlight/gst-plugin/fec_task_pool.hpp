@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gst_moonlight_video {
+
+/**
+ * A small fork-join pool used to encode the FEC blocks of a single frame in parallel.
+ *
+ * The calling thread takes part in the work: every participant keeps claiming the next pending task until there are
+ * none left, so an idle thread always picks up whatever a busy one hasn't started yet.
+ * `run()` only returns once all the tasks are completed.
+ *
+ * Each participant is identified by a slot (0 is always the calling thread) so that tasks can use per thread state,
+ * ex: Reed Solomon instances which can't be shared between concurrent encoders.
+ */
+class fec_task_pool {
+public:
+  explicit fec_task_pool(int workers) {
+    for (int slot = 1; slot <= workers; slot++) {
+      threads.emplace_back([this, slot]() { worker_loop(slot); });
+    }
+  }
+
+  ~fec_task_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake_up.notify_all();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  fec_task_pool(const fec_task_pool &) = delete;
+  fec_task_pool &operator=(const fec_task_pool &) = delete;
+
+  /**
+   * @return the number of participants, including the calling thread
+   */
+  int slots() const {
+    return (int)threads.size() + 1;
+  }
+
+  /**
+   * Runs `task(task_idx, slot)` for every task_idx in [0, nr_tasks) and waits for all of them to finish
+   */
+  void run(int nr_tasks, const std::function<void(int /* task_idx */, int /* slot */)> &task) {
+    if (threads.empty() || nr_tasks <= 1) {
+      for (int task_idx = 0; task_idx < nr_tasks; task_idx++) {
+        task(task_idx, 0);
+      }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending = nr_tasks;
+      current_task = &task;
+      total_tasks = nr_tasks;
+      next_task.store(0); // publishes the above to the workers claiming tasks
+      generation++;
+    }
+    wake_up.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this]() { return pending.load() == 0; });
+  }
+
+private:
+  void work(int slot) {
+    for (int task_idx = next_task.fetch_add(1); task_idx < total_tasks; task_idx = next_task.fetch_add(1)) {
+      (*current_task)(task_idx, slot);
+      if (pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        all_done.notify_one();
+      }
+    }
+  }
+
+  void worker_loop(int slot) {
+    std::uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake_up.wait(lock, [&]() { return stopping || generation != seen_generation; });
+      if (stopping) {
+        return;
+      }
+      seen_generation = generation;
+
+      lock.unlock();
+      work(slot);
+      lock.lock();
+    }
+  }
+
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable wake_up;
+  std::condition_variable all_done;
+  bool stopping = false;
+  std::uint64_t generation = 0;
+
+  const std::function<void(int, int)> *current_task = nullptr;
+  std::atomic<int> total_tasks = 0;
+  std::atomic<int> next_task = 0;
+  std::atomic<int> pending = 0;
+};
+
+} // namespace gst_moonlight_video
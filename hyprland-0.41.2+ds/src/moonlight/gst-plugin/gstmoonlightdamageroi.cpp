@@ -0,0 +1,265 @@
+/**
+ * SECTION:element-gstmoonlightdamageroi
+ *
+ * The moonlightdamageroi element is an in-place filter that turns the compositor damage attached to each frame
+ * (GstVideoRegionOfInterestMeta with roi_type "damage") into the encoder specific parameters that the
+ * hardware encoders read to build their per-macroblock QP map.
+ *
+ * Only vaapi*enc (reads "roi/vaapi") and msdk*enc (reads "roi/msdk") consume these. When roi-param isn't set the
+ * name is picked from the downstream encoder; for any other encoder the hints are ignored.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 hyprlandframesrc ! vaapipostproc ! moonlightdamageroi delta-qp=-4 ! vaapih264enc ! fakesink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst-plugin/gstmoonlightdamageroi.hpp>
+#include <gst/base/gstbasetransform.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_moonlight_damage_roi_debug_category);
+#define GST_CAT_DEFAULT gst_moonlight_damage_roi_debug_category
+
+/* prototypes */
+
+static void
+gst_moonlight_damage_roi_set_property(GObject *object, guint property_id, const GValue *value, GParamSpec *pspec);
+static void
+gst_moonlight_damage_roi_get_property(GObject *object, guint property_id, GValue *value, GParamSpec *pspec);
+static void gst_moonlight_damage_roi_finalize(GObject *object);
+
+static GstFlowReturn gst_moonlight_damage_roi_transform_ip(GstBaseTransform *trans, GstBuffer *buf);
+
+enum {
+  PROP_0,
+
+  /**
+   * Name of the parameter structure the downstream encoder looks up, ex: "roi/vaapi".
+   * NULL (the default) picks it from the downstream encoder.
+   */
+  PROP_ROI_PARAM,
+
+  /**
+   * QP offset applied to damaged regions, negative values spend more bits where the screen changed
+   */
+  PROP_DELTA_QP,
+};
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_moonlight_damage_roi_src_template = GST_STATIC_PAD_TEMPLATE(
+    "src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS("ANY"));
+
+static GstStaticPadTemplate gst_moonlight_damage_roi_sink_template = GST_STATIC_PAD_TEMPLATE(
+    "sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS("ANY"));
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE(gst_moonlight_damage_roi,
+                        gst_moonlight_damage_roi,
+                        GST_TYPE_BASE_TRANSFORM,
+                        GST_DEBUG_CATEGORY_INIT(gst_moonlight_damage_roi_debug_category,
+                                                "moonlightdamageroi",
+                                                0,
+                                                "debug category for moonlightdamageroi element"));
+
+static void gst_moonlight_damage_roi_class_init(gst_moonlight_damage_roiClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstBaseTransformClass *base_transform_class = GST_BASE_TRANSFORM_CLASS(klass);
+
+  gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &gst_moonlight_damage_roi_src_template);
+  gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &gst_moonlight_damage_roi_sink_template);
+
+  gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
+                                        "Moonlight damage ROI",
+                                        "Filter/Video",
+                                        "Maps compositor damage regions to encoder ROI parameters",
+                                        "Hyprland Moonlight Integration");
+
+  gobject_class->set_property = gst_moonlight_damage_roi_set_property;
+  gobject_class->get_property = gst_moonlight_damage_roi_get_property;
+  gobject_class->finalize = gst_moonlight_damage_roi_finalize;
+
+  g_object_class_install_property(gobject_class,
+                                  PROP_ROI_PARAM,
+                                  g_param_spec_string("roi-param",
+                                                      "roi-param",
+                                                      "Name of the parameter structure the downstream encoder looks "
+                                                      "up, unset to pick it from the downstream encoder",
+                                                      nullptr,
+                                                      G_PARAM_READWRITE));
+
+  g_object_class_install_property(gobject_class,
+                                  PROP_DELTA_QP,
+                                  g_param_spec_int("delta-qp",
+                                                   "delta-qp",
+                                                   "QP offset applied to damaged regions",
+                                                   -51,
+                                                   51,
+                                                   -4,
+                                                   G_PARAM_READWRITE));
+
+  base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_moonlight_damage_roi_transform_ip);
+}
+
+static void gst_moonlight_damage_roi_init(gst_moonlight_damage_roi *damage_roi) {
+  damage_roi->roi_param = nullptr;
+  damage_roi->delta_qp = -4;
+  damage_roi->detected_param = nullptr;
+  damage_roi->detected = FALSE;
+
+  /* In place: if upstream still holds a ref the base class makes a metadata-only copy, pixels are never touched */
+  gst_base_transform_set_in_place(GST_BASE_TRANSFORM(damage_roi), TRUE);
+}
+
+void gst_moonlight_damage_roi_set_property(GObject *object,
+                                           guint property_id,
+                                           const GValue *value,
+                                           GParamSpec *pspec) {
+  gst_moonlight_damage_roi *damage_roi = gst_moonlight_damage_roi(object);
+
+  GST_DEBUG_OBJECT(damage_roi, "set_property");
+
+  switch (property_id) {
+  case PROP_ROI_PARAM:
+    g_free(damage_roi->roi_param);
+    damage_roi->roi_param = g_value_dup_string(value);
+    damage_roi->detected = FALSE;
+    break;
+  case PROP_DELTA_QP:
+    damage_roi->delta_qp = g_value_get_int(value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+    break;
+  }
+}
+
+void gst_moonlight_damage_roi_get_property(GObject *object, guint property_id, GValue *value, GParamSpec *pspec) {
+  gst_moonlight_damage_roi *damage_roi = gst_moonlight_damage_roi(object);
+
+  GST_DEBUG_OBJECT(damage_roi, "get_property");
+
+  switch (property_id) {
+  case PROP_ROI_PARAM:
+    g_value_set_string(value, damage_roi->roi_param);
+    break;
+  case PROP_DELTA_QP:
+    g_value_set_int(value, damage_roi->delta_qp);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+    break;
+  }
+}
+
+void gst_moonlight_damage_roi_finalize(GObject *object) {
+  gst_moonlight_damage_roi *damage_roi = gst_moonlight_damage_roi(object);
+
+  GST_DEBUG_OBJECT(damage_roi, "finalize");
+
+  g_free(damage_roi->roi_param);
+  g_free(damage_roi->detected_param);
+
+  G_OBJECT_CLASS(gst_moonlight_damage_roi_parent_class)->finalize(object);
+}
+
+/**
+ * The first encoder downstream, following the first src pad of whatever sits in between (parsers, queues, capsfilters)
+ */
+static GstElement *find_downstream_encoder(GstElement *element) {
+  GstElement *current = GST_ELEMENT(gst_object_ref(element));
+
+  for (int hops = 0; hops < 16 && current; hops++) {
+    GstPad *src = gst_element_get_static_pad(current, "src");
+    gst_object_unref(current);
+    current = nullptr;
+    if (!src)
+      break;
+
+    GstPad *peer = gst_pad_get_peer(src);
+    gst_object_unref(src);
+    if (!peer)
+      break;
+
+    current = gst_pad_get_parent_element(peer);
+    gst_object_unref(peer);
+    if (!current)
+      break;
+
+    GstElementFactory *factory = gst_element_get_factory(current);
+    const gchar *klass = factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : nullptr;
+    if (klass && g_strrstr(klass, "Encoder"))
+      return current;
+  }
+
+  if (current)
+    gst_object_unref(current);
+  return nullptr;
+}
+
+/**
+ * Picks the ROI param structure name from the downstream encoder, NULL when it doesn't read any
+ */
+static gchar *detect_roi_param(gst_moonlight_damage_roi *damage_roi) {
+  GstElement *encoder = find_downstream_encoder(GST_ELEMENT(damage_roi));
+  if (!encoder) {
+    GST_WARNING_OBJECT(damage_roi, "No encoder downstream, damage won't be turned into ROI hints");
+    return nullptr;
+  }
+
+  GstElementFactory *factory = gst_element_get_factory(encoder);
+  const gchar *name = factory ? gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)) : "";
+  gchar *param = nullptr;
+  if (g_str_has_prefix(name, "vaapi"))
+    param = g_strdup("roi/vaapi");
+  else if (g_str_has_prefix(name, "msdk"))
+    param = g_strdup("roi/msdk");
+  else
+    GST_INFO_OBJECT(damage_roi, "%s doesn't read ROI hints, damage is passed through untouched", name);
+
+  gst_object_unref(encoder);
+  return param;
+}
+
+/**
+ * Frames without damage (ex: keep-alive repeats) carry no ROI and get the encoder defaults everywhere.
+ */
+static GstFlowReturn gst_moonlight_damage_roi_transform_ip(GstBaseTransform *trans, GstBuffer *buf) {
+  gst_moonlight_damage_roi *damage_roi = gst_moonlight_damage_roi(trans);
+
+  // Buffers only flow once the pipeline is linked, so the encoder is there by now
+  if (!damage_roi->roi_param && !damage_roi->detected) {
+    g_free(damage_roi->detected_param);
+    damage_roi->detected_param = detect_roi_param(damage_roi);
+    damage_roi->detected = TRUE;
+  }
+
+  const gchar *roi_param = damage_roi->roi_param ? damage_roi->roi_param : damage_roi->detected_param;
+  if (!roi_param)
+    return GST_FLOW_OK;
+
+  gpointer state = nullptr;
+  GstMeta *meta;
+  while ((meta = gst_buffer_iterate_meta_filtered(buf, &state, GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE))) {
+    auto roi = (GstVideoRegionOfInterestMeta *)meta;
+    if (roi->roi_type != g_quark_from_static_string("damage"))
+      continue;
+
+    if (!gst_video_region_of_interest_meta_get_param(roi, roi_param)) {
+      gst_video_region_of_interest_meta_add_param(
+          roi,
+          gst_structure_new(roi_param, "delta-qp", G_TYPE_INT, damage_roi->delta_qp, nullptr));
+    }
+  }
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define gst_TYPE_moonlight_damage_roi (gst_moonlight_damage_roi_get_type())
+#define gst_moonlight_damage_roi(obj)                                                                                  \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), gst_TYPE_moonlight_damage_roi, gst_moonlight_damage_roi))
+#define gst_moonlight_damage_roi_CLASS(klass)                                                                          \
+  (G_TYPE_CHECK_CLASS_CAST((klass), gst_TYPE_moonlight_damage_roi, gst_moonlight_damage_roiClass))
+#define gst_IS_moonlight_damage_roi(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), gst_TYPE_moonlight_damage_roi))
+#define gst_IS_moonlight_damage_roi_CLASS(obj) (G_TYPE_CHECK_CLASS_TYPE((klass), gst_TYPE_moonlight_damage_roi))
+
+typedef struct _gst_moonlight_damage_roi gst_moonlight_damage_roi;
+typedef struct _gst_moonlight_damage_roiClass gst_moonlight_damage_roiClass;
+
+struct _gst_moonlight_damage_roi {
+  GstBaseTransform base_moonlight_damage_roi;
+
+  gchar *roi_param;
+  int delta_qp;
+
+  gchar *detected_param; // picked from the downstream encoder when roi_param isn't set
+  gboolean detected;
+};
+
+struct _gst_moonlight_damage_roiClass {
+  GstBaseTransformClass base_moonlight_damage_roi_class;
+};
+
+GType gst_moonlight_damage_roi_get_type(void);
+
+G_END_DECLS
@@ -140,6 +140,7 @@ static void gst_rtp_moonlight_pay_audio_init(gst_rtp_moonlight_pay_audio *rtpmoo
   rtpmoonlightpay_audio->cur_seq_number = 0;
 
   rtpmoonlightpay_audio->encrypt = true;
+  rtpmoonlightpay_audio->encryptor = nullptr;
 
   rtpmoonlightpay_audio->packet_duration = 5;
   rtpmoonlightpay_audio->packets_buffer = new unsigned char *[AUDIO_TOTAL_SHARDS];
@@ -166,9 +167,13 @@ void gst_rtp_moonlight_pay_audio_set_property(GObject *object,
     break;
   case PROP_AES_KEY:
     rtpmoonlightpay_audio->aes_key = crypto::hex_to_str(g_value_get_string(value), true);
+    delete rtpmoonlightpay_audio->encryptor;
+    rtpmoonlightpay_audio->encryptor = nullptr;
     break;
   case PROP_AES_IV:
     rtpmoonlightpay_audio->aes_iv = g_value_get_string(value);
+    delete rtpmoonlightpay_audio->encryptor;
+    rtpmoonlightpay_audio->encryptor = nullptr;
     break;
   case PROP_PACKET_DURATION:
     rtpmoonlightpay_audio->packet_duration = g_value_get_int(value);
@@ -222,6 +227,8 @@ void gst_rtp_moonlight_pay_audio_finalize(GObject *object) {
 
   GST_DEBUG_OBJECT(rtpmoonlightpay_audio, "finalize");
 
+  delete rtpmoonlightpay_audio->encryptor;
+
   G_OBJECT_CLASS(gst_rtp_moonlight_pay_audio_parent_class)->finalize(object);
 }
 
@@ -3,6 +3,7 @@
 #include <array>
 #include <gst/base/gstbasetransform.h>
 #include <moonlight/fec.hpp>
+#include <protocol/crypto/crypto/crypto.hpp>
 #include <vector>
 
 constexpr int AUDIO_DATA_SHARDS = 4;
@@ -39,6 +40,12 @@ struct _gst_rtp_moonlight_pay_audio {
   std::string aes_key;
   std::string aes_iv;
 
+  /**
+   * Created on the first encrypted packet, reset whenever the key or the IV change
+   */
+  crypto::aes_encryptor *encryptor;
+  std::uint32_t aes_iv_base;
+
   int packet_duration;
 
   unsigned char **packets_buffer;
@@ -16,6 +16,7 @@
 #include "config.h"
 #endif
 
+#include <gst-plugin/capture_timestamp.hpp>
 #include <gst-plugin/gstrtpmoonlightpay_video.hpp>
 #include <gst-plugin/video.hpp>
 #include <gst/base/gstbasetransform.h>
@@ -55,6 +56,21 @@ enum {
    * Minimum number of FEC packages required by Moonlight
    */
   PROP_MIN_REQUIRED_FEC_PACKETS = 22,
+
+  /**
+   * If TRUE each RTP packet is written into a single buffer taken from a preallocated pool
+   */
+  PROP_POOL_PACKETS = 23,
+
+  /**
+   * Number of threads used to encode FEC blocks of large frames, 0 shares the cores between the running sessions
+   */
+  PROP_FEC_THREADS = 24,
+
+  /**
+   * Read only: nanoseconds between capture and the RTP packets of the last frame being handed to the sink
+   */
+  PROP_CAPTURE_LATENCY = 25,
 };
 
 /* pad templates */
@@ -135,6 +151,37 @@ static void gst_rtp_moonlight_pay_video_class_init(gst_rtp_moonlight_pay_videoCl
                                                    2,
                                                    G_PARAM_READWRITE));
 
+  g_object_class_install_property(
+      gobject_class,
+      PROP_POOL_PACKETS,
+      g_param_spec_boolean("pool_packets",
+                           "pool_packets",
+                           "If TRUE each RTP packet is written into a single buffer taken from a preallocated pool",
+                           TRUE,
+                           G_PARAM_READWRITE));
+
+  g_object_class_install_property(
+      gobject_class,
+      PROP_FEC_THREADS,
+      g_param_spec_int("fec_threads",
+                       "fec_threads",
+                       "Threads used to encode the FEC blocks of large frames, 0 shares the cores between sessions",
+                       0,
+                       64,
+                       0,
+                       G_PARAM_READWRITE));
+
+  g_object_class_install_property(
+      gobject_class,
+      PROP_CAPTURE_LATENCY,
+      g_param_spec_uint64("capture_latency",
+                          "capture_latency",
+                          "Nanoseconds between capture and sending the last frame, 0 when frames carry no capture time",
+                          0,
+                          G_MAXUINT64,
+                          0,
+                          G_PARAM_READABLE));
+
   gobject_class->dispose = gst_rtp_moonlight_pay_video_dispose;
   gobject_class->finalize = gst_rtp_moonlight_pay_video_finalize;
 
@@ -150,6 +197,17 @@ static void gst_rtp_moonlight_pay_video_init(gst_rtp_moonlight_pay_video *rtpmoo
 
   rtpmoonlightpay_video->cur_seq_number = 0;
   rtpmoonlightpay_video->frame_num = 0;
+
+  rtpmoonlightpay_video->fec_threads = 0;
+  rtpmoonlightpay_video->fec_pool = nullptr;
+  rtpmoonlightpay_video->fec_states = new std::vector<fec_encoder_state>(1);
+  active_video_payloaders++;
+
+  rtpmoonlightpay_video->pool_packets = true;
+  rtpmoonlightpay_video->packet_pool = nullptr;
+  rtpmoonlightpay_video->packet_pool_size = 0;
+
+  rtpmoonlightpay_video->capture_latency = 0;
 }
 
 void gst_rtp_moonlight_pay_video_set_property(GObject *object,
@@ -173,6 +231,12 @@ void gst_rtp_moonlight_pay_video_set_property(GObject *object,
   case PROP_MIN_REQUIRED_FEC_PACKETS:
     rtpmoonlightpay_video->min_required_fec_packets = g_value_get_int(value);
     break;
+  case PROP_POOL_PACKETS:
+    rtpmoonlightpay_video->pool_packets = g_value_get_boolean(value);
+    break;
+  case PROP_FEC_THREADS:
+    rtpmoonlightpay_video->fec_threads = g_value_get_int(value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
     break;
@@ -197,6 +261,15 @@ void gst_rtp_moonlight_pay_video_get_property(GObject *object, guint property_id
   case PROP_MIN_REQUIRED_FEC_PACKETS:
     g_value_set_int(value, rtpmoonlightpay_video->min_required_fec_packets);
     break;
+  case PROP_POOL_PACKETS:
+    g_value_set_boolean(value, rtpmoonlightpay_video->pool_packets);
+    break;
+  case PROP_FEC_THREADS:
+    g_value_set_int(value, rtpmoonlightpay_video->fec_threads);
+    break;
+  case PROP_CAPTURE_LATENCY:
+    g_value_set_uint64(value, rtpmoonlightpay_video->capture_latency.load());
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
     break;
@@ -209,6 +282,11 @@ void gst_rtp_moonlight_pay_video_dispose(GObject *object) {
   GST_DEBUG_OBJECT(rtpmoonlightpay_video, "dispose");
 
   /* clean up as possible.  may be called multiple times */
+  if (rtpmoonlightpay_video->packet_pool) {
+    gst_buffer_pool_set_active(rtpmoonlightpay_video->packet_pool, FALSE);
+    gst_object_unref(rtpmoonlightpay_video->packet_pool);
+    rtpmoonlightpay_video->packet_pool = nullptr;
+  }
 
   G_OBJECT_CLASS(gst_rtp_moonlight_pay_video_parent_class)->dispose(object);
 }
@@ -218,7 +296,9 @@ void gst_rtp_moonlight_pay_video_finalize(GObject *object) {
 
   GST_DEBUG_OBJECT(rtpmoonlightpay_video, "finalize");
 
-  /* clean up object here */
+  delete rtpmoonlightpay_video->fec_pool;
+  delete rtpmoonlightpay_video->fec_states;
+  active_video_payloaders--;
 
   G_OBJECT_CLASS(gst_rtp_moonlight_pay_video_parent_class)->finalize(object);
 }
@@ -241,6 +321,17 @@ static GstFlowReturn gst_rtp_moonlight_pay_video_generate_output(GstBaseTransfor
 
   auto rtp_packets = gst_moonlight_video::split_into_rtp(rtpmoonlightpay_video, inbuf);
 
+  /* How long it took from the compositor rendering this frame to its packets being ready to go out */
+  auto capture_ns = gst_buffer_get_capture_timestamp(inbuf);
+  if (GST_CLOCK_TIME_IS_VALID(capture_ns)) {
+    auto now = monotonic_now_ns();
+    rtpmoonlightpay_video->capture_latency = now > capture_ns ? now - capture_ns : 0;
+    GST_TRACE_OBJECT(rtpmoonlightpay_video,
+                     "frame %u capture to send: %" GST_TIME_FORMAT,
+                     rtpmoonlightpay_video->frame_num,
+                     GST_TIME_ARGS(rtpmoonlightpay_video->capture_latency.load()));
+  }
+
   /* Send the generated packets to any downstream listener */
   gst_pad_push_list(trans->srcpad, rtp_packets);
 
@@ -1,7 +1,30 @@
 #pragma once
 
+#include <atomic>
+#include <gst-plugin/fec_task_pool.hpp>
 #include <gst/base/gstbasetransform.h>
 #include <memory>
+#include <moonlight/fec.hpp>
+#include <vector>
+
+/**
+ * Number of packets preallocated by the RTP packet pool, enough for a typical P-frame and its FEC
+ */
+constexpr int PACKET_POOL_MIN_BUFFERS = 64;
+
+/**
+ * State that a single FEC encoding thread reuses across frames,
+ * so that it doesn't rebuild the RS matrices or allocate new shards each time
+ */
+struct fec_encoder_state {
+  moonlight::fec::rs_cache rs_cache;
+  std::vector<unsigned char> arena;
+};
+
+/**
+ * Number of rtpmoonlightpay_video elements alive, used to share the available cores between concurrent sessions
+ */
+inline std::atomic<int> active_video_payloaders = 0;
 
 G_BEGIN_DECLS
 
@@ -22,11 +45,28 @@ struct _gst_rtp_moonlight_pay_video {
   int payload_size;
   bool add_padding;
 
-  int fec_percentage;
+  /* Retuned live by the congestion controller while frames are being packetized */
+  std::atomic<int> fec_percentage;
   int min_required_fec_packets;
 
   u_int32_t cur_seq_number;
   u_int32_t frame_num;
+
+  /**
+   * Used to encode multiple FEC blocks in parallel, fec_states holds one entry for each pool slot
+   */
+  int fec_threads;
+  gst_moonlight_video::fec_task_pool *fec_pool;
+  std::vector<fec_encoder_state> *fec_states;
+
+  bool pool_packets;
+  GstBufferPool *packet_pool;
+  int packet_pool_size;
+
+  /**
+   * Capture to send time of the last frame in ns, read from the streaming thread and the property getter
+   */
+  std::atomic<guint64> capture_latency;
 };
 
 struct _gst_rtp_moonlight_pay_videoClass {
@@ -108,10 +108,17 @@ static void gst_copy_timestamps(GstBuffer *src, GstBuffer *dest) {
 /**
  * Derives the proper IV following Moonlight implementation
  */
-static std::string derive_iv(const std::string &aes_iv, int cur_seq_number) {
+static std::array<std::uint8_t, 16> derive_iv(std::uint32_t input_iv, int cur_seq_number) {
   auto iv = std::array<std::uint8_t, 16>{};
-  std::uint32_t input_iv = std::stoul(aes_iv);
   *(std::uint32_t *)iv.data() = boost::endian::native_to_big(input_iv + cur_seq_number);
+  return iv;
+}
+
+/**
+ * Derives the proper IV following Moonlight implementation
+ */
+static std::string derive_iv(const std::string &aes_iv, int cur_seq_number) {
+  auto iv = derive_iv((std::uint32_t)std::stoul(aes_iv), cur_seq_number);
   return {iv.begin(), iv.end()};
 }
 
@@ -1,10 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <boost/endian.hpp>
 #include <cmath>
+#include <cstring>
+#include <gst-plugin/fec_task_pool.hpp>
 #include <gst-plugin/gstrtpmoonlightpay_video.hpp>
 #include <gst-plugin/utils.hpp>
 #include <core/logger.hpp>
 #include <protocol/moonlight/data-structures.hpp>
+#include <thread>
 
 namespace gst_moonlight_video {
 
@@ -35,20 +39,12 @@ struct VideoShortHeader {
 #pragma pack(pop)
 
 /**
- * Creates an RTP header and returns a GstBuffer to it
+ * Writes the RTP header for the given packet at \p packet, the memory is expected to be zeroed
  */
-static GstBuffer *
-create_rtp_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int packet_nr, int tot_packets) {
-  constexpr auto rtp_header_size = sizeof(VideoRTPHeaders);
-  GstBuffer *buf = gst_buffer_new_and_fill(rtp_header_size, 0x00);
-
-  /* get WRITE access to the memory */
-  GstMapInfo info;
-  gst_buffer_map(buf, &info, GST_MAP_WRITE);
-
-  /* set RTP headers */
-  auto packet = (VideoRTPHeaders *)info.data;
-
+static void fill_rtp_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
+                            VideoRTPHeaders *packet,
+                            int packet_nr,
+                            int tot_packets) {
   packet->rtp.header = 0x80 | FLAG_EXTENSION;
   packet->rtp.packetType = 0x00;
   packet->rtp.timestamp = 0x00;
@@ -73,28 +69,42 @@ create_rtp_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int packet
   if (packet_nr == tot_packets - 1) {
     packet->packet.flags |= FLAG_EOF;
   }
+}
+
+/**
+ * Creates an RTP header and returns a GstBuffer to it
+ */
+static GstBuffer *
+create_rtp_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int packet_nr, int tot_packets) {
+  constexpr auto rtp_header_size = sizeof(VideoRTPHeaders);
+  GstBuffer *buf = gst_buffer_new_and_fill(rtp_header_size, 0x00);
+
+  /* get WRITE access to the memory */
+  GstMapInfo info;
+  gst_buffer_map(buf, &info, GST_MAP_WRITE);
+
+  /* set RTP headers */
+  fill_rtp_header(rtpmoonlightpay, (VideoRTPHeaders *)info.data, packet_nr, tot_packets);
 
   gst_buffer_unmap(buf, &info);
 
   return buf;
 }
 
-static GstBuffer *prepend_video_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, GstBuffer *inbuf) {
-  constexpr auto video_payload_header_size = 8;
+/**
+ * Writes the short video header that precedes the payload, the memory is expected to be zeroed
+ */
+static void fill_video_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
+                              GstBuffer *inbuf,
+                              VideoShortHeader *packet) {
+  constexpr auto video_payload_header_size = sizeof(VideoShortHeader);
   auto in_buf_size = gst_buffer_get_size(inbuf);
-  GstBuffer *video_header = gst_buffer_new_and_fill(video_payload_header_size, 0x00);
   bool is_key = !GST_BUFFER_FLAG_IS_SET(inbuf, GST_BUFFER_FLAG_DELTA_UNIT);
 
   if (is_key) {
     logs::log(logs::trace, "[GStreamer] KEYFRAME!");
   }
 
-  /* get WRITE access to the memory */
-  GstMapInfo info;
-  gst_buffer_map(video_header, &info, GST_MAP_WRITE);
-
-  /* set headers */
-  auto packet = (VideoShortHeader *)info.data;
   packet->header_type = 0x01;
   packet->frame_type = is_key ? 0x02 : 0x01;
   packet->last_payload_len = (in_buf_size + video_payload_header_size) %
@@ -102,6 +112,17 @@ static GstBuffer *prepend_video_header(const gst_rtp_moonlight_pay_video &rtpmoo
   if (packet->last_payload_len == 0) {
     packet->last_payload_len = rtpmoonlightpay.payload_size - sizeof(moonlight::NV_VIDEO_PACKET);
   }
+}
+
+static GstBuffer *prepend_video_header(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, GstBuffer *inbuf) {
+  GstBuffer *video_header = gst_buffer_new_and_fill(sizeof(VideoShortHeader), 0x00);
+
+  /* get WRITE access to the memory */
+  GstMapInfo info;
+  gst_buffer_map(video_header, &info, GST_MAP_WRITE);
+
+  /* set headers */
+  fill_video_header(rtpmoonlightpay, inbuf, (VideoShortHeader *)info.data);
 
   gst_buffer_unmap(video_header, &info);
 
@@ -109,6 +130,61 @@ static GstBuffer *prepend_video_header(const gst_rtp_moonlight_pay_video &rtpmoo
   return full_payload_buf;
 }
 
+/**
+ * The payloader packet pool as it is for the frame being payloaded, see ensure_packet_pool()
+ */
+struct frame_packet_pool {
+  GstBufferPool *pool = nullptr;
+  int packet_size = 0;
+};
+
+/**
+ * (Re)creates the payloader packet pool when `payload_size` changed, so that it holds packets of \p packet_size bytes.
+ * Only called from the streaming thread, once per frame and before any FEC worker runs: the workers only get the
+ * returned pool and never touch the payloader.
+ */
+static frame_packet_pool ensure_packet_pool(gst_rtp_moonlight_pay_video &rtpmoonlightpay, int packet_size) {
+  if (!rtpmoonlightpay.pool_packets) {
+    return {};
+  }
+
+  if (rtpmoonlightpay.packet_pool == nullptr || rtpmoonlightpay.packet_pool_size != packet_size) {
+    if (rtpmoonlightpay.packet_pool) {
+      gst_buffer_pool_set_active(rtpmoonlightpay.packet_pool, FALSE);
+      gst_object_unref(rtpmoonlightpay.packet_pool);
+    }
+
+    rtpmoonlightpay.packet_pool = gst_buffer_pool_new();
+    rtpmoonlightpay.packet_pool_size = packet_size;
+    auto config = gst_buffer_pool_get_config(rtpmoonlightpay.packet_pool);
+    gst_buffer_pool_config_set_params(config, nullptr, packet_size, PACKET_POOL_MIN_BUFFERS, 0);
+    if (!gst_buffer_pool_set_config(rtpmoonlightpay.packet_pool, config) ||
+        !gst_buffer_pool_set_active(rtpmoonlightpay.packet_pool, TRUE)) {
+      logs::log(logs::warning, "[GSTREAMER] Unable to activate the RTP packet pool, falling back to allocations");
+      gst_object_unref(rtpmoonlightpay.packet_pool);
+      rtpmoonlightpay.packet_pool = nullptr;
+      rtpmoonlightpay.pool_packets = false;
+      return {};
+    }
+  }
+
+  return {.pool = rtpmoonlightpay.packet_pool, .packet_size = packet_size};
+}
+
+/**
+ * Returns a single memory buffer of \p packet_size bytes, taken from \p pool when it holds packets of that size.
+ * Safe to call from the FEC workers, acquiring from a GstBufferPool is thread safe.
+ */
+static GstBuffer *acquire_packet(const frame_packet_pool &pool, int packet_size) {
+  GstBuffer *buf = nullptr;
+  if (pool.pool && pool.packet_size == packet_size &&
+      gst_buffer_pool_acquire_buffer(pool.pool, &buf, nullptr) == GST_FLOW_OK) {
+    return buf;
+  }
+
+  return gst_buffer_new_allocate(nullptr, packet_size, nullptr);
+}
+
 /**
  * Split the input buffer into packets, will prepend the RTP header and append any padding if needed
  */
@@ -140,8 +216,66 @@ static GstBufferList *generate_rtp_packets(const gst_rtp_moonlight_pay_video &rt
   return buffers;
 }
 
+/**
+ * Same as prepend_video_header() followed by generate_rtp_packets() but each packet is a single pooled buffer:
+ * header, payload and padding are written straight into it instead of appending separate memories.
+ */
+static GstBufferList *generate_rtp_packets_pooled(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
+                                                  const frame_packet_pool &pool,
+                                                  GstBuffer *inbuf) {
+  VideoShortHeader video_header = {};
+  fill_video_header(rtpmoonlightpay, inbuf, &video_header);
+
+  GstMapInfo in_info;
+  gst_buffer_map(inbuf, &in_info, GST_MAP_READ);
+
+  // The video short header is the first part of the payload, followed by the content of inbuf
+  int in_buf_size = sizeof(VideoShortHeader) + in_info.size;
+  int payload_size = rtpmoonlightpay.payload_size - MAX_RTP_HEADER_SIZE;
+  int packet_size = sizeof(VideoRTPHeaders) + payload_size;
+  int tot_packets = std::ceil((float)in_buf_size / payload_size);
+  GstBufferList *buffers = gst_buffer_list_new_sized(tot_packets);
+
+  for (int packet_nr = 0; packet_nr < tot_packets; packet_nr++) {
+    int begin = packet_nr * payload_size;
+    int remaining = in_buf_size - begin;
+    int packet_payload_size = MIN(remaining, payload_size);
+
+    GstBuffer *rtp_packet = acquire_packet(pool, packet_size);
+    if (packet_payload_size < payload_size && !rtpmoonlightpay.add_padding) {
+      gst_buffer_set_size(rtp_packet, sizeof(VideoRTPHeaders) + packet_payload_size);
+    }
+
+    GstMapInfo info;
+    gst_buffer_map(rtp_packet, &info, GST_MAP_WRITE);
+
+    std::memset(info.data, 0, sizeof(VideoRTPHeaders));
+    fill_rtp_header(rtpmoonlightpay, (VideoRTPHeaders *)info.data, packet_nr, tot_packets);
+
+    auto payload = info.data + sizeof(VideoRTPHeaders);
+    int copied = 0;
+    if (begin < (int)sizeof(VideoShortHeader)) {
+      copied = MIN((int)sizeof(VideoShortHeader) - begin, packet_payload_size);
+      std::memcpy(payload, (unsigned char *)&video_header + begin, copied);
+    }
+    std::memcpy(payload + copied,
+                in_info.data + (begin + copied - sizeof(VideoShortHeader)),
+                packet_payload_size - copied);
+    std::memset(payload + packet_payload_size, 0, info.size - sizeof(VideoRTPHeaders) - packet_payload_size);
+
+    gst_buffer_unmap(rtp_packet, &info);
+
+    gst_copy_timestamps(inbuf, rtp_packet);
+    gst_buffer_list_add(buffers, rtp_packet);
+  }
+
+  gst_buffer_unmap(inbuf, &in_info);
+  return buffers;
+}
+
 static void update_fec_info(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
                             VideoRTPHeaders *rtp_packet,
+                            uint32_t first_seq_number,
                             int shard_idx,
                             int data_shards,
                             int fec_percentage,
@@ -154,7 +288,7 @@ static void update_fec_info(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
   rtp_packet->packet.multiFecFlags = 0x10;
 
   rtp_packet->rtp.header = 0x80 | FLAG_EXTENSION;
-  uint32_t sequence_number = rtpmoonlightpay.cur_seq_number + shard_idx;
+  uint32_t sequence_number = first_seq_number + shard_idx;
   rtp_packet->rtp.sequenceNumber = boost::endian::native_to_big((uint16_t)sequence_number);
 }
 
@@ -165,9 +299,12 @@ struct BLOCKS {
   int fec_percentage;
 };
 
-static BLOCKS determine_split(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int data_shards) {
+/**
+ * @param fec_percentage the value read once for the whole frame, `fec_percentage` can be changed at any time by the
+ *                       congestion controller and all the blocks of a frame must agree on it
+ */
+static BLOCKS determine_split(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int data_shards, int fec_percentage) {
   auto blocksize = rtpmoonlightpay.payload_size + (int)sizeof(VideoRTPHeaders) - MAX_RTP_HEADER_SIZE;
-  auto fec_percentage = rtpmoonlightpay.fec_percentage;
   int parity_shards = (data_shards * fec_percentage + 99) / 100;
 
   // increase the FEC percentage in order to get the min required packets
@@ -182,23 +319,37 @@ static BLOCKS determine_split(const gst_rtp_moonlight_pay_video &rtpmoonlightpay
           .fec_percentage = fec_percentage};
 }
 
+/**
+ * @return the number of packets (data + FEC) that generate_fec_packets() will output for the given data shards
+ */
+static int fec_block_packets(const gst_rtp_moonlight_pay_video &rtpmoonlightpay, int data_shards, int fec_percentage) {
+  auto blocks = determine_split(rtpmoonlightpay, data_shards, fec_percentage);
+  if (blocks.data_shards + blocks.parity_shards > DATA_SHARDS_MAX) {
+    return data_shards;
+  }
+  return blocks.data_shards + blocks.parity_shards;
+}
+
 /**
  * Given the RTP packets that contains payload,
  * will generate extra RTP packets with the FEC information.
  *
  * Will modify the input rtp_packets with the correct FEC info
  * and will append the FEC packets at the end
+ *
+ * \p rtpmoonlightpay is only read, parity packets come from \p pool and \p fec_state is the only state written to:
+ * different blocks of the same frame can be encoded concurrently as long as each thread uses its own state.
  */
 static void generate_fec_packets(const gst_rtp_moonlight_pay_video &rtpmoonlightpay,
+                                 const frame_packet_pool &pool,
+                                 fec_encoder_state &fec_state,
                                  GstBufferList *rtp_packets,
                                  GstBuffer *inbuf,
+                                 uint32_t first_seq_number,
+                                 int fec_percentage,
                                  int block_index = 0,
                                  int last_block_index = 0) {
-  GstMapInfo info;
-  GstBuffer *rtp_payload = gst_buffer_list_unfold(rtp_packets);
-
-  auto payload_size = (int)gst_buffer_get_size(rtp_payload);
-  auto blocks = determine_split(rtpmoonlightpay, gst_buffer_list_length(rtp_packets));
+  auto blocks = determine_split(rtpmoonlightpay, gst_buffer_list_length(rtp_packets), fec_percentage);
   const auto nr_shards = blocks.data_shards + blocks.parity_shards;
 
   if (nr_shards > DATA_SHARDS_MAX) {
@@ -206,112 +357,158 @@ static void generate_fec_packets(const gst_rtp_moonlight_pay_video &rtpmoonlight
               "[GSTREAMER] Size of frame too large, {} packets is bigger than the max ({}); skipping FEC",
               nr_shards,
               DATA_SHARDS_MAX);
-    gst_buffer_unref(rtp_payload);
     return;
   }
 
-  // pads rtp_payload to blocksize
-  if (payload_size % blocks.block_size != 0) {
-    GstBuffer *pad = gst_buffer_new_and_fill((blocks.data_shards * blocks.block_size) - payload_size, 0x00);
-    rtp_payload = gst_buffer_append(rtp_payload, pad);
+  // Full sized packets are encoded in place, shorter ones (no padding) are copied in their own zero padded shard.
+  // The arena only grows, so after the first few frames this doesn't allocate anymore
+  auto &arena = fec_state.arena;
+  if (arena.size() < (std::size_t)(blocks.data_shards * blocks.block_size)) {
+    arena.resize(blocks.data_shards * blocks.block_size);
   }
-
-  // Allocate space for FEC packets
-  auto fec_buff = gst_buffer_new_and_fill((blocks.parity_shards * blocks.block_size), 0x00);
-  rtp_payload = gst_buffer_append(rtp_payload, fec_buff);
-  gst_buffer_map(rtp_payload, &info, GST_MAP_WRITE);
-
-  // Reed Solomon encode the full stream of bytes
-  auto rs = moonlight::fec::create(blocks.data_shards, blocks.parity_shards);
-  std::vector<unsigned char *> ptr(nr_shards);
+  unsigned char *ptr[DATA_SHARDS_MAX];
+  GstMapInfo infos[DATA_SHARDS_MAX];
+  GstBuffer *packets[DATA_SHARDS_MAX];
   for (int shard_idx = 0; shard_idx < nr_shards; shard_idx++) {
-    ptr[shard_idx] = info.data + (shard_idx * blocks.block_size);
-  }
-  if (moonlight::fec::encode(rs.get(), &ptr.front(), nr_shards, blocks.block_size) != 0) {
-    logs::log(logs::warning, "Error during video FEC encoding");
-  }
+    if (shard_idx < blocks.data_shards) {
+      packets[shard_idx] = gst_buffer_list_get(rtp_packets, shard_idx);
+    } else {
+      packets[shard_idx] = acquire_packet(pool, blocks.block_size);
+    }
+    gst_buffer_map(packets[shard_idx], &infos[shard_idx], GST_MAP_WRITE);
 
-  // update FEC info of the already created RTP packets
-  for (int shard_idx = 0; shard_idx < blocks.data_shards; shard_idx++) {
-    GstMapInfo data_info;
-    auto data_pkt = gst_buffer_list_get(rtp_packets, shard_idx);
-    gst_buffer_map(data_pkt, &data_info, GST_MAP_WRITE);
+    // parity shards are accumulated into, pooled buffers still hold the previous frame
+    if (shard_idx >= blocks.data_shards) {
+      std::memset(infos[shard_idx].data, 0, infos[shard_idx].size);
+    }
 
-    update_fec_info(rtpmoonlightpay,
-                    (VideoRTPHeaders *)(data_info.data),
-                    shard_idx,
-                    blocks.data_shards,
-                    blocks.fec_percentage,
-                    block_index,
-                    last_block_index);
-    gst_copy_timestamps(inbuf, data_pkt);
-    gst_buffer_unmap(data_pkt, &data_info);
+    if (infos[shard_idx].size == (gsize)blocks.block_size) {
+      ptr[shard_idx] = infos[shard_idx].data;
+    } else {
+      ptr[shard_idx] = arena.data() + (shard_idx * blocks.block_size);
+      auto copied = MIN(infos[shard_idx].size, (gsize)blocks.block_size);
+      std::memcpy(ptr[shard_idx], infos[shard_idx].data, copied);
+      std::memset(ptr[shard_idx] + copied, 0, blocks.block_size - copied);
+    }
   }
 
-  // Push back the newly created RTP packets with the FEC info
-  for (int shard_idx = blocks.data_shards; shard_idx < nr_shards; shard_idx++) {
-    auto position = shard_idx * blocks.block_size;
-    auto rtp_packet = (VideoRTPHeaders *)(info.data + position);
+  // Reed Solomon encode the full stream of bytes
+  auto rs = fec_state.rs_cache.get(blocks.data_shards, blocks.parity_shards);
+  if (moonlight::fec::encode(rs.get(), ptr, nr_shards, blocks.block_size) != 0) {
+    logs::log(logs::warning, "Error during video FEC encoding");
+  }
 
+  // update FEC info of the already created RTP packets and push back the newly created ones
+  for (int shard_idx = 0; shard_idx < nr_shards; shard_idx++) {
     update_fec_info(rtpmoonlightpay,
-                    rtp_packet,
+                    (VideoRTPHeaders *)(infos[shard_idx].data),
+                    first_seq_number,
                     shard_idx,
                     blocks.data_shards,
                     blocks.fec_percentage,
                     block_index,
                     last_block_index);
+    gst_buffer_unmap(packets[shard_idx], &infos[shard_idx]);
+    gst_copy_timestamps(inbuf, packets[shard_idx]);
 
-    GstBuffer *packet_buf = gst_buffer_new_allocate(nullptr, blocks.block_size, nullptr);
-    gst_buffer_fill(packet_buf, 0, rtp_packet, blocks.block_size);
-    gst_copy_timestamps(inbuf, packet_buf);
-    gst_buffer_list_add(rtp_packets, packet_buf);
+    if (shard_idx >= blocks.data_shards) {
+      gst_buffer_list_add(rtp_packets, packets[shard_idx]);
+    }
   }
+}
 
-  gst_buffer_unmap(rtp_payload, &info);
-  gst_buffer_unref(rtp_payload);
+/**
+ * Makes sure that the FEC pool matches the `fec_threads` setting.
+ * When set to 0 the cores are split evenly between all the running payloaders.
+ */
+static void ensure_fec_pool(gst_rtp_moonlight_pay_video *rtpmoonlightpay, int nr_blocks) {
+  int threads = rtpmoonlightpay->fec_threads;
+  if (threads <= 0) {
+    threads = (int)std::thread::hardware_concurrency() / std::max(1, active_video_payloaders.load());
+  }
+  // The streaming thread takes part in the encoding, we don't need more workers than the remaining blocks
+  auto workers = std::clamp(threads, 1, nr_blocks) - 1;
+
+  auto cur_workers = rtpmoonlightpay->fec_pool ? rtpmoonlightpay->fec_pool->slots() - 1 : 0;
+  if (cur_workers != workers) {
+    logs::log(logs::debug, "[GSTREAMER] Encoding video FEC blocks with {} threads", workers + 1);
+    delete rtpmoonlightpay->fec_pool;
+    rtpmoonlightpay->fec_pool = workers > 0 ? new fec_task_pool(workers) : nullptr;
+  }
+  rtpmoonlightpay->fec_states->resize(workers + 1);
 }
 
 /**
  * Given a list of RTP packets will split them in 3 macro blocks of:
  * [Payloads + FEC], [Payloads + FEC], [Payloads + FEC]
  *
+ * The blocks are independent of each other so they are encoded in parallel on the payloader FEC pool.
+ *
  * Returns a new linear list of all the blocks
  * Will modify the input rtp_packets with the correct FEC info
  */
 static GstBufferList *generate_fec_multi_blocks(gst_rtp_moonlight_pay_video *rtpmoonlightpay,
+                                                const frame_packet_pool &pool,
                                                 GstBufferList *rtp_packets,
                                                 int data_shards,
+                                                int fec_percentage,
                                                 GstBuffer *inbuf) {
   auto rtp_packets_size = gst_buffer_list_length(rtp_packets);
 
   constexpr auto nr_blocks = 3;
   constexpr auto last_block_index = 2 << 6;
 
-  GstBufferList *final_packets = gst_buffer_list_new(); // we'll increase the size on each block iteration
-
+  // The sequenceNumber of each RTP packet depends on how many packets the previous blocks generated,
+  // this is known in advance so that blocks don't have to wait on each other
+  GstBufferList *block_packets[nr_blocks];
+  uint32_t block_seq_number[nr_blocks];
+  auto seq_number = rtpmoonlightpay->cur_seq_number;
   auto packets_per_block = (int)std::ceil((float)data_shards / nr_blocks);
   for (int block_idx = 0; block_idx < nr_blocks; block_idx++) {
     auto list_start = block_idx * packets_per_block;
     auto list_end = MIN((block_idx + 1) * packets_per_block, rtp_packets_size);
-    auto block_packets = gst_buffer_list_sub(rtp_packets, list_start, list_end);
+    block_packets[block_idx] = gst_buffer_list_new_sized(fec_block_packets(*rtpmoonlightpay, list_end - list_start, fec_percentage));
+    for (int packet_idx = list_start; packet_idx < list_end; packet_idx++) {
+      gst_buffer_list_add(block_packets[block_idx], gst_buffer_ref(gst_buffer_list_get(rtp_packets, packet_idx)));
+    }
+    block_seq_number[block_idx] = seq_number;
+    seq_number += fec_block_packets(*rtpmoonlightpay, list_end - list_start, fec_percentage);
+  }
+  // Each packet is now only owned by its block: it stays writable and FEC can be computed in place
+  gst_buffer_list_unref(rtp_packets);
 
-    // bear in mind that since no actual data copy is done,
-    // this will also modify the FEC information in the original rtp_packets list
-    generate_fec_packets(*rtpmoonlightpay, block_packets, inbuf, block_idx, last_block_index);
+  ensure_fec_pool(rtpmoonlightpay, nr_blocks);
+  auto encode_block = [&](int block_idx, int slot) {
+    generate_fec_packets(*rtpmoonlightpay,
+                         pool,
+                         (*rtpmoonlightpay->fec_states)[slot],
+                         block_packets[block_idx],
+                         inbuf,
+                         block_seq_number[block_idx],
+                         fec_percentage,
+                         block_idx,
+                         last_block_index);
+  };
+  if (rtpmoonlightpay->fec_pool) {
+    rtpmoonlightpay->fec_pool->run(nr_blocks, encode_block);
+  } else {
+    for (int block_idx = 0; block_idx < nr_blocks; block_idx++) {
+      encode_block(block_idx, 0);
+    }
+  }
 
-    // We have to copy out the additional FEC packets; we just put them all back into a new linear list
-    auto total_block_packets = gst_buffer_list_length(block_packets);
+  GstBufferList *final_packets = gst_buffer_list_new_sized(seq_number - rtpmoonlightpay->cur_seq_number);
+  for (int block_idx = 0; block_idx < nr_blocks; block_idx++) {
+    // We just put them all back into a new linear list, no copy is performed
+    auto total_block_packets = gst_buffer_list_length(block_packets[block_idx]);
     for (int packet_idx = 0; packet_idx < total_block_packets; packet_idx++) {
-      // copy here is about the buffer object, not the data
-      gst_buffer_list_add(final_packets, gst_buffer_copy(gst_buffer_list_get(block_packets, packet_idx)));
+      gst_buffer_list_add(final_packets, gst_buffer_ref(gst_buffer_list_get(block_packets[block_idx], packet_idx)));
     }
-
-    // This will adjust the sequenceNumber of the RTP packet
-    rtpmoonlightpay->cur_seq_number += total_block_packets;
-    gst_buffer_list_unref(block_packets);
+    gst_buffer_list_unref(block_packets[block_idx]);
   }
 
-  gst_buffer_list_unref(rtp_packets);
+  // This will adjust the sequenceNumber of the RTP packet
+  rtpmoonlightpay->cur_seq_number = seq_number;
 
   return final_packets;
 }
@@ -324,26 +521,45 @@ static GstBufferList *generate_fec_multi_blocks(gst_rtp_moonlight_pay_video *rtp
  * @return a list of buffers, each element representing a single RTP packet
  */
 static GstBufferList *split_into_rtp(gst_rtp_moonlight_pay_video *rtpmoonlightpay, GstBuffer *inbuf) {
-  auto full_payload_buf = prepend_video_header(*rtpmoonlightpay, inbuf);
-
-  GstBufferList *rtp_packets = generate_rtp_packets(*rtpmoonlightpay, full_payload_buf);
+  // Data and parity packets have the same size, the pool is settled here once for the whole frame
+  auto pool = ensure_packet_pool(*rtpmoonlightpay,
+                                 rtpmoonlightpay->payload_size + (int)sizeof(VideoRTPHeaders) - MAX_RTP_HEADER_SIZE);
+
+  GstBufferList *rtp_packets;
+  if (rtpmoonlightpay->pool_packets) {
+    rtp_packets = generate_rtp_packets_pooled(*rtpmoonlightpay, pool, inbuf);
+  } else {
+    auto full_payload_buf = prepend_video_header(*rtpmoonlightpay, inbuf);
+    rtp_packets = generate_rtp_packets(*rtpmoonlightpay, full_payload_buf);
+    gst_buffer_unref(full_payload_buf);
+  }
 
-  if (rtpmoonlightpay->fec_percentage > 0) {
+  // Read once: the split, the sequence numbers and the fecInfo of every block must come from the same value
+  int fec_percentage = rtpmoonlightpay->fec_percentage.load();
+  if (fec_percentage > 0) {
     auto rtp_packets_size = gst_buffer_list_length(rtp_packets);
-    auto blocks = determine_split(*rtpmoonlightpay, rtp_packets_size);
+    auto blocks = determine_split(*rtpmoonlightpay, rtp_packets_size, fec_percentage);
 
     // With a fec_percentage of 255, if payload is broken up into more than a 100 data_shards
     // it will generate greater than DATA_SHARDS_MAX shards and FEC will fail to encode.
     if (blocks.data_shards > 90) {
-      rtp_packets = generate_fec_multi_blocks(rtpmoonlightpay, rtp_packets, blocks.data_shards, inbuf);
+      rtp_packets =
+          generate_fec_multi_blocks(rtpmoonlightpay, pool, rtp_packets, blocks.data_shards, fec_percentage, inbuf);
     } else {
-      generate_fec_packets(*rtpmoonlightpay, rtp_packets, inbuf, 0, 0);
+      generate_fec_packets(*rtpmoonlightpay,
+                           pool,
+                           rtpmoonlightpay->fec_states->front(),
+                           rtp_packets,
+                           inbuf,
+                           rtpmoonlightpay->cur_seq_number,
+                           fec_percentage,
+                           0,
+                           0);
       rtpmoonlightpay->cur_seq_number += gst_buffer_list_length(rtp_packets);
     }
   }
 
   rtpmoonlightpay->frame_num++;
-  gst_buffer_unref(full_payload_buf);
   return rtp_packets;
 }
 
@@ -0,0 +1,274 @@
+#include "MoonlightInputSeat.hpp"
+#include "Compositor.hpp"
+#include "debug/Log.hpp"
+#include "managers/input/InputManager.hpp"
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static const wlr_pointer_impl  pointerImpl  = {.name = "moonlight-pointer"};
+static const wlr_keyboard_impl keyboardImpl = {.name = "moonlight-keyboard", .led_update = nullptr};
+static const wlr_touch_impl    touchImpl    = {.name = "moonlight-touch"};
+
+static uint32_t nowMs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int onEventFdReadable(int fd, uint32_t mask, void* data) {
+    ((CMoonlightInputSeat*)data)->onEventFd();
+    return 0;
+}
+
+CMoonlightInputSeat::CMoonlightInputSeat() {
+    m_iEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_iEventFd < 0) {
+        Debug::log(ERR, "CMoonlightInputSeat: eventfd failed, remote input will go through uinput");
+        return;
+    }
+
+    m_pEventSource = wl_event_loop_add_fd(g_pCompositor->m_sWLEventLoop, m_iEventFd, WL_EVENT_READABLE, ::onEventFdReadable, this);
+
+    wlr_pointer_init(&m_sPointer, &pointerImpl, "moonlight-pointer");
+    wlr_keyboard_init(&m_sKeyboard, &keyboardImpl, "moonlight-keyboard");
+    wlr_touch_init(&m_sTouch, &touchImpl, "moonlight-touch");
+
+    g_pInputManager->newMouse(&m_sPointer.base);
+    g_pInputManager->newKeyboard(&m_sKeyboard.base);
+    g_pInputManager->newTouchDevice(&m_sTouch.base);
+
+    Debug::log(LOG, "CMoonlightInputSeat: remote input is injected in-process");
+}
+
+CMoonlightInputSeat::~CMoonlightInputSeat() {
+    if (m_iEventFd < 0)
+        return;
+
+    // Normally done by the owner on the main thread already, only the eventfd is left
+    shutdown();
+    close(m_iEventFd);
+}
+
+void CMoonlightInputSeat::shutdown() {
+    if (m_iEventFd < 0 || m_bShutdown.exchange(true))
+        return;
+
+    if (m_pEventSource)
+        wl_event_source_remove(m_pEventSource);
+    m_pEventSource = nullptr;
+
+    // Emits destroy, CInputManager drops the devices
+    wlr_pointer_finish(&m_sPointer);
+    wlr_keyboard_finish(&m_sKeyboard);
+    wlr_touch_finish(&m_sTouch);
+}
+
+bool CMoonlightInputSeat::good() const {
+    return m_pEventSource;
+}
+
+void CMoonlightInputSeat::setOutput(const std::string& name) {
+    if (!good())
+        return;
+
+    for (auto& p : g_pInputManager->m_vPointers) {
+        if (p->wlr() == &m_sPointer)
+            p->boundOutput = name;
+    }
+
+    for (auto& t : g_pInputManager->m_vTouches) {
+        if (t->wlr() == &m_sTouch)
+            t->boundOutput = name;
+    }
+}
+
+void CMoonlightInputSeat::push(SEvent event) {
+    if (m_bShutdown)
+        return;
+
+    event.timeMs = nowMs();
+
+    if (!m_qEvents.push(event)) {
+        m_iDroppedEvents++;
+        return;
+    }
+
+    // Only the first event since the last drain has to wake the event loop up
+    if (!m_bWakePending.exchange(true)) {
+        uint64_t one = 1;
+        if (write(m_iEventFd, &one, sizeof(one)) < 0)
+            m_bWakePending = false;
+    }
+}
+
+void CMoonlightInputSeat::onEventFd() {
+    uint64_t count = 0;
+    if (read(m_iEventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        Debug::log(ERR, "CMoonlightInputSeat: eventfd read failed: {}", strerror(errno));
+
+    // Reset before draining so that events pushed while we drain wake us up again
+    m_bWakePending = false;
+
+    bool pointerEvents = false;
+    while (auto event = m_qEvents.pop()) {
+        dispatch(*event);
+        pointerEvents = pointerEvents || event->type <= EVENT_POINTER_AXIS;
+    }
+
+    // One frame for everything that was queued, like a device would group a SYN_REPORT
+    if (pointerEvents)
+        wl_signal_emit_mutable(&m_sPointer.events.frame, &m_sPointer);
+
+    if (const auto DROPPED = m_iDroppedEvents.exchange(0); DROPPED > 0)
+        Debug::log(WARN, "CMoonlightInputSeat: input queue full, dropped {} events", DROPPED);
+}
+
+void CMoonlightInputSeat::dispatch(const SEvent& event) {
+    switch (event.type) {
+        case EVENT_POINTER_MOTION: {
+            wlr_pointer_motion_event e = {
+                .pointer    = &m_sPointer,
+                .time_msec  = event.timeMs,
+                .delta_x    = event.x,
+                .delta_y    = event.y,
+                .unaccel_dx = event.x,
+                .unaccel_dy = event.y,
+            };
+            wl_signal_emit_mutable(&m_sPointer.events.motion, &e);
+            break;
+        }
+        case EVENT_POINTER_MOTION_ABSOLUTE: {
+            wlr_pointer_motion_absolute_event e = {
+                .pointer   = &m_sPointer,
+                .time_msec = event.timeMs,
+                .x         = event.x,
+                .y         = event.y,
+            };
+            wl_signal_emit_mutable(&m_sPointer.events.motion_absolute, &e);
+            break;
+        }
+        case EVENT_POINTER_BUTTON: {
+            wlr_pointer_button_event e = {
+                .pointer   = &m_sPointer,
+                .time_msec = event.timeMs,
+                .button    = event.code,
+                .state     = event.pressed ? WL_POINTER_BUTTON_STATE_PRESSED : WL_POINTER_BUTTON_STATE_RELEASED,
+            };
+            wl_signal_emit_mutable(&m_sPointer.events.button, &e);
+            break;
+        }
+        case EVENT_POINTER_AXIS: {
+            // 120 is one wheel step, libinput reports 15 for it
+            wlr_pointer_axis_event e = {
+                .pointer            = &m_sPointer,
+                .time_msec          = event.timeMs,
+                .source             = WL_POINTER_AXIS_SOURCE_WHEEL,
+                .orientation        = (wl_pointer_axis)event.code,
+                .relative_direction = WL_POINTER_AXIS_RELATIVE_DIRECTION_IDENTICAL,
+                .delta              = event.x * 15.0 / WLR_POINTER_AXIS_DISCRETE_STEP,
+                .delta_discrete     = (int32_t)event.x,
+            };
+            wl_signal_emit_mutable(&m_sPointer.events.axis, &e);
+            break;
+        }
+        case EVENT_KEYBOARD_KEY: {
+            wlr_keyboard_key_event e = {
+                .time_msec    = event.timeMs,
+                .keycode      = event.code,
+                .update_state = true,
+                .state        = event.pressed ? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED,
+            };
+            wlr_keyboard_notify_key(&m_sKeyboard, &e);
+            break;
+        }
+        case EVENT_TOUCH_DOWN: {
+            wlr_touch_down_event e = {
+                .touch     = &m_sTouch,
+                .time_msec = event.timeMs,
+                .touch_id  = (int32_t)event.code,
+                .x         = event.x,
+                .y         = event.y,
+            };
+            m_sActiveTouches.insert(e.touch_id);
+            wl_signal_emit_mutable(&m_sTouch.events.down, &e);
+            break;
+        }
+        case EVENT_TOUCH_UP: {
+            wlr_touch_up_event e = {
+                .touch     = &m_sTouch,
+                .time_msec = event.timeMs,
+                .touch_id  = (int32_t)event.code,
+            };
+            m_sActiveTouches.erase(e.touch_id);
+            wl_signal_emit_mutable(&m_sTouch.events.up, &e);
+            break;
+        }
+        case EVENT_TOUCH_MOTION: {
+            wlr_touch_motion_event e = {
+                .touch     = &m_sTouch,
+                .time_msec = event.timeMs,
+                .touch_id  = (int32_t)event.code,
+                .x         = event.x,
+                .y         = event.y,
+            };
+            wl_signal_emit_mutable(&m_sTouch.events.motion, &e);
+            break;
+        }
+        case EVENT_TOUCH_CANCEL: {
+            // Moonlight cancels all the fingers at once, wlr one at a time
+            for (const auto ID : m_sActiveTouches) {
+                wlr_touch_cancel_event e = {
+                    .touch     = &m_sTouch,
+                    .time_msec = event.timeMs,
+                    .touch_id  = ID,
+                };
+                wl_signal_emit_mutable(&m_sTouch.events.cancel, &e);
+            }
+            m_sActiveTouches.clear();
+            break;
+        }
+        case EVENT_TOUCH_FRAME: wl_signal_emit_mutable(&m_sTouch.events.frame, nullptr); break;
+    }
+}
+
+void CMoonlightInputSeat::pointer_motion(double delta_x, double delta_y) {
+    push({.type = EVENT_POINTER_MOTION, .x = delta_x, .y = delta_y});
+}
+
+void CMoonlightInputSeat::pointer_motion_absolute(double x, double y) {
+    push({.type = EVENT_POINTER_MOTION_ABSOLUTE, .x = x, .y = y});
+}
+
+void CMoonlightInputSeat::pointer_button(unsigned int button, bool pressed) {
+    push({.type = EVENT_POINTER_BUTTON, .code = button, .pressed = pressed});
+}
+
+void CMoonlightInputSeat::pointer_axis(bool vertical, int high_res_distance) {
+    push({.type = EVENT_POINTER_AXIS,
+          .code = vertical ? WL_POINTER_AXIS_VERTICAL_SCROLL : WL_POINTER_AXIS_HORIZONTAL_SCROLL,
+          .x    = (double)high_res_distance});
+}
+
+void CMoonlightInputSeat::keyboard_key(unsigned int key, bool pressed) {
+    push({.type = EVENT_KEYBOARD_KEY, .code = key, .pressed = pressed});
+}
+
+void CMoonlightInputSeat::touch_down(unsigned int touch_id, double x, double y) {
+    push({.type = EVENT_TOUCH_DOWN, .code = touch_id, .x = x, .y = y});
+}
+
+void CMoonlightInputSeat::touch_up(unsigned int touch_id) {
+    push({.type = EVENT_TOUCH_UP, .code = touch_id});
+}
+
+void CMoonlightInputSeat::touch_motion(unsigned int touch_id, double x, double y) {
+    push({.type = EVENT_TOUCH_MOTION, .code = touch_id, .x = x, .y = y});
+}
+
+void CMoonlightInputSeat::touch_cancel() {
+    push({.type = EVENT_TOUCH_CANCEL});
+}
+
+void CMoonlightInputSeat::touch_frame() {
+    push({.type = EVENT_TOUCH_FRAME});
+}
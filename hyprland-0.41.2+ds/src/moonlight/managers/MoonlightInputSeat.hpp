@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include "../core/mpsc_queue.hpp"
+#include "../core/virtual-display.hpp"
+#include "includes.hpp"
+#include <wlr/interfaces/wlr_touch.h>
+
+/*
+    Pointer, keyboard and touch device that live inside the compositor and receive the input of the streamed sessions.
+
+    Wolf's control thread pushes into a lock free queue and wakes the event loop through an eventfd, the event loop then
+    emits the events on plain wlr devices registered with CInputManager like any other.
+    This skips uinput -> udev -> libinput and the two context switches in between.
+*/
+class CMoonlightInputSeat : public wolf::core::virtual_display::InputSink {
+  public:
+    CMoonlightInputSeat();
+    ~CMoonlightInputSeat();
+
+    bool good() const;
+
+    // Main thread. Absolute pointer and touch coordinates (0..1) cover this output, the focused one when empty
+    void setOutput(const std::string& name);
+
+    // Main thread. Removes the devices and stops listening to the eventfd, events pushed afterwards are dropped.
+    // Sessions might still hold a reference for a moment, the last one can then be released from any thread.
+    void shutdown();
+
+    // wolf::core::virtual_display::InputSink, called from the control thread
+    void pointer_motion(double delta_x, double delta_y) override;
+    void pointer_motion_absolute(double x, double y) override;
+    void pointer_button(unsigned int button, bool pressed) override;
+    void pointer_axis(bool vertical, int high_res_distance) override;
+    void keyboard_key(unsigned int key, bool pressed) override;
+    void touch_down(unsigned int touch_id, double x, double y) override;
+    void touch_up(unsigned int touch_id) override;
+    void touch_motion(unsigned int touch_id, double x, double y) override;
+    void touch_cancel() override;
+    void touch_frame() override;
+
+    void onEventFd();
+
+  private:
+    enum eEventType : uint8_t {
+        EVENT_POINTER_MOTION = 0,
+        EVENT_POINTER_MOTION_ABSOLUTE,
+        EVENT_POINTER_BUTTON,
+        EVENT_POINTER_AXIS,
+        EVENT_KEYBOARD_KEY,
+        EVENT_TOUCH_DOWN,
+        EVENT_TOUCH_UP,
+        EVENT_TOUCH_MOTION,
+        EVENT_TOUCH_CANCEL,
+        EVENT_TOUCH_FRAME,
+    };
+
+    struct SEvent {
+        eEventType type    = EVENT_POINTER_MOTION;
+        uint32_t   timeMs  = 0;
+        uint32_t   code    = 0; // button, key, touch id or axis
+        bool       pressed = false;
+        double     x = 0, y = 0;
+    };
+
+    void                        push(SEvent event);
+    void                        dispatch(const SEvent& event);
+
+    MPSCQueue<SEvent, 1024>     m_qEvents;
+    std::atomic<bool>           m_bWakePending   = false;
+    std::atomic<uint32_t>       m_iDroppedEvents = 0;
+    std::atomic<bool>           m_bShutdown      = false;
+    int                         m_iEventFd       = -1;
+    wl_event_source*            m_pEventSource   = nullptr;
+
+    wlr_pointer                 m_sPointer;
+    wlr_keyboard                m_sKeyboard;
+    wlr_touch                   m_sTouch;
+    std::set<int32_t>           m_sActiveTouches;
+};
@@ -1,6 +1,9 @@
 #include "MoonlightManager.hpp"
+#include "MoonlightInputSeat.hpp"
 #include "Compositor.hpp"
+#include "managers/input/InputManager.hpp"
 #include "managers/eventLoop/EventLoopManager.hpp"
+#include "render/Renderer.hpp"
 #include "debug/Log.hpp"
 #include "helpers/memory/Memory.hpp"
 
@@ -22,6 +25,12 @@ UP<CMoonlightManager> g_pMoonlightManager;
 // Include Voice processing implementation
 #include "../voice/WhisperManager.hpp"
 
+// Moonlight and DOM virtual key codes to linux ones
+#include "../platforms/input.hpp"
+
+#include <algorithm>
+#include <linux/input-event-codes.h>
+
 CMoonlightManager::CMoonlightManager() {
     Debug::log(LOG, "CMoonlightManager: Initializing moonlight manager");
 }
@@ -42,6 +51,9 @@ void CMoonlightManager::init() {
         // Load configuration
         loadConfig();
         
+        // Before the control server can accept clients
+        setupInputHandling();
+        
         // Create Wolf moonlight server
         Debug::log(WARN, "MoonlightManager: Creating WolfMoonlightServer instance");
         m_wolfServer = std::make_unique<wolf::core::WolfMoonlightServer>();
@@ -118,6 +130,14 @@ void CMoonlightManager::destroy() {
     // Cleanup Wolf server
     m_wolfServer.reset();
     
+    // Sessions only hold a weak reference to the sink, the devices go away here on the main thread.
+    // A control thread in the middle of a call can still end up releasing the last reference, only the eventfd is
+    // left to close by then
+    wolf::core::virtual_display::set_input_sink(nullptr);
+    if (m_inputSeat)
+        m_inputSeat->shutdown();
+    m_inputSeat.reset();
+    
     // Cleanup WebRTC manager
     m_webrtcManager.reset();
     
@@ -178,6 +198,10 @@ void CMoonlightManager::startStreaming(CMonitor* monitor) {
     m_streamingMonitor = monitor;
     m_streaming = true;
 
+    // The client sends absolute positions over what it sees
+    if (m_inputSeat)
+        m_inputSeat->setOutput(monitor ? monitor->szName : "");
+
     Debug::log(WARN, "CMoonlightManager: Set m_streaming=true, starting stream for monitor: {}",
               monitor ? monitor->szName : "NULL (synthetic only)");
 
@@ -186,6 +210,11 @@ void CMoonlightManager::startStreaming(CMonitor* monitor) {
         gst_element_set_state(GST_ELEMENT(m_pipeline), GST_STATE_PLAYING);
     }
 
+    // Capture is damage-driven: one full frame to start the stream, then only what the renderer damages
+    if (monitor)
+        g_pHyprRenderer->damageMonitor(monitor);
+    armKeepAlive();
+
     // Note: Synthetic frame generation will be started per-session by startStreamingSession()
     // This aligns with Wolf's session-based architecture instead of always-on generation
     Debug::log(WARN, "CMoonlightManager: Streaming activated - frames will be generated per active session");
@@ -201,8 +230,18 @@ void CMoonlightManager::stopStreaming() {
         gst_element_set_state(GST_ELEMENT(m_pipeline), GST_STATE_NULL);
     }
 
+    if (m_pKeepAliveTimer) {
+        m_pKeepAliveTimer->cancel();
+        g_pEventLoopManager->removeTimer(m_pKeepAliveTimer);
+        m_pKeepAliveTimer.reset();
+    }
+
     m_streaming = false;
     m_streamingMonitor = nullptr;
+    if (m_inputSeat)
+        m_inputSeat->setOutput("");
+    m_lastPresentedNs = 0;
+    m_presentRefreshNs = 0;
 }
 
 std::string CMoonlightManager::createWolfSession(const std::string& client_cert, const std::string& client_ip) {
@@ -285,7 +324,16 @@ void CMoonlightManager::stopStreamingSession(const std::string& session_id) {
     }
 }
 
-bool CMoonlightManager::onFrameReady(CMonitor* monitor, wlr_buffer* buffer) {
+void CMoonlightManager::onRenderBegin(CMonitor* monitor) {
+    if (!m_streaming || monitor != m_streamingMonitor || !m_wolfServer)
+        return;
+
+    // The kept frame is the one on screen until this render commits. Letting go of it now means the swapchain can
+    // recycle it instead of allocating around it, the new frame replaces it for keep-alive right after.
+    m_wolfServer->releaseLastFrame();
+}
+
+bool CMoonlightManager::onFrameReady(CMonitor* monitor, wlr_buffer* buffer, const CRegion& damage) {
     Debug::log(TRACE, "MoonlightManager: onFrameReady called - streaming={}, buffer={}, monitor={}",
               m_streaming, static_cast<void*>(buffer), static_cast<void*>(monitor));
 
@@ -304,10 +352,72 @@ bool CMoonlightManager::onFrameReady(CMonitor* monitor, wlr_buffer* buffer) {
 
     Debug::log(LOG, "MoonlightManager: Processing frame from monitor {} ({}x{})",
               monitor ? monitor->szName : "null", monitor ? monitor->vecSize.x : 0, monitor ? monitor->vecSize.y : 0);
-    return processFrame(buffer);
+
+    const bool took = processFrame(buffer, damage);
+    if (took)
+        m_lastFramePushed.reset();
+
+    return took;
+}
+
+void CMoonlightManager::onPresented(CMonitor* monitor, timespec* when, uint32_t refreshNs) {
+    if (!m_streaming || monitor != m_streamingMonitor || !when)
+        return;
+
+    m_lastPresentedNs  = (uint64_t)when->tv_sec * 1000000000ULL + when->tv_nsec;
+    m_presentRefreshNs = refreshNs;
+}
+
+uint64_t CMoonlightManager::currentVblankNs() const {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t NOWNS = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    // The present event for this frame only arrives after it's committed, so extrapolate the vblank the renderer
+    // started from out of the last one. Stale or missing feedback (VRR, idle outputs) falls back to "now".
+    if (!m_lastPresentedNs || !m_presentRefreshNs || NOWNS < m_lastPresentedNs || NOWNS - m_lastPresentedNs > 1000000000ULL)
+        return NOWNS;
+
+    return m_lastPresentedNs + (NOWNS - m_lastPresentedNs) / m_presentRefreshNs * m_presentRefreshNs;
 }
 
-bool CMoonlightManager::processFrame(wlr_buffer* buffer) {
+void CMoonlightManager::armKeepAlive() {
+    if (m_config.keepAliveFps <= 0)
+        return;
+
+    const auto interval = keepAliveInterval();
+
+    if (!m_pKeepAliveTimer) {
+        m_pKeepAliveTimer = makeShared<CEventLoopTimer>(
+            std::nullopt, [this](SP<CEventLoopTimer> self, void* data) { onKeepAliveTimer(); }, nullptr);
+        g_pEventLoopManager->addTimer(m_pKeepAliveTimer);
+        m_lastFramePushed.reset();
+    }
+
+    m_pKeepAliveTimer->updateTimeout(interval);
+}
+
+std::chrono::microseconds CMoonlightManager::keepAliveInterval() const {
+    // Above the output's refresh rate repeats are pointless anyway, the cap keeps the timer from spinning
+    constexpr int MAX_KEEPALIVE_FPS = 1000;
+    return std::chrono::microseconds(1000000 / std::clamp(m_config.keepAliveFps, 1, MAX_KEEPALIVE_FPS));
+}
+
+void CMoonlightManager::onKeepAliveTimer() {
+    if (!m_streaming || !m_wolfServer)
+        return;
+
+    // Only fill in when the renderer has been quiet for a whole interval
+    if (std::chrono::system_clock::now() - m_lastFramePushed.chrono() >= keepAliveInterval()) {
+        Debug::log(TRACE, "MoonlightManager: No damage for {}ms, repeating last frame", m_lastFramePushed.getMillis());
+        m_wolfServer->repeatLastFrame();
+        m_lastFramePushed.reset();
+    }
+
+    armKeepAlive();
+}
+
+bool CMoonlightManager::processFrame(wlr_buffer* buffer, const CRegion& damage) {
     // Convert wlr_buffer and push to Wolf moonlight server
 
     if (!m_wolfServer || !m_initialized) {
@@ -324,8 +434,14 @@ bool CMoonlightManager::processFrame(wlr_buffer* buffer) {
     uint64_t modifier;
 
     if (extractDMABufInfo(buffer, &dmabuf_fd, &stride, &modifier)) {
+        // Damage is in buffer coordinates already, hand it along so the encoder can spend bits where things changed
+        std::vector<wolf::core::DamageRect> damageRects;
+        for (auto& r : damage.getRects()) {
+            damageRects.push_back({r.x1, r.y1, r.x2 - r.x1, r.y2 - r.y1});
+        }
+
         // Zero-copy: Take ownership of buffer for GStreamer processing
-        m_wolfServer->onFrameReadyDMABuf(dmabuf_fd, stride, modifier, width, height, 0x34325258, buffer);
+        m_wolfServer->onFrameReadyDMABuf(buffer, damageRects, currentVblankNs());
         Debug::log(TRACE, "MoonlightManager: Took buffer ownership for DMA-BUF frame (zero-copy) - {}x{}, fd: {}, stride: {}",
                   width, height, dmabuf_fd, stride);
 
@@ -436,25 +552,27 @@ void CMoonlightManager::setupGStreamerPipeline() {
     // Setup encoding pipeline with hardware acceleration
     // Setup Wolf's custom RTP payloaders
     
-    // TODO: Create HyprlandFrameSource element
     setupFrameSource();
 }
 
 void CMoonlightManager::setupInputHandling() {
     Debug::log(LOG, "CMoonlightManager: Setting up input handling");
     
-    // Initialize Wolf's ENet control server
-    // Setup virtual input devices via uinput
-    // Connect input events to Hyprland's input system
+    // Remote input goes straight to CInputManager, sessions fall back to uinput if this fails
+    m_inputSeat = std::make_shared<CMoonlightInputSeat>();
+    if (!m_inputSeat->good()) {
+        m_inputSeat.reset();
+        return;
+    }
     
-    // TODO: Initialize Wolf's control server
+    wolf::core::virtual_display::set_input_sink(m_inputSeat);
 }
 
 void CMoonlightManager::setupFrameSource() {
     Debug::log(LOG, "CMoonlightManager: Setting up Hyprland frame source");
     
-    // TODO: Create custom GStreamer element that receives frames from Hyprland
-    // This replaces Wolf's waylanddisplaysrc
+    // hyprlandframesrc replaces Wolf's waylanddisplaysrc, it's the source of the StreamingEngine pipeline
+    // (see WolfMoonlightServer.cpp) and processFrame() hands it the rendered buffers
 }
 
 void CMoonlightManager::cleanupResources() {
@@ -536,8 +654,15 @@ void CMoonlightManager::setupWebRTCIntegration() {
     };
     
     m_webrtcManager->onMouseScroll = [this](double delta_x, double delta_y) {
-        // Handle scroll events
-        Debug::log(LOG, "CMoonlightManager: WebRTC scroll delta=({:.2f},{:.2f})", delta_x, delta_y);
+        Debug::log(TRACE, "CMoonlightManager: WebRTC scroll delta=({:.2f},{:.2f})", delta_x, delta_y);
+        if (!m_inputSeat)
+            return;
+        
+        // Browser wheel deltas are in pixels, 100 per notch on most of them
+        if (delta_y != 0)
+            m_inputSeat->pointer_axis(true, (int)(delta_y * WLR_POINTER_AXIS_DISCRETE_STEP / 100.0));
+        if (delta_x != 0)
+            m_inputSeat->pointer_axis(false, (int)(delta_x * WLR_POINTER_AXIS_DISCRETE_STEP / 100.0));
     };
     
     m_webrtcManager->onAudioReceived = [this](const void* audio_data, size_t size, int channels, int sample_rate) {
@@ -582,43 +707,33 @@ void CMoonlightManager::setupSharedPipeline() {
 }
 
 void CMoonlightManager::handleWebRTCInput(int keycode, bool pressed, uint32_t modifiers) {
-    Debug::log(LOG, "CMoonlightManager: WebRTC keyboard input - key={}, pressed={}, mods={}", 
+    Debug::log(TRACE, "CMoonlightManager: WebRTC keyboard input - key={}, pressed={}, mods={}", 
               keycode, pressed, modifiers);
     
-    // Integrate with Hyprland's input system
-    if (g_pInputManager) {
-        // Convert web keycode to Linux input event and inject
-        // This requires proper keycode mapping and input device simulation
-        // For now, just log the event
-        
-        // TODO: Implement proper input injection via virtual input device
-        // g_pInputManager->onKeyboardKey(keycode, pressed);
-    }
+    if (!m_inputSeat)
+        return;
+    
+    // DOM keyCodes are the same virtual key codes Moonlight sends
+    if (const auto KEY = wolf::platforms::input::moonlight_to_linux_key(keycode); KEY)
+        m_inputSeat->keyboard_key(*KEY, pressed);
+    else
+        Debug::log(WARN, "CMoonlightManager: WebRTC keycode {} has no linux equivalent", keycode);
 }
 
 void CMoonlightManager::handleWebRTCMouse(double x, double y, int button, bool pressed) {
-    Debug::log(LOG, "CMoonlightManager: WebRTC mouse input - pos=({:.2f},{:.2f}), button={}, pressed={}", 
+    Debug::log(TRACE, "CMoonlightManager: WebRTC mouse input - pos=({:.2f},{:.2f}), button={}, pressed={}", 
               x, y, button, pressed);
     
-    // Convert relative coordinates to absolute screen coordinates
-    if (m_streamingMonitor) {
-        // Calculate absolute coordinates for future use
-        int abs_x = (int)(x * m_streamingMonitor->vecSize.x);
-        int abs_y = (int)(y * m_streamingMonitor->vecSize.y);
-        
-        // Integrate with Hyprland's input system
-        if (g_pInputManager) {
-            if (button == -1) {
-                // Mouse move
-                // TODO: g_pInputManager->onMouseMove(abs_x, abs_y);
-                (void)abs_x; (void)abs_y; // Suppress unused variable warnings
-            } else {
-                // Mouse button
-                // TODO: g_pInputManager->onMouseButton(button, pressed);
-                (void)abs_x; (void)abs_y; // Suppress unused variable warnings
-            }
-        }
-    }
+    if (!m_inputSeat)
+        return;
+    
+    // x and y are already relative to the streamed output
+    m_inputSeat->pointer_motion_absolute(std::clamp(x, 0.0, 1.0), std::clamp(y, 0.0, 1.0));
+    
+    // MouseEvent.button: 0 left, 1 middle, 2 right, 3 back, 4 forward
+    static constexpr uint32_t BUTTONS[] = {BTN_LEFT, BTN_MIDDLE, BTN_RIGHT, BTN_SIDE, BTN_EXTRA};
+    if (button >= 0 && button < (int)std::size(BUTTONS))
+        m_inputSeat->pointer_button(BUTTONS[button], pressed);
 }
 
 void CMoonlightManager::handleWebRTCAudio(const void* audio_data, size_t size, int channels, int sample_rate) {
@@ -730,6 +845,7 @@ void CMoonlightManager::setupVoiceProcessing() {
         m_whisperManager->m_config.model_path = m_config.whisperModelPath;
         m_whisperManager->m_config.enable_keyboard_injection = true;
         m_whisperManager->m_config.enable_command_detection = m_config.voiceCommandsEnabled;
+        m_whisperManager->m_config.enable_streaming = m_config.voiceStreamingEnabled;
         m_whisperManager->m_config.language = "en";
         m_whisperManager->m_config.confidence_threshold = 0.7f;
         
@@ -805,28 +921,18 @@ void CMoonlightManager::processAudioForVoice(const void* audio_data, size_t size
     
     // Convert audio data to format expected by Whisper
     if (channels == 1 || channels == 2) {
-        // Assume audio_data is float samples
+        // Assume audio_data is float samples, stereo is mixed down to mono while it's copied to Whisper's ring
         const float* float_samples = static_cast<const float*>(audio_data);
-        size_t sample_count = size / sizeof(float);
+        size_t frame_count = size / sizeof(float) / channels;
         
-        if (channels == 2) {
-            // Convert stereo to mono by averaging channels
-            std::vector<float> mono_samples(sample_count / 2);
-            for (size_t i = 0; i < mono_samples.size(); ++i) {
-                mono_samples[i] = (float_samples[i * 2] + float_samples[i * 2 + 1]) / 2.0f;
-            }
-            routeAudioToWhisper(mono_samples.data(), mono_samples.size(), sample_rate);
-        } else {
-            // Already mono
-            routeAudioToWhisper(float_samples, sample_count, sample_rate);
-        }
+        routeAudioToWhisper(float_samples, frame_count, channels, sample_rate);
     }
 }
 
-void CMoonlightManager::routeAudioToWhisper(const float* audio_data, size_t sample_count, int sample_rate) {
+void CMoonlightManager::routeAudioToWhisper(const float* audio_data, size_t frame_count, int channels, int sample_rate) {
     if (!m_whisperManager) return;
     
-    m_whisperManager->processAudioChunk(audio_data, sample_count, sample_rate);
+    m_whisperManager->processInterleavedAudio(audio_data, frame_count, channels, sample_rate);
 }
 
 void CMoonlightManager::handleVoiceTranscription(const std::string& text, float confidence) {
@@ -7,8 +7,11 @@
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <drm_fourcc.h>
 #include "helpers/Monitor.hpp"
+#include "helpers/Timer.hpp"
 #include "helpers/memory/Memory.hpp"
 
+class CEventLoopTimer;
+
 // Forward declarations for Wolf components
 namespace wolf {
 namespace core {
@@ -24,6 +27,8 @@ class CWebRTCManager;
 class CWhisperManager;
 class CTTSManager;
 
+class CMoonlightInputSeat;
+
 class CMoonlightManager {
 public:
     CMoonlightManager();
@@ -72,12 +77,22 @@ public:
     std::vector<std::pair<std::string, std::string>> getVoiceCommands() const;
     
     // Frame callback from renderer
-    bool onFrameReady(CMonitor* monitor, wlr_buffer* buffer); // Returns true if took buffer ownership
+    bool onFrameReady(CMonitor* monitor, wlr_buffer* buffer, const CRegion& damage); // Returns true if took buffer ownership
+    // The monitor is about to acquire a swapchain buffer, the frame kept for keep-alive must not pin one
+    void onRenderBegin(CMonitor* monitor);
+
+    // Presentation feedback from the output, frames are timestamped with the vblank they were rendered for
+    void onPresented(CMonitor* monitor, timespec* when, uint32_t refreshNs);
 
     // Synthetic frame generation (fallback when no real frames)
     void startSyntheticFrameGeneration();
     void stopSyntheticFrameGeneration();
 
+    // Damage-driven capture: re-send the last frame when the desktop is idle
+    void armKeepAlive();
+    void onKeepAliveTimer();
+    std::chrono::microseconds keepAliveInterval() const;
+
     // Configuration
     void loadConfig();
     void reloadConfig();
@@ -94,9 +109,10 @@ private:
     void cleanupResources();
     
     // Frame processing
-    bool processFrame(wlr_buffer* buffer); // Returns true if took buffer ownership
+    bool processFrame(wlr_buffer* buffer, const CRegion& damage); // Returns true if took buffer ownership
     bool extractFrameData(wlr_buffer* buffer, void** frame_data, size_t* frame_size);
     bool extractDMABufInfo(wlr_buffer* buffer, int* fd, uint32_t* stride, uint64_t* modifier);
+    uint64_t currentVblankNs() const;
     void setupFrameSource();
     
     // WebRTC integration
@@ -112,7 +128,7 @@ private:
     void handleVoiceCommand(const std::string& command, const std::string& params);
     void handleVoiceKeyboardEvent(int keycode, bool pressed, uint32_t modifiers);
     void processAudioForVoice(const void* audio_data, size_t size, int channels, int sample_rate);
-    void routeAudioToWhisper(const float* audio_data, size_t sample_count, int sample_rate);
+    void routeAudioToWhisper(const float* audio_data, size_t frame_count, int channels, int sample_rate);
     
     // State
     bool m_initialized = false;
@@ -127,10 +143,21 @@ private:
     // Synthetic frame generation
     std::thread m_syntheticFrameThread;
     std::atomic<bool> m_syntheticFrameRunning{false};
+
+    // Keep-alive while no damage arrives
+    SP<CEventLoopTimer> m_pKeepAliveTimer;
+    CTimer m_lastFramePushed;
+
+    // Last presentation of the streamed monitor (CLOCK_MONOTONIC ns) and its refresh period, 0 until known
+    uint64_t m_lastPresentedNs = 0;
+    uint32_t m_presentRefreshNs = 0;
     
     // Wolf moonlight server (using pimpl pattern to avoid header dependencies)
     std::unique_ptr<wolf::core::WolfMoonlightServer> m_wolfServer;
     
+    // In-compositor devices the remote input is injected into, shared with Wolf's control thread
+    std::shared_ptr<CMoonlightInputSeat> m_inputSeat;
+    
     // WebRTC manager
     std::unique_ptr<CWebRTCManager> m_webrtcManager;
     
@@ -158,6 +185,7 @@ private:
         int controlPort = 47999;
         int videoPort = 48000;
         int audioPort = 48002;
+        int keepAliveFps = 10; // minimum rate the last frame is re-sent at while nothing is damaged
         
         // WebRTC settings
         bool webrtcEnabled = true;
@@ -175,6 +203,7 @@ private:
         std::string defaultVoice = "en+f3";
         int ttsPort = 8080;
         bool voiceCommandsEnabled = true;
+        bool voiceStreamingEnabled = false;     // type while speaking instead of after each utterance
     } m_config;
 };
 
@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <locale>
 #include <memory>
+#include <optional>
 #include <sstream>
 
 namespace wolf::platforms::input {
@@ -31,4 +32,9 @@ static std::string to_hex(const std::u32string &str) {
 using namespace wolf::core;
 
 void paste_utf(events::KeyboardTypes &keyboard, const std::basic_string<char32_t> &utf32);
+
+/**
+ * @return the linux KEY_* code for a Moonlight keyboard code, empty optional if it's not a known key
+ */
+std::optional<short> moonlight_to_linux_key(short moonlight_key);
 } // namespace wolf::platforms::input
\ No newline at end of file
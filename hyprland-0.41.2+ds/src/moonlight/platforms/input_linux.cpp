@@ -38,6 +38,22 @@ static const std::map<short, short> key_mappings = {
     {KEY_DOT, 0xBE},       {KEY_SLASH, 0xBF},      {KEY_GRAVE, 0xC0},      {KEY_LEFTBRACE, 0xDB},
     {KEY_BACKSLASH, 0xDC}, {KEY_RIGHTBRACE, 0xDD}, {KEY_APOSTROPHE, 0xDE}, {KEY_102ND, 0xE2}};
 
+std::optional<short> moonlight_to_linux_key(short moonlight_key) {
+  // The table above has a few Moonlight codes for the same key (ex: SHIFT and LEFTSHIFT), add those that got lost
+  static const std::map<short, short> reverse_mappings = [] {
+    std::map<short, short> reverse = {{0xA0, KEY_LEFTSHIFT}, {0xA2, KEY_LEFTCTRL}};
+    for (const auto &[linux_key, moonlight_code] : key_mappings) {
+      reverse.emplace(moonlight_code, linux_key);
+    }
+    return reverse;
+  }();
+
+  if (auto found = reverse_mappings.find(moonlight_key); found != reverse_mappings.end()) {
+    return found->second;
+  }
+  return std::nullopt;
+}
+
 void paste_utf(events::KeyboardTypes &keyboard, const std::basic_string<char32_t> &utf32) {
   /* To HEX string */
   auto hex_unicode = to_hex(utf32);
@@ -101,6 +101,80 @@ std::string aes_decrypt_gcm(std::string_view msg,
                             int iv_size = -1,
                             bool padding = false);
 
+/**
+ * An AES 128 bit encryption context that is initialised once with the key and then reused for every message:
+ * only the IV changes between calls and the result is written straight into the caller's memory.
+ *
+ * Not thread safe, keep one for each stream.
+ */
+class aes_encryptor {
+public:
+  enum class mode {
+    CBC,
+    GCM
+  };
+
+  /**
+   * @param cipher_mode: the AES mode of operation
+   * @param enc_key: the key used for encryption
+   * @param padding: optional, enables or disables padding
+   * @param iv_size: optional, GCM only, the size of the IVs when not the default one
+   */
+  aes_encryptor(mode cipher_mode, std::string_view enc_key, bool padding = false, int iv_size = -1);
+
+  /**
+   * @return: the maximum number of bytes that encrypt() will write for a message of msg_size bytes
+   */
+  static std::size_t max_encrypted_size(std::size_t msg_size) {
+    return msg_size + AES_BLOCK_SIZE;
+  }
+
+  /**
+   * Encrypt the given msg into destination; msg and destination can point to the same memory
+   *
+   * @param msg: the message to be encrypted
+   * @param iv: the IV to be used for this message
+   * @param destination: must be able to hold at least max_encrypted_size(msg.size()) bytes
+   * @param tag: GCM only, where the 16 bytes MAC tag will be written
+   * @return: the number of bytes written into destination
+   */
+  std::size_t
+  encrypt(std::string_view msg, std::string_view iv, unsigned char *destination, unsigned char *tag = nullptr);
+
+private:
+  std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> ctx;
+  mode cipher_mode;
+};
+
+/**
+ * The decrypting counterpart of aes_encryptor, GCM only: the key schedule is computed once and every message just
+ * sets a new IV and tag.
+ *
+ * Not thread safe, keep one for each stream.
+ */
+class aes_decryptor {
+public:
+  /**
+   * @param enc_key: the key used for encryption
+   * @param iv_size: optional, the size of the IVs when not the default one
+   */
+  explicit aes_decryptor(std::string_view enc_key, int iv_size = -1);
+
+  /**
+   * Decrypt the given msg into destination, throws if the MAC tag doesn't match
+   *
+   * @param msg: the message to be decrypted
+   * @param iv: the IV used for this message
+   * @param tag: the 16 bytes MAC tag that came with the message
+   * @param destination: must be able to hold at least msg.size() bytes
+   * @return: the number of bytes written into destination
+   */
+  std::size_t decrypt(std::string_view msg, std::string_view iv, std::string_view tag, unsigned char *destination);
+
+private:
+  std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> ctx;
+};
+
 /**
  * Will sign the given message using the private key
  * @param msg: the message to be signed
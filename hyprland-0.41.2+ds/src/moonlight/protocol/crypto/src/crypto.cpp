@@ -161,6 +161,85 @@ std::string aes_decrypt_gcm(std::string_view msg,
   return aes::decrypt_authenticated(ctx.get(), msg, tag);
 }
 
+aes_encryptor::aes_encryptor(mode cipher_mode, std::string_view enc_key, bool padding, int iv_size)
+    : ctx(EVP_CIPHER_CTX_new(), ::EVP_CIPHER_CTX_free), cipher_mode(cipher_mode) {
+  auto cipher = cipher_mode == mode::GCM ? EVP_aes_128_gcm() : EVP_aes_128_cbc();
+  if (EVP_EncryptInit_ex(ctx.get(), cipher, nullptr, nullptr, nullptr) != 1)
+    handle_openssl_error("EVP_EncryptInit_ex failed");
+
+  if (cipher_mode == mode::GCM && iv_size != -1) {
+    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, iv_size, nullptr) != 1)
+      handle_openssl_error("EVP_CTRL_GCM_SET_IVLEN failed");
+  }
+
+  // The key schedule is computed only once here, encrypt() will just replace the IV
+  if (EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, (const std::uint8_t *)enc_key.data(), nullptr) != 1)
+    handle_openssl_error("EVP_EncryptInit_ex (key) failed");
+
+  if (EVP_CIPHER_CTX_set_padding(ctx.get(), padding) != 1)
+    handle_openssl_error("EVP_CIPHER_CTX_set_padding failed");
+}
+
+std::size_t
+aes_encryptor::encrypt(std::string_view msg, std::string_view iv, unsigned char *destination, unsigned char *tag) {
+  int c_len = 0;
+  int f_len = 0;
+
+  if (EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, nullptr, (const std::uint8_t *)iv.data()) != 1)
+    handle_openssl_error("EVP_EncryptInit_ex (iv) failed");
+
+  if (EVP_EncryptUpdate(ctx.get(), destination, &c_len, (const std::uint8_t *)msg.data(), (int)msg.size()) != 1)
+    handle_openssl_error("EVP_EncryptUpdate failed");
+
+  if (EVP_EncryptFinal_ex(ctx.get(), destination + c_len, &f_len) != 1)
+    handle_openssl_error("EVP_EncryptFinal_ex failed");
+
+  if (cipher_mode == mode::GCM && tag != nullptr) {
+    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, aes::AES_GCM_TAG_SIZE, tag) != 1)
+      handle_openssl_error("EVP_CTRL_GCM_GET_TAG failed");
+  }
+
+  return c_len + f_len;
+}
+
+aes_decryptor::aes_decryptor(std::string_view enc_key, int iv_size)
+    : ctx(EVP_CIPHER_CTX_new(), ::EVP_CIPHER_CTX_free) {
+  if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_128_gcm(), nullptr, nullptr, nullptr) != 1)
+    handle_openssl_error("EVP_DecryptInit_ex failed");
+
+  if (iv_size != -1) {
+    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, iv_size, nullptr) != 1)
+      handle_openssl_error("EVP_CTRL_GCM_SET_IVLEN failed");
+  }
+
+  if (EVP_DecryptInit_ex(ctx.get(), nullptr, nullptr, (const std::uint8_t *)enc_key.data(), nullptr) != 1)
+    handle_openssl_error("EVP_DecryptInit_ex (key) failed");
+
+  if (EVP_CIPHER_CTX_set_padding(ctx.get(), false) != 1)
+    handle_openssl_error("EVP_CIPHER_CTX_set_padding failed");
+}
+
+std::size_t
+aes_decryptor::decrypt(std::string_view msg, std::string_view iv, std::string_view tag, unsigned char *destination) {
+  int p_len = 0;
+  int f_len = 0;
+
+  if (EVP_DecryptInit_ex(ctx.get(), nullptr, nullptr, nullptr, (const std::uint8_t *)iv.data()) != 1)
+    handle_openssl_error("EVP_DecryptInit_ex (iv) failed");
+
+  if (EVP_DecryptUpdate(ctx.get(), destination, &p_len, (const std::uint8_t *)msg.data(), (int)msg.size()) != 1)
+    handle_openssl_error("EVP_DecryptUpdate failed");
+
+  if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, aes::AES_GCM_TAG_SIZE, const_cast<char *>(tag.data())) !=
+      1)
+    handle_openssl_error("EVP_CTRL_GCM_SET_TAG failed");
+
+  if (EVP_DecryptFinal_ex(ctx.get(), destination + p_len, &f_len) != 1)
+    handle_openssl_error("EVP_DecryptFinal_ex failed");
+
+  return p_len + f_len;
+}
+
 std::string sign(std::string_view msg, std::string_view private_key) {
   auto p_key = signature::create_key(private_key, true);
   return signature::sign(msg, p_key.get(), EVP_sha256());
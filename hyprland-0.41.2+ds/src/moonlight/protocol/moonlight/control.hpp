@@ -309,6 +309,18 @@ struct ControlTerminatePacket {
   std::uint32_t reason = TERMINATE_REASON_GRACEFULL;
 };
 
+/**
+ * Loss report periodically sent by the client
+ */
+struct ControlLossStatsPacket {
+  ControlPacket header;
+
+  std::int32_t lost_frames; // since the previous report
+  std::int32_t interval_ms; // time covered by this report
+  std::int32_t unused;      // always 1000
+  std::int64_t last_good_frame;
+};
+
 struct ControlRumblePacket {
   ControlPacket header;
 
@@ -396,27 +408,67 @@ static std::string decrypt_packet(const ControlEncryptedPacket &packet_data, std
 }
 
 /**
- * Turns a payload into a properly formatted control encrypted packet
+ * Creates the AES GCM context used to decrypt the control packets of a session
  */
-static std::unique_ptr<ControlEncryptedPacket>
-encrypt_packet(std::string_view gcm_key, std::uint32_t seq, std::string_view payload) {
+static crypto::aes_decryptor make_control_decryptor(std::string_view gcm_key) {
+  return crypto::aes_decryptor(crypto::hex_to_str(gcm_key.data(), true), GCM_TAG_SIZE);
+}
+
+/**
+ * Same as decrypt_packet() above but with a context that has been created once for the session,
+ * the payload is written into \p decrypted which is only re-allocated when it has to grow
+ */
+static void decrypt_packet(crypto::aes_decryptor &decryptor,
+                           const ControlEncryptedPacket &packet_data,
+                           std::string &decrypted) {
   std::array<std::uint8_t, GCM_TAG_SIZE> iv_data = {0};
-  iv_data[0] = boost::endian::native_to_little(seq);
+  iv_data[0] = boost::endian::little_to_native(packet_data.seq);
 
-  auto [encrypted_str, gcm_tag] = crypto::aes_encrypt_gcm(payload,
-                                                          crypto::hex_to_str(gcm_key.data(), true),
-                                                          {(char *)iv_data.data(), iv_data.size()},
-                                                          GCM_TAG_SIZE);
+  auto msg = packet_data.encrypted_msg();
+  decrypted.resize(msg.size());
+  auto size = decryptor.decrypt(msg,
+                                {(char *)iv_data.data(), iv_data.size()},
+                                {packet_data.gcm_tag, GCM_TAG_SIZE},
+                                (unsigned char *)decrypted.data());
+  decrypted.resize(size);
+}
+
+/**
+ * Creates the AES GCM context used to encrypt the control packets of a session
+ */
+static crypto::aes_encryptor make_control_encryptor(std::string_view gcm_key) {
+  return crypto::aes_encryptor(crypto::aes_encryptor::mode::GCM,
+                               crypto::hex_to_str(gcm_key.data(), true),
+                               false,
+                               GCM_TAG_SIZE);
+}
+
+/**
+ * Turns a payload into a properly formatted control encrypted packet, written directly into \p encrypted_pkt
+ *
+ * @return false if the payload doesn't fit in a single packet
+ */
+static bool encrypt_packet(crypto::aes_encryptor &encryptor,
+                           std::uint32_t seq,
+                           std::string_view payload,
+                           ControlEncryptedPacket &encrypted_pkt) {
+  if (payload.size() > MAX_PAYLOAD_SIZE) {
+    return false;
+  }
+
+  std::array<std::uint8_t, GCM_TAG_SIZE> iv_data = {0};
+  iv_data[0] = boost::endian::native_to_little(seq);
 
-  std::uint16_t size = sizeof(seq) + GCM_TAG_SIZE + encrypted_str.length();
-  ControlEncryptedPacket encrypted_pkt = {
-      .header = {.type = pkts::ENCRYPTED, .length = boost::endian::native_to_little(size)},
-      .seq = boost::endian::native_to_little(seq)};
+  auto encrypted_size = encryptor.encrypt(payload,
+                                          {(char *)iv_data.data(), iv_data.size()},
+                                          (unsigned char *)encrypted_pkt.payload,
+                                          (unsigned char *)encrypted_pkt.gcm_tag);
 
-  std::copy(gcm_tag.begin(), gcm_tag.end(), encrypted_pkt.gcm_tag);
-  std::copy(encrypted_str.begin(), encrypted_str.end(), encrypted_pkt.payload);
+  std::uint16_t size = sizeof(seq) + GCM_TAG_SIZE + encrypted_size;
+  encrypted_pkt.header = {.type = pkts::ENCRYPTED, .length = boost::endian::native_to_little(size)};
+  encrypted_pkt.seq = boost::endian::native_to_little(seq);
 
-  return std::make_unique<ControlEncryptedPacket>(encrypted_pkt);
+  return true;
 }
 
 static constexpr const char *packet_type_to_str(pkts::PACKET_TYPE p) noexcept {
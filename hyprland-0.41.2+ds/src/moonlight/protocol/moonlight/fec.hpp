@@ -1,6 +1,8 @@
 #pragma once
 
+#include <list>
 #include <memory>
+#include <utility>
 
 extern "C" {
 #include "rswrapper.h"
@@ -47,6 +49,41 @@ inline rs_ptr create(int data_shards, int parity_shards) {
   return std::shared_ptr<reed_solomon>(rs, reed_solomon_release_fn);
 }
 
+/**
+ * Building the nanors matrices is far more expensive than encoding a single block, but a stream keeps hitting
+ * the same handful of (data_shards, parity_shards) pairs: this keeps the most recently used ones around.
+ *
+ * @warning Not thread safe, and a reed_solomon instance must not be used by two encoders at the same time:
+ *          keep one cache per encoding thread.
+ */
+class rs_cache {
+public:
+  explicit rs_cache(std::size_t capacity = 16) : capacity(capacity) {}
+
+  /**
+   * @return the cached instance for the given shards or a newly created one, evicting the least recently used
+   */
+  rs_ptr get(int data_shards, int parity_shards) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->first.first == data_shards && it->first.second == parity_shards) {
+        entries.splice(entries.begin(), entries, it);
+        return it->second;
+      }
+    }
+
+    auto rs = create(data_shards, parity_shards);
+    entries.emplace_front(std::make_pair(data_shards, parity_shards), rs);
+    if (entries.size() > capacity) {
+      entries.pop_back();
+    }
+    return rs;
+  }
+
+private:
+  std::size_t capacity;
+  std::list<std::pair<std::pair<int, int>, rs_ptr>> entries;
+};
+
 /**
  * Encodes the input data shards using Reed Solomon.
  * It will read \p nr_shards * \p block_size and then append all the newly created parity shards
@@ -95,6 +95,15 @@
 #pragma GCC pop_options
 #endif
 
+#elif defined(__aarch64__)
+
+// Compile a variant for NEON, always available on AArch64 so no target attributes are needed
+#define ISA_SUFFIX _neon
+#define OBLAS_NEON
+#include "./rs.c"
+#undef OBLAS_NEON
+#undef ISA_SUFFIX
+
 #endif
 
 // Compile a default variant
@@ -142,6 +151,14 @@ void reed_solomon_init(void) {
     reed_solomon_decode_fn = reed_solomon_decode_ssse3;
     reed_solomon_init_ssse3();
   } else
+#elif defined(__aarch64__)
+  if (1) {
+    reed_solomon_new_fn = reed_solomon_new_neon;
+    reed_solomon_release_fn = reed_solomon_release_neon;
+    reed_solomon_encode_fn = reed_solomon_encode_neon;
+    reed_solomon_decode_fn = reed_solomon_decode_neon;
+    reed_solomon_init_neon();
+  } else
 #endif
   {
     reed_solomon_new_fn = reed_solomon_new_def;
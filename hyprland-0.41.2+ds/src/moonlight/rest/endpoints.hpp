@@ -656,7 +656,7 @@ void launch(const std::shared_ptr<typename SimpleWeb::Server<SimpleWeb::HTTPS>::
                 .height = new_session->display_mode.height,
                 .refreshRate = new_session->display_mode.refreshRate
             },
-            .gst_pipeline = "x264enc", // Software H264 encoding (nvh264enc causes hanging)
+            .gst_pipeline = streaming::HYPRLAND_VIDEO_PIPELINE,
             .session_id = new_session->session_id,
             .port = static_cast<std::uint16_t>(state::get_port(state::VIDEO_PING_PORT)),
             .timeout_ms = 2000,
@@ -798,6 +798,8 @@ void resume(const std::shared_ptr<typename SimpleWeb::Server<SimpleWeb::HTTPS>::
         state->event_bus->fire_event(immer::box<events::StreamSession>(*new_session));
         logs::log(logs::warning, "[RESUME DEBUG] StreamSession event fired successfully for native frame capture");
 
+        auto paused_session_id = old_session->session_id;
+
         // Create Video Session and start video streaming using Wolf's functions
         events::VideoSession video_session = {
             .display_mode = {
@@ -805,35 +807,45 @@ void resume(const std::shared_ptr<typename SimpleWeb::Server<SimpleWeb::HTTPS>::
                 .height = new_session->display_mode.height,
                 .refreshRate = new_session->display_mode.refreshRate
             },
-            .gst_pipeline = "x264enc", // Software H264 encoding (nvh264enc causes hanging)
+            .gst_pipeline = streaming::HYPRLAND_VIDEO_PIPELINE,
             .session_id = new_session->session_id,
             .port = static_cast<std::uint16_t>(state::get_port(state::VIDEO_PING_PORT))
         };
 
         logs::log(logs::warning, "[RESUME DEBUG] Starting Wolf video streaming directly");
 
-        // Start video streaming thread using Wolf's functions
-        std::thread([video_session, client_ip, state]() {
-            try {
-                // Create video socket for RTP streaming
-                auto io_context = std::make_shared<boost::asio::io_context>();
-                auto video_socket = std::make_shared<boost::asio::ip::udp::socket>(*io_context,
-                    boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), state::get_port(state::VIDEO_PING_PORT)));
-
-                // Start Wolf's video streaming pipeline directly
-                streaming::start_streaming_video(
-                    immer::box<events::VideoSession>(video_session),
-                    state->event_bus,
-                    client_ip,
-                    state::get_port(state::VIDEO_PING_PORT),
-                    video_socket
-                );
-
-                logs::log(logs::warning, "[RESUME DEBUG] Wolf video streaming started successfully");
-            } catch (const std::exception& e) {
-                logs::log(logs::error, "[RESUME DEBUG] Wolf video streaming failed: {}", e.what());
-            }
-        }).detach();
+        // The streams paused when the client went away still have their encoder up, as long as the client comes back
+        // with the same mode, codec, pipeline and bitrate they only need to be pointed at the new session
+        auto rebind = streaming::StreamRebind{
+            .session_id = new_session->session_id,
+            .client_ip = client_ip,
+            .client_port = static_cast<unsigned short>(state::get_port(state::VIDEO_PING_PORT))};
+        if (streaming::resume_paused_video(paused_session_id, immer::box<events::VideoSession>(video_session), rebind)) {
+            logs::log(logs::debug, "Paused video stream handed over, encoder kept warm");
+        } else {
+            // Start video streaming thread using Wolf's functions
+            std::thread([video_session, client_ip, state]() {
+                try {
+                    // Create video socket for RTP streaming
+                    auto io_context = std::make_shared<boost::asio::io_context>();
+                    auto video_socket = std::make_shared<boost::asio::ip::udp::socket>(*io_context,
+                        boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), state::get_port(state::VIDEO_PING_PORT)));
+
+                    // Start Wolf's video streaming pipeline directly
+                    streaming::start_streaming_video(
+                        immer::box<events::VideoSession>(video_session),
+                        state->event_bus,
+                        client_ip,
+                        state::get_port(state::VIDEO_PING_PORT),
+                        video_socket
+                    );
+
+                    logs::log(logs::warning, "[RESUME DEBUG] Wolf video streaming started successfully");
+                } catch (const std::exception& e) {
+                    logs::log(logs::error, "[RESUME DEBUG] Wolf video streaming failed: {}", e.what());
+                }
+            }).detach();
+        }
 
         // Create Audio Session and start audio streaming
         events::AudioSession audio_session = {
@@ -847,30 +859,40 @@ void resume(const std::shared_ptr<typename SimpleWeb::Server<SimpleWeb::HTTPS>::
 
         logs::log(logs::warning, "[RESUME DEBUG] Starting Wolf audio streaming directly");
 
-        // Start audio streaming thread using Wolf's functions
-        std::thread([audio_session, client_ip, state]() {
-            try {
-                // Create audio socket for RTP streaming
-                auto io_context = std::make_shared<boost::asio::io_context>();
-                auto audio_socket = std::make_shared<boost::asio::ip::udp::socket>(*io_context,
-                    boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), state::get_port(state::AUDIO_PING_PORT)));
-
-                // Start Wolf's audio streaming pipeline directly
-                streaming::start_streaming_audio(
-                    immer::box<events::AudioSession>(audio_session),
-                    state->event_bus,
-                    client_ip,
-                    state::get_port(state::AUDIO_PING_PORT),
-                    audio_socket,
-                    "default", // sink name
-                    "unix:path=/tmp/pulse-socket" // server name
-                );
-
-                logs::log(logs::warning, "[RESUME DEBUG] Wolf audio streaming started successfully");
-            } catch (const std::exception& e) {
-                logs::log(logs::error, "[RESUME DEBUG] Wolf audio streaming failed: {}", e.what());
-            }
-        }).detach();
+        auto audio_rebind = streaming::StreamRebind{
+            .session_id = new_session->session_id,
+            .client_ip = client_ip,
+            .client_port = static_cast<unsigned short>(state::get_port(state::AUDIO_PING_PORT)),
+            .aes_key = new_session->aes_key,
+            .aes_iv = new_session->aes_iv};
+        if (streaming::resume_paused_audio(paused_session_id, audio_rebind)) {
+            logs::log(logs::debug, "Paused audio stream handed over");
+        } else {
+            // Start audio streaming thread using Wolf's functions
+            std::thread([audio_session, client_ip, state]() {
+                try {
+                    // Create audio socket for RTP streaming
+                    auto io_context = std::make_shared<boost::asio::io_context>();
+                    auto audio_socket = std::make_shared<boost::asio::ip::udp::socket>(*io_context,
+                        boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), state::get_port(state::AUDIO_PING_PORT)));
+
+                    // Start Wolf's audio streaming pipeline directly
+                    streaming::start_streaming_audio(
+                        immer::box<events::AudioSession>(audio_session),
+                        state->event_bus,
+                        client_ip,
+                        state::get_port(state::AUDIO_PING_PORT),
+                        audio_socket,
+                        "default", // sink name
+                        "unix:path=/tmp/pulse-socket" // server name
+                    );
+
+                    logs::log(logs::warning, "[RESUME DEBUG] Wolf audio streaming started successfully");
+                } catch (const std::exception& e) {
+                    logs::log(logs::error, "[RESUME DEBUG] Wolf audio streaming failed: {}", e.what());
+                }
+            }).detach();
+        }
 
         logs::log(logs::warning, "[RESUME DEBUG] Wolf streaming initiated for resumed session {}", new_session->session_id);
 
@@ -142,9 +142,17 @@ Config load_or_default(const std::string &source,
   if (default_gst_video_settings.default_source.find("appsrc") != std::string::npos) {
     logs::log(logs::debug, "Found appsrc in default_source, migrating to interpipesrc");
     default_gst_video_settings.default_source =
-        "interpipesrc listen-to={session_id}_video is-live=true "
+        "interpipesrc listen-to=hyprland_video is-live=true "
         "stream-sync=restart-ts max-bytes=0 max-buffers=1 leaky-type=downstream";
   }
+  if (auto pos = default_gst_video_settings.default_source.find("listen-to={session_id}_video");
+      pos != std::string::npos) {
+    // Nothing publishes per-session producers here, the compositor publishes the desktop once for everyone
+    logs::log(logs::debug, "Found {{session_id}}_video in default_source, migrating to hyprland_video");
+    default_gst_video_settings.default_source.replace(pos,
+                                                      std::string_view("listen-to={session_id}_video").size(),
+                                                      "listen-to=hyprland_video");
+  }
   if (default_gst_video_settings.default_sink.find("udpsink") != std::string::npos) {
     logs::log(logs::debug, "Found udpsink in default_sink, migrating to appsink");
     default_gst_video_settings.default_sink = "rtpmoonlightpay_video name=moonlight_pay "
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <core/logger.hpp>
+#include <core/utils.hpp>
+#include <cstdlib>
+#include <optional>
+#include <random>
+
+namespace streaming {
+
+/**
+ * Drops outgoing packets the way a bad link would, so that the whole feedback loop (client loss reports ->
+ * congestion controller -> encoder and FEC) can be exercised in-process against a real Moonlight client.
+ *
+ *  - random loss: every packet is dropped with the given probability
+ *  - capacity: a token bucket refilled at capacity_kbps, packets that don't fit are tail-dropped like a full queue
+ */
+class LossSimulator {
+public:
+  using clock = std::chrono::steady_clock;
+
+  LossSimulator(double loss_ratio, long capacity_kbps)
+      : random_loss(std::clamp(loss_ratio, 0.0, 1.0)), capacity_kbps(capacity_kbps),
+        bucket_bytes(capacity_kbps * 1000 / 8 * BURST_MS / 1000), tokens(bucket_bytes) {}
+
+  /**
+   * Reads WOLF_SIMULATE_VIDEO_LOSS="<loss percentage>[:<capacity kbps>]", ex: "2" or "0.5:8000"
+   * @return std::nullopt when it's not set, which is the default
+   */
+  static std::optional<LossSimulator> from_env() {
+    auto value = utils::get_env("WOLF_SIMULATE_VIDEO_LOSS", "");
+    if (value[0] == '\0') {
+      return std::nullopt;
+    }
+    char *end = nullptr;
+    auto loss_percentage = std::strtod(value, &end);
+    long capacity_kbps = *end == ':' ? std::strtol(end + 1, nullptr, 10) : 0;
+    logs::log(logs::warning,
+              "Simulating a lossy network on video: {}% random loss, capacity {} kbps",
+              loss_percentage,
+              capacity_kbps > 0 ? std::to_string(capacity_kbps) : "unlimited");
+    return LossSimulator(loss_percentage / 100, capacity_kbps);
+  }
+
+  /**
+   * @return true if the packet of packet_bytes has to be dropped instead of sent
+   */
+  bool drop(std::size_t packet_bytes, clock::time_point now = clock::now()) {
+    if (capacity_kbps > 0) {
+      auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(now - last_refill).count();
+      tokens = std::min<double>(bucket_bytes, tokens + elapsed_us * capacity_kbps / 8000.0);
+      last_refill = now;
+      if (tokens < packet_bytes) {
+        return true;
+      }
+      tokens -= packet_bytes;
+    }
+    return random_loss(rng);
+  }
+
+private:
+  /* How much the simulated link can queue before it starts dropping */
+  static constexpr long BURST_MS = 50;
+
+  std::mt19937 rng{std::random_device{}()};
+  std::bernoulli_distribution random_loss;
+
+  long capacity_kbps;
+  double bucket_bytes;
+  double tokens;
+  clock::time_point last_refill = clock::now();
+};
+
+} // namespace streaming
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <core/utils.hpp>
+#include <fmt/format.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <streaming/pipeline_pool.hpp>
+#include <streaming/streaming.hpp>
+#include <thread>
+#include <vector>
+
+namespace streaming {
+
+static int pipeline_pool_size() {
+  return std::max(0, std::atoi(utils::get_env("WOLF_PIPELINE_POOL_SIZE", "1")));
+}
+
+static int pipeline_pool_max() {
+  return std::max(0, std::atoi(utils::get_env("WOLF_PIPELINE_POOL_MAX", "4")));
+}
+
+static std::chrono::seconds pipeline_pool_idle_timeout() {
+  return std::chrono::seconds(std::max(1, std::atoi(utils::get_env("WOLF_PIPELINE_POOL_IDLE_TIMEOUT", "600"))));
+}
+
+std::string format_pool_key(const std::string &key, const PoolSessionArgs &args) {
+  return fmt::format(fmt::runtime(key),
+                     fmt::arg("session_id", args.session_id),
+                     fmt::arg("client_ip", args.client_ip),
+                     fmt::arg("client_port", args.client_port),
+                     fmt::arg("host_port", args.host_port),
+                     fmt::arg("bitrate", args.bitrate_kbps),
+                     fmt::arg("payload_size", args.payload_size),
+                     fmt::arg("fec_percentage", args.fec_percentage),
+                     fmt::arg("min_required_fec_packets", args.min_required_fec_packets),
+                     fmt::arg("aes_key", args.aes_key),
+                     fmt::arg("aes_iv", args.aes_iv));
+}
+
+struct SparePipeline {
+  gstreamer::gst_element_ptr pipeline;
+  std::string placeholder_id; // what {session_id} was replaced with
+  std::chrono::steady_clock::time_point ready_at;
+};
+
+struct PoolEntry {
+  std::vector<SparePipeline> spares;
+  int building = 0;
+  /* Sessions that asked for this key, a spare is only worth its encoder once the key has been used again */
+  int claims = 0;
+  /* Asked for explicitly (WOLF_PIPELINE_POOL_MODES), always refilled and never evicted */
+  bool pinned = false;
+};
+
+static std::mutex pool_mutex;
+static std::condition_variable pool_cv;
+static std::map<std::string, PoolEntry> pool;
+static std::size_t next_spare_id = 0;
+static bool evicting = false;
+
+/**
+ * @return the spares ready or being built across all the keys, what WOLF_PIPELINE_POOL_MAX caps
+ */
+static int pooled_pipelines() {
+  int total = 0;
+  for (const auto &[key, entry] : pool) {
+    total += (int)entry.spares.size() + entry.building;
+  }
+  return total;
+}
+
+/**
+ * Tears down the spares nobody claimed within WOLF_PIPELINE_POOL_IDLE_TIMEOUT, so that they don't keep an encoder
+ * open forever. Runs as long as there are spares that can be evicted.
+ */
+static void evict_idle_spares() {
+  std::unique_lock<std::mutex> lock(pool_mutex);
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    auto next_deadline = std::chrono::steady_clock::time_point::max();
+    std::vector<SparePipeline> expired;
+    for (auto &[key, entry] : pool) {
+      if (entry.pinned) {
+        continue;
+      }
+      for (auto spare = entry.spares.begin(); spare != entry.spares.end();) {
+        auto deadline = spare->ready_at + pipeline_pool_idle_timeout();
+        if (deadline <= now) {
+          expired.push_back(std::move(*spare));
+          spare = entry.spares.erase(spare);
+        } else {
+          next_deadline = std::min(next_deadline, deadline);
+          spare++;
+        }
+      }
+    }
+
+    if (!expired.empty()) {
+      lock.unlock();
+      for (auto &spare : expired) {
+        logs::log(logs::debug, "[GSTREAMER] Pooled pipeline {} unused, tearing it down", spare.placeholder_id);
+        gst_element_set_state(spare.pipeline.get(), GST_STATE_NULL);
+      }
+      expired.clear();
+      lock.lock();
+      continue;
+    }
+
+    if (next_deadline == std::chrono::steady_clock::time_point::max()) {
+      evicting = false;
+      return;
+    }
+    pool_cv.wait_until(lock, next_deadline);
+  }
+}
+
+/**
+ * Replaces placeholder with session_id in every string property of every element that contains it,
+ * ex: `interpipesrc listen-to={session_id}_video`
+ */
+static void patch_session_id(GstElement *pipeline, const std::string &placeholder, const std::string &session_id) {
+  auto it = gst_bin_iterate_recurse(GST_BIN(pipeline));
+  GValue item = G_VALUE_INIT;
+  while (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+    auto element = G_OBJECT(g_value_get_object(&item));
+    guint n_props = 0;
+    auto props = g_object_class_list_properties(G_OBJECT_GET_CLASS(element), &n_props);
+    for (guint i = 0; i < n_props; i++) {
+      auto spec = props[i];
+      if (spec->value_type != G_TYPE_STRING || (spec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+          (spec->flags & G_PARAM_CONSTRUCT_ONLY)) {
+        continue;
+      }
+      gchar *value = nullptr;
+      g_object_get(element, spec->name, &value, NULL);
+      if (value) {
+        std::string patched = value;
+        g_free(value);
+        bool changed = false;
+        for (auto pos = patched.find(placeholder); pos != std::string::npos; pos = patched.find(placeholder, pos)) {
+          patched.replace(pos, placeholder.size(), session_id);
+          pos += session_id.size();
+          changed = true;
+        }
+        if (changed) {
+          g_object_set(element, spec->name, patched.c_str(), NULL);
+        }
+      }
+    }
+    g_free(props);
+    g_value_reset(&item);
+  }
+  g_value_unset(&item);
+  gst_iterator_free(it);
+}
+
+static void build_spare(const std::string &key) {
+  std::string placeholder_id;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    placeholder_id = fmt::format("wolf_pool_{}", next_spare_id++);
+  }
+
+  auto pipeline = parse_pipeline(format_pool_key(key, PoolSessionArgs{.session_id = placeholder_id}));
+  // Elements are started (encoders opened) on the way to PAUSED, live sources won't produce anything until PLAYING
+  if (pipeline && gst_element_set_state(pipeline.get(), GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+    logs::log(logs::warning, "[GSTREAMER] Unable to pre-roll pooled pipeline: \n{}", key);
+    gst_element_set_state(pipeline.get(), GST_STATE_NULL);
+    pipeline.reset();
+  }
+
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  auto &entry = pool[key];
+  entry.building--;
+  if (pipeline) {
+    logs::log(logs::debug, "[GSTREAMER] Pooled pipeline {} ready", placeholder_id);
+    entry.spares.push_back(SparePipeline{.pipeline = pipeline,
+                                         .placeholder_id = placeholder_id,
+                                         .ready_at = std::chrono::steady_clock::now()});
+    if (!entry.pinned && !evicting) {
+      evicting = true;
+      std::thread(evict_idle_spares).detach();
+    }
+  }
+}
+
+/**
+ * Starts building the spares missing for key, as long as the whole pool stays under WOLF_PIPELINE_POOL_MAX.
+ * Expects pool_mutex to be held.
+ */
+static void refill_locked(const std::string &key) {
+  auto &entry = pool[key];
+  auto missing = std::min(pipeline_pool_size() - (int)entry.spares.size() - entry.building,
+                          pipeline_pool_max() - pooled_pipelines());
+  for (; missing > 0; missing--) {
+    entry.building++;
+    std::thread([key]() { build_spare(key); }).detach();
+  }
+}
+
+void fill_pipeline_pool(const std::string &key) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  pool[key].pinned = true;
+  refill_locked(key);
+}
+
+gstreamer::gst_element_ptr claim_pooled_pipeline(const std::string &key, std::size_t session_id) {
+  if (pipeline_pool_size() <= 0) {
+    return nullptr;
+  }
+
+  std::optional<SparePipeline> spare;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    auto &entry = pool[key];
+    entry.claims++;
+    if (!entry.spares.empty()) {
+      spare = std::move(entry.spares.back());
+      entry.spares.pop_back();
+    }
+    // A mode that only showed up once isn't worth keeping an encoder open for
+    if (entry.pinned || entry.claims > 1) {
+      refill_locked(key);
+    }
+  }
+
+  if (!spare) {
+    return nullptr;
+  }
+  logs::log(logs::debug, "[GSTREAMER] Session {} claimed pooled pipeline {}", session_id, spare->placeholder_id);
+  patch_session_id(spare->pipeline.get(), spare->placeholder_id, std::to_string(session_id));
+  return spare->pipeline;
+}
+
+} // namespace streaming
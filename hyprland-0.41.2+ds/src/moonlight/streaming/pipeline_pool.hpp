@@ -0,0 +1,61 @@
+#pragma once
+
+#include <core/gstreamer.hpp>
+#include <string>
+
+namespace streaming {
+
+using namespace wolf::core;
+
+/**
+ * Pipelines built ahead of time, so that a new session doesn't have to wait for gst_parse_launch(), the elements
+ * being instantiated and the encoder being opened before the first frame goes out.
+ *
+ * Pipelines are keyed by their description with whatever changes from one session to the next left as
+ * placeholders: {session_id}, {client_ip}, {client_port}, {host_port}, {bitrate}, {payload_size},
+ * {fec_percentage}, {min_required_fec_packets}, {aes_key} and {aes_iv}.
+ * A spare pipeline is built with throwaway values for those and brought to PAUSED; the session claiming it gets the
+ * session id patched in and sets the rest (bitrate, payloader properties, keys) itself.
+ * When sessions share an encoder (see shared_encoder.hpp) only the encoder half of their pipeline is pooled.
+ *
+ * WOLF_PIPELINE_POOL_SIZE (default 1) is the number of spares kept for each key, 0 disables the pool.
+ * A key is only refilled once it has been claimed a second time, unless it was filled explicitly (fill_pipeline_pool()).
+ * WOLF_PIPELINE_POOL_MAX (default 4) caps the spares across all the keys, and the ones nobody claimed within
+ * WOLF_PIPELINE_POOL_IDLE_TIMEOUT seconds (default 600) are torn down.
+ */
+
+/**
+ * The per-session values that fill the placeholders of a pool key
+ */
+struct PoolSessionArgs {
+  std::string session_id;
+  std::string client_ip = "0.0.0.0";
+  unsigned short client_port = 0;
+  unsigned short host_port = 0;
+  long bitrate_kbps = 20000;
+  int payload_size = 1024;
+  int fec_percentage = 20;
+  int min_required_fec_packets = 0;
+  std::string aes_key = "00000000000000000000000000000000";
+  std::string aes_iv = "0";
+};
+
+/**
+ * @return the pipeline description for a session, the same as formatting the original template with all the values
+ */
+std::string format_pool_key(const std::string &key, const PoolSessionArgs &args);
+
+/**
+ * Hands a spare pipeline built for key over to session_id and, if the key has been used before, starts building its
+ * replacement in the background
+ * @return nullptr when there's no spare ready
+ */
+gstreamer::gst_element_ptr claim_pooled_pipeline(const std::string &key, std::size_t session_id);
+
+/**
+ * Builds spare pipelines for key in the background, up to WOLF_PIPELINE_POOL_SIZE.
+ * The key is kept filled from now on and its spares are never evicted.
+ */
+void fill_pipeline_pool(const std::string &key);
+
+} // namespace streaming
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <core/utils.hpp>
+#include <map>
+#include <streaming/shared_encoder.hpp>
+#include <streaming/streaming.hpp>
+
+namespace streaming {
+
+static std::string trim(const std::string &str) {
+  auto begin = str.find_first_not_of(" \t\n\\");
+  auto end = str.find_last_not_of(" \t\n\\");
+  return begin == std::string::npos ? "" : str.substr(begin, end - begin + 1);
+}
+
+std::optional<SplitVideoPipeline> split_video_pipeline(const std::string &pipeline) {
+  auto payloader_pos = pipeline.find("rtpmoonlightpay_video");
+  if (payloader_pos == std::string::npos) {
+    return std::nullopt;
+  }
+
+  auto link_pos = pipeline.rfind('!', payloader_pos);
+  if (link_pos == std::string::npos) {
+    return std::nullopt;
+  }
+
+  return SplitVideoPipeline{.encoder = trim(pipeline.substr(0, link_pos)),
+                            .packetizer = trim(pipeline.substr(payloader_pos))};
+}
+
+int bitrate_tier(int bitrate_kbps) {
+  auto step = std::max(1, std::atoi(utils::get_env("WOLF_SHARED_ENCODER_BITRATE_STEP", "5000")));
+  if (bitrate_kbps < step) {
+    return bitrate_kbps;
+  }
+  return bitrate_kbps / step * step;
+}
+
+bool shared_encoders_enabled() {
+  return utils::get_env("WOLF_SHARED_ENCODER", "") != std::string("FALSE");
+}
+
+/**
+ * Quits the loop from within its own context,
+ * unlike g_main_loop_quit() this isn't lost if the loop hasn't started running yet
+ */
+static void quit_loop_soon(const gstreamer::gst_main_loop_ptr &loop) {
+  auto source = g_idle_source_new();
+  g_source_set_callback(
+      source,
+      [](gpointer data) -> gboolean {
+        g_main_loop_quit(static_cast<GMainLoop *>(data));
+        return G_SOURCE_REMOVE;
+      },
+      g_main_loop_ref(loop.get()),
+      (GDestroyNotify)g_main_loop_unref);
+  g_source_attach(source, g_main_loop_get_context(loop.get()));
+  g_source_unref(source);
+}
+
+/**
+ * Links an interpipesink called name to the only unlinked source pad of a pre-built encoder pipeline
+ */
+static bool attach_interpipesink(GstElement *pipeline, const std::string &name) {
+  if (!GST_IS_BIN(pipeline)) {
+    return false;
+  }
+  auto src_pad = gst_bin_find_unlinked_pad(GST_BIN(pipeline), GST_PAD_SRC);
+  if (!src_pad) {
+    return false;
+  }
+  auto sink = gst_element_factory_make("interpipesink", name.c_str());
+  if (!sink) {
+    gst_object_unref(src_pad);
+    return false;
+  }
+  g_object_set(sink, "sync", FALSE, "async", FALSE, "max-buffers", 0, NULL);
+  gst_bin_add(GST_BIN(pipeline), sink);
+
+  auto sink_pad = gst_element_get_static_pad(sink, "sink");
+  auto linked = gst_pad_link(src_pad, sink_pad) == GST_PAD_LINK_OK;
+  gst_object_unref(sink_pad);
+  gst_object_unref(src_pad);
+  return linked && gst_element_sync_state_with_parent(sink);
+}
+
+SharedEncoder::SharedEncoder(std::string pipeline_desc, std::string sink_name, gstreamer::gst_element_ptr prebuilt)
+    : pipeline_desc(std::move(pipeline_desc)), name(std::move(sink_name)), prebuilt(std::move(prebuilt)) {
+  thread = std::thread([this]() { run(); });
+}
+
+SharedEncoder::~SharedEncoder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    if (loop) {
+      quit_loop_soon(loop);
+    }
+  }
+  thread.join();
+}
+
+void SharedEncoder::run() {
+  auto full_pipeline = fmt::format("{} !\ninterpipesink name={} sync=false async=false max-buffers=0",
+                                   pipeline_desc,
+                                   name);
+  if (prebuilt && !attach_interpipesink(prebuilt.get(), name)) {
+    logs::log(logs::warning, "[GSTREAMER] Unable to attach {} to the pooled encoder, building a new one", name);
+    gst_element_set_state(prebuilt.get(), GST_STATE_NULL);
+    prebuilt.reset();
+  }
+  logs::log(logs::debug, "[GSTREAMER] Starting shared encoder{}: \n{}", prebuilt ? " (pooled)" : "", full_pipeline);
+
+  auto on_ready = [this](auto pipeline, auto loop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->pipeline = pipeline;
+    this->loop = loop;
+    if (stopping) { // every session left before we even got here
+      quit_loop_soon(loop);
+    }
+    return immer::array<immer::box<events::EventBusHandlers>>{};
+  };
+  auto started = prebuilt ? run_pipeline(std::move(prebuilt), on_ready) : run_pipeline(full_pipeline, on_ready);
+  if (!started) {
+    logs::log(logs::error, "[GSTREAMER] Unable to start shared encoder {}", name);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  pipeline.reset();
+  loop.reset();
+  logs::log(logs::debug, "[GSTREAMER] Shared encoder {} stopped", name);
+}
+
+void SharedEncoder::force_idr() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (pipeline) {
+    logs::log(logs::debug, "[GSTREAMER] Forcing IDR on shared encoder {}", name);
+    gstreamer::send_message(pipeline.get(),
+                            gst_structure_new("GstForceKeyUnit", "all-headers", G_TYPE_BOOLEAN, TRUE, NULL));
+  }
+}
+
+void SharedEncoder::request_bitrate(std::size_t session_id, int bitrate_kbps) {
+  std::lock_guard<std::mutex> lock(mutex);
+  requested_bitrates[session_id] = bitrate_kbps;
+  apply_bitrate();
+}
+
+void SharedEncoder::release_bitrate(std::size_t session_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (requested_bitrates.erase(session_id) > 0) {
+    apply_bitrate();
+  }
+}
+
+void SharedEncoder::apply_bitrate() {
+  if (requested_bitrates.empty() || !pipeline) {
+    return;
+  }
+  auto lowest = std::min_element(requested_bitrates.begin(),
+                                 requested_bitrates.end(),
+                                 [](const auto &a, const auto &b) { return a.second < b.second; })
+                    ->second;
+  if (lowest != applied_bitrate) {
+    logs::log(logs::debug, "[GSTREAMER] Shared encoder {} bitrate: {} kbps", name, lowest);
+    gstreamer::set_encoder_bitrate(pipeline.get(), lowest);
+    applied_bitrate = lowest;
+  }
+}
+
+std::shared_ptr<SharedEncoder>
+acquire_shared_encoder(const std::string &encoder_desc,
+                       const std::function<gstreamer::gst_element_ptr()> &claim_prebuilt) {
+  static std::mutex encoders_mutex;
+  static std::map<std::string, std::weak_ptr<SharedEncoder>> encoders;
+  static std::size_t next_encoder_id = 0;
+
+  std::lock_guard<std::mutex> lock(encoders_mutex);
+  std::erase_if(encoders, [](const auto &entry) { return entry.second.expired(); });
+
+  if (auto found = encoders.find(encoder_desc); found != encoders.end()) {
+    if (auto encoder = found->second.lock()) {
+      logs::log(logs::debug,
+                "[GSTREAMER] Joining shared encoder {} ({} viewers)",
+                encoder->sink_name(),
+                found->second.use_count());
+      // The new viewer can't decode anything until the next IDR
+      encoder->force_idr();
+      return encoder;
+    }
+  }
+
+  auto encoder = std::make_shared<SharedEncoder>(encoder_desc,
+                                                 fmt::format("shared_encoder_{}", next_encoder_id++),
+                                                 claim_prebuilt ? claim_prebuilt() : nullptr);
+  encoders[encoder_desc] = encoder;
+  return encoder;
+}
+
+} // namespace streaming
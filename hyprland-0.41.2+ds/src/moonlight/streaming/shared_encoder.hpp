@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <core/gstreamer.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace streaming {
+
+using namespace wolf::core;
+
+/**
+ * A video session pipeline, split in two:
+ *  - encoder: source, conversion and encoding, everything up to the encoded access units
+ *  - packetizer: from rtpmoonlightpay_video onwards (FEC, encryption, UDP), always private to a session
+ */
+struct SplitVideoPipeline {
+  std::string encoder;
+  std::string packetizer;
+};
+
+/**
+ * Splits a formatted video pipeline right before `rtpmoonlightpay_video`
+ * @return std::nullopt if the pipeline doesn't have a Moonlight payloader
+ */
+std::optional<SplitVideoPipeline> split_video_pipeline(const std::string &pipeline);
+
+/**
+ * Rounds a bitrate down to its tier, so that sessions asking for similar bitrates can share one encoder.
+ * Down, because the client asked for at most that much: 18000 kbps becomes 15000 kbps with the default step.
+ * Bitrates below a single step are returned as they are.
+ * The tier size is taken from WOLF_SHARED_ENCODER_BITRATE_STEP (kbps, default 5000), 1 disables the rounding
+ */
+int bitrate_tier(int bitrate_kbps);
+
+/**
+ * @return false when WOLF_SHARED_ENCODER=FALSE, every session then runs its own encoder
+ */
+bool shared_encoders_enabled();
+
+/**
+ * A single encoder publishing access units on an interpipesink that any number of sessions listen to.
+ *
+ * The encoder description is the key: two sessions producing the exact same string (same display, resolution,
+ * framerate, codec, bitrate tier and colour settings) are served by the same instance.
+ * It runs in its own thread and is stopped when the last session drops its reference.
+ *
+ * `prebuilt`, when set, is the encoder pipeline already built and pre-rolled (taken from the pipeline pool) without
+ * its interpipesink: the sink name has to be unique, it's only added once the encoder is started.
+ */
+class SharedEncoder {
+public:
+  SharedEncoder(std::string pipeline_desc, std::string sink_name, gstreamer::gst_element_ptr prebuilt = nullptr);
+  ~SharedEncoder();
+
+  SharedEncoder(const SharedEncoder &) = delete;
+  SharedEncoder &operator=(const SharedEncoder &) = delete;
+
+  /**
+   * Name of the interpipesink, sessions use `interpipesrc listen-to={sink_name}`
+   */
+  const std::string &sink_name() const {
+    return name;
+  }
+
+  /**
+   * Asks the encoder for a new IDR frame, every session listening will receive it
+   */
+  void force_idr();
+
+  /**
+   * Records the bitrate that a viewer can currently take.
+   * The encoder runs at the lowest one requested so that no viewer gets congested.
+   */
+  void request_bitrate(std::size_t session_id, int bitrate_kbps);
+
+  /**
+   * Forgets about a viewer that left, the others might be able to go back up
+   */
+  void release_bitrate(std::size_t session_id);
+
+private:
+  void apply_bitrate(); // expects mutex to be held
+
+  void run();
+
+  std::string pipeline_desc;
+  std::string name;
+  gstreamer::gst_element_ptr prebuilt;
+
+  std::mutex mutex;
+  gstreamer::gst_element_ptr pipeline;
+  gstreamer::gst_main_loop_ptr loop;
+  bool stopping = false;
+
+  std::map<std::size_t /* session_id */, int /* kbps */> requested_bitrates;
+  int applied_bitrate = 0;
+
+  std::thread thread;
+};
+
+/**
+ * Returns the encoder running `encoder_desc`, starting it if no other session is using it.
+ * `claim_prebuilt` is only called when a new encoder has to be started, it can hand over an encoder pipeline that
+ * is already built (see pipeline_pool.hpp) or return nullptr to have `encoder_desc` parsed.
+ */
+std::shared_ptr<SharedEncoder>
+acquire_shared_encoder(const std::string &encoder_desc,
+                       const std::function<gstreamer::gst_element_ptr()> &claim_prebuilt = nullptr);
+
+} // namespace streaming
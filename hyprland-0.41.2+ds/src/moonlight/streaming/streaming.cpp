@@ -1,10 +1,17 @@
+#include <control/congestion.hpp>
 #include <control/control.hpp>
 #include <gstreamer-1.0/gst/app/gstappsink.h>
 #include <gstreamer-1.0/gst/app/gstappsrc.h>
 #include <immer/array.hpp>
 #include <immer/box.hpp>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <streaming/pipeline_pool.hpp>
+#include <streaming/shared_encoder.hpp>
 #include <streaming/streaming.hpp>
+#include <streaming/udp_sink.hpp>
 
 namespace streaming {
 
@@ -138,75 +145,256 @@ void start_audio_producer(std::size_t session_id,
   });
 }
 
-namespace custom_sink {
+/**
+ * A stream pipeline that can outlive its client going away (ex: Moonlight backgrounded on a phone).
+ *
+ * Instead of being torn down the pipeline goes to PAUSED: sources stop producing, the encoder keeps its context and
+ * nothing reaches the UDP sink anymore. When the client comes back we just go back to PLAYING, after rebinding the
+ * client endpoint and keys in place if it's coming back with a new session.
+ * If nobody shows up within WOLF_PAUSED_STREAM_TIMEOUT seconds (default 300) the pipeline is stopped like before.
+ *
+ * `settings` describes what the pipeline encodes, a new session can only take it over if it asks for the same.
+ */
+class PausableStream {
+public:
+  using on_pause_fn = std::function<void()>;
+  using on_resume_fn = std::function<void(std::size_t /* paused session_id */, const std::optional<StreamRebind> &)>;
+
+  PausableStream(std::size_t session_id,
+                 std::string settings,
+                 gstreamer::gst_element_ptr pipeline,
+                 gstreamer::gst_main_loop_ptr loop,
+                 on_pause_fn on_pause,
+                 on_resume_fn on_resume)
+      : id(session_id), settings(std::move(settings)), pipeline(std::move(pipeline)), loop(std::move(loop)),
+        on_pause(std::move(on_pause)), on_resume(std::move(on_resume)) {}
+
+  ~PausableStream() {
+    cancel_timeout();
+  }
 
-struct UDPSink {
-  std::shared_ptr<udp::socket> socket;
-  std::shared_ptr<udp::endpoint> client_endpoint;
-};
+  std::size_t session_id() const {
+    return id.load();
+  }
+
+  bool has_settings(const std::string &wanted) const {
+    return settings == wanted;
+  }
 
-static GstFlowReturn
-send_buffer(std::shared_ptr<GstBuffer> buffer, std::shared_ptr<GstSample> sample, UDPSink *udp_sink) {
-  GstMapInfo map;
-  if (gst_buffer_map(buffer.get(), &map, GST_MAP_READ)) {
-    std::shared_ptr<GstMapInfo> map_ptr = std::make_shared<GstMapInfo>(map);
-    if (!udp_sink->socket->is_open()) {
-      logs::log(logs::warning, "UDP Socket is not open");
-      udp_sink->socket->open(udp::v4());
+  /**
+   * Stops the pipeline for good, like when nobody comes back before the timeout
+   */
+  void stop() {
+    g_main_loop_quit(loop.get());
+  }
+
+  /**
+   * @return false when pausing is disabled (WOLF_PAUSED_STREAM_TIMEOUT=0), the pipeline has to be stopped instead
+   */
+  bool pause() {
+    auto timeout_s = std::atoi(utils::get_env("WOLF_PAUSED_STREAM_TIMEOUT", "300"));
+    if (timeout_s <= 0) {
+      return false;
     }
-    udp_sink->socket->async_send_to(
-        boost::asio::buffer(map.data, map.size),
-        *udp_sink->client_endpoint,
-        [buffer, sample, map_ptr](const boost::system::error_code &error, std::size_t bytes_sent) {
-          if (error) {
-            logs::log(logs::error, "Error sending UDP packet: {}", error.message());
-          }
-          gst_buffer_unmap(buffer.get(), map_ptr.get());
-        });
-    return GST_FLOW_OK;
-  } else {
-    logs::log(logs::error, "Failed to map buffer");
-    return GST_FLOW_ERROR;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (paused) {
+      return true;
+    }
+    on_pause();
+    gst_element_set_state(pipeline.get(), GST_STATE_PAUSED);
+    paused = true;
+
+    timeout = g_timeout_source_new_seconds(timeout_s);
+    g_source_set_callback(
+        timeout,
+        [](gpointer data) -> gboolean {
+          logs::log(logs::debug, "[GSTREAMER] Nobody came back to the paused stream, stopping it");
+          g_main_loop_quit(static_cast<GMainLoop *>(data));
+          return G_SOURCE_REMOVE;
+        },
+        g_main_loop_ref(loop.get()),
+        (GDestroyNotify)g_main_loop_unref);
+    g_source_attach(timeout, g_main_loop_get_context(loop.get()));
+    return true;
+  }
+
+  /**
+   * Goes back to PLAYING, handing the stream over to rebind->session_id first if set
+   * @return false if the stream wasn't paused
+   */
+  bool resume(const std::optional<StreamRebind> &rebind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!paused) {
+      return false;
+    }
+    cancel_timeout();
+    on_resume(id.load(), rebind);
+    if (rebind) {
+      id = rebind->session_id;
+    }
+    gst_element_set_state(pipeline.get(), GST_STATE_PLAYING);
+    paused = false;
+    return true;
   }
+
+private:
+  void cancel_timeout() {
+    if (timeout) {
+      g_source_destroy(timeout);
+      g_source_unref(timeout);
+      timeout = nullptr;
+    }
+  }
+
+  std::atomic<std::size_t> id;
+  const std::string settings;
+  gstreamer::gst_element_ptr pipeline;
+  gstreamer::gst_main_loop_ptr loop;
+  on_pause_fn on_pause;
+  on_resume_fn on_resume;
+
+  std::mutex mutex;
+  bool paused = false;
+  GSource *timeout = nullptr;
+};
+
+enum class StreamKind { VIDEO, AUDIO };
+
+static std::mutex paused_streams_mutex;
+static std::map<std::pair<StreamKind, std::size_t /* session_id */>, std::shared_ptr<PausableStream>> paused_streams;
+
+static void park_stream(StreamKind kind, const std::shared_ptr<PausableStream> &stream) {
+  std::lock_guard<std::mutex> lock(paused_streams_mutex);
+  paused_streams[{kind, stream->session_id()}] = stream;
 }
 
-static GstFlowReturn on_new_sample(GstAppSink *appsink, gpointer user_data) {
-  std::shared_ptr<GstSample> sample(gst_app_sink_pull_sample(appsink), gst_sample_unref);
-  if (!sample) {
-    logs::log(logs::warning, "Custom sink: failed to create sample");
-    return GST_FLOW_ERROR;
+static std::shared_ptr<PausableStream> unpark_stream(StreamKind kind, std::size_t session_id) {
+  std::lock_guard<std::mutex> lock(paused_streams_mutex);
+  auto found = paused_streams.find({kind, session_id});
+  if (found == paused_streams.end()) {
+    return nullptr;
   }
+  auto stream = found->second;
+  paused_streams.erase(found);
+  return stream;
+}
 
-  UDPSink *udp_sink = static_cast<UDPSink *>(user_data);
+static bool resume_paused_stream(StreamKind kind,
+                                 std::size_t paused_session_id,
+                                 const StreamRebind &rebind,
+                                 const std::string &settings = {}) {
+  if (auto stream = unpark_stream(kind, paused_session_id)) {
+    if (!stream->has_settings(settings)) {
+      // Nobody else can take it over, no point in keeping its encoder around until the timeout
+      logs::log(logs::debug,
+                "[GSTREAMER] Paused stream {} doesn't match the settings of session {}, stopping it",
+                paused_session_id,
+                rebind.session_id);
+      stream->stop();
+      return false;
+    }
+    logs::log(logs::debug,
+              "[GSTREAMER] Handing paused stream {} over to session {}",
+              paused_session_id,
+              rebind.session_id);
+    return stream->resume(rebind);
+  }
+  return false;
+}
 
-  if (GstBufferList *buffer_list = gst_sample_get_buffer_list(sample.get())) {
-    // TODO: use boost to properly send multiple buffers in one go (scatter-gather I/O)
-    for (guint i = 0; i < gst_buffer_list_length(buffer_list); ++i) {
-      GstBuffer *buffer = gst_buffer_list_get(buffer_list, i);
-      std::shared_ptr<GstBuffer> buffer_ptr(gst_buffer_ref(buffer), gst_buffer_unref);
-      if (auto result = send_buffer(buffer_ptr, sample, udp_sink); result != GST_FLOW_OK) {
-        return result;
-      }
+bool resume_paused_audio(std::size_t paused_session_id, const StreamRebind &rebind) {
+  return resume_paused_stream(StreamKind::AUDIO, paused_session_id, rebind);
+}
+
+/**
+ * A client coming back with a new session starts over from the first RTP sequence number (and frame)
+ */
+static void reset_payloader(GstElement *pipeline) {
+  if (auto payloader = gst_bin_get_by_name(GST_BIN(pipeline), "moonlight_pay")) {
+    if (gst_IS_rtp_moonlight_pay_video(payloader)) {
+      gst_rtp_moonlight_pay_video(payloader)->cur_seq_number = 0;
+      gst_rtp_moonlight_pay_video(payloader)->frame_num = 0;
+    } else if (gst_IS_rtp_moonlight_pay_audio(payloader)) {
+      gst_rtp_moonlight_pay_audio(payloader)->cur_seq_number = 0;
     }
-    return GST_FLOW_OK;
-  } else if (GstBuffer *buffer = gst_sample_get_buffer(sample.get())) {
-    std::shared_ptr<GstBuffer> buffer_ptr(gst_buffer_ref(buffer), gst_buffer_unref);
-    return send_buffer(buffer_ptr, sample, udp_sink);
-  } else {
-    logs::log(logs::warning, "Custom sink: failed to get buffer");
-    return GST_FLOW_ERROR;
+    gst_object_unref(payloader);
   }
 }
 
-static void configure_appsink(GstElement *appsink, UDPSink *udp_sink) {
-  g_object_set(appsink, "emit-signals", FALSE, NULL);
-  g_object_set(appsink, "buffer-list", TRUE, NULL);
+/**
+ * The video pipeline of a session with everything that only depends on the session itself left as placeholders,
+ * two sessions in the same mode get the same key (see pipeline_pool.hpp)
+ */
+static std::string video_pool_key(const immer::box<events::VideoSession> &video_session) {
+  auto [color_range, color_space] = get_color_params(video_session);
+  return fmt::format(fmt::runtime(video_session->gst_pipeline),
+                     fmt::arg("session_id", "{session_id}"),
+                     fmt::arg("width", video_session->display_mode.width),
+                     fmt::arg("height", video_session->display_mode.height),
+                     fmt::arg("fps", video_session->display_mode.refreshRate),
+                     fmt::arg("bitrate", "{bitrate}"),
+                     fmt::arg("client_port", "{client_port}"),
+                     fmt::arg("client_ip", "{client_ip}"),
+                     fmt::arg("payload_size", "{payload_size}"),
+                     fmt::arg("fec_percentage", "{fec_percentage}"),
+                     fmt::arg("min_required_fec_packets", "{min_required_fec_packets}"),
+                     fmt::arg("slices_per_frame", video_session->slices_per_frame),
+                     fmt::arg("color_space", color_space),
+                     fmt::arg("color_range", color_range),
+                     fmt::arg("host_port", "{host_port}"));
+}
 
-  GstAppSinkCallbacks callbacks = {nullptr};
-  callbacks.new_sample = on_new_sample;
-  gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, udp_sink, nullptr);
+/**
+ * What a paused video stream has to match to be taken over: the mode, the pipeline (which also selects the codec,
+ * see rtsp/commands.hpp) and the requested bitrate
+ */
+static std::string video_settings(const immer::box<events::VideoSession> &video_session) {
+  return fmt::format("{}\nbitrate={}", video_pool_key(video_session), video_session->bitrate_kbps);
+}
+
+bool resume_paused_video(std::size_t paused_session_id,
+                         const immer::box<events::VideoSession> &video_session,
+                         const StreamRebind &rebind) {
+  return resume_paused_stream(StreamKind::VIDEO, paused_session_id, rebind, video_settings(video_session));
+}
+
+/**
+ * @return the encoder half of pool_key when sessions can share it (see start_streaming_video()),
+ *         that's what gets pooled for them instead of the whole pipeline
+ */
+static std::optional<std::string> shared_encoder_key(const std::string &pool_key) {
+  if (!shared_encoders_enabled()) {
+    return std::nullopt;
+  }
+  auto split = split_video_pipeline(pool_key);
+  if (!split || split->encoder.find("{session_id}") != std::string::npos) {
+    return std::nullopt;
+  }
+  return split->encoder;
+}
+
+void prewarm_video_pipelines(const std::string &gst_pipeline) {
+  auto modes = utils::split(utils::get_env("WOLF_PIPELINE_POOL_MODES", ""), ',');
+  for (const auto &mode : modes) {
+    int width = 0, height = 0, fps = 0;
+    if (mode.empty()) {
+      continue;
+    }
+    if (std::sscanf(std::string(mode).c_str(), "%dx%d@%d", &width, &height, &fps) != 3) {
+      logs::log(logs::warning, "Invalid WOLF_PIPELINE_POOL_MODES entry: {}, expected WIDTHxHEIGHT@FPS", mode);
+      continue;
+    }
+    // Moonlight defaults: a single slice, limited range BT.601
+    auto session = events::VideoSession{.display_mode = {.width = width, .height = height, .refreshRate = fps},
+                                        .gst_pipeline = gst_pipeline,
+                                        .slices_per_frame = 1,
+                                        .color_range = events::ColorRange::MPEG,
+                                        .color_space = events::ColorSpace::BT601};
+    auto pool_key = video_pool_key(session);
+    fill_pipeline_pool(shared_encoder_key(pool_key).value_or(pool_key));
+  }
 }
-} // namespace custom_sink
 
 /**
  * Start VIDEO pipeline
@@ -216,30 +404,92 @@ void start_streaming_video(immer::box<events::VideoSession> video_session,
                            std::string client_ip,
                            unsigned short client_port,
                            std::shared_ptr<udp::socket> video_socket) {
-  auto [color_range, color_space] = get_color_params(video_session);
+  auto pool_key = video_pool_key(video_session);
+
+  /*
+   * Sessions watching the same display with the same settings share one encoder, each one only runs its own
+   * packetizer (FEC, encryption, sequence numbers) on top of it.
+   * Bitrates are rounded to a tier so that clients asking for slightly different values can still share it.
+   * An encoder fed by a per-session source (ex: `listen-to={session_id}_video`) can't be shared with anyone,
+   * those sessions run a single pipeline instead. The default source (`listen-to=hyprland_video`, published by the
+   * compositor) is the same for every session.
+   * Either way the part that holds the encoder can come from the pipeline pool.
+   */
+  auto encoder_key = shared_encoder_key(pool_key);
+  bool share_encoder = encoder_key.has_value();
+  auto bitrate = share_encoder ? bitrate_tier(video_session->bitrate_kbps) : video_session->bitrate_kbps;
+  if (bitrate != video_session->bitrate_kbps) {
+    logs::log(logs::info,
+              "[GSTREAMER] Session {} asked for {} kbps, streaming at the shared encoder tier of {} kbps",
+              video_session->session_id,
+              video_session->bitrate_kbps,
+              bitrate);
+  }
 
-  auto pipeline = fmt::format(fmt::runtime(video_session->gst_pipeline),
-                              fmt::arg("session_id", video_session->session_id),
-                              fmt::arg("width", video_session->display_mode.width),
-                              fmt::arg("height", video_session->display_mode.height),
-                              fmt::arg("fps", video_session->display_mode.refreshRate),
-                              fmt::arg("bitrate", video_session->bitrate_kbps),
-                              fmt::arg("client_port", client_port),
-                              fmt::arg("client_ip", client_ip),
-                              fmt::arg("payload_size", video_session->packet_size),
-                              fmt::arg("fec_percentage", video_session->fec_percentage),
-                              fmt::arg("min_required_fec_packets", video_session->min_required_fec_packets),
-                              fmt::arg("slices_per_frame", video_session->slices_per_frame),
-                              fmt::arg("color_space", color_space),
-                              fmt::arg("color_range", color_range),
-                              fmt::arg("host_port", video_session->port));
-  logs::log(logs::debug, "Starting video pipeline: \n{}", pipeline);
+  auto pipeline = format_pool_key(pool_key,
+                                  PoolSessionArgs{.session_id = std::to_string(video_session->session_id),
+                                                  .client_ip = client_ip,
+                                                  .client_port = client_port,
+                                                  .host_port = video_session->port,
+                                                  .bitrate_kbps = bitrate,
+                                                  .payload_size = video_session->packet_size,
+                                                  .fec_percentage = video_session->fec_percentage,
+                                                  .min_required_fec_packets = video_session->min_required_fec_packets});
+
+  std::shared_ptr<SharedEncoder> shared_encoder;
+  gst_element_ptr pipeline_el;
+  if (share_encoder) {
+    if (auto split = split_video_pipeline(pipeline)) {
+      shared_encoder = acquire_shared_encoder(split->encoder, [&]() {
+        auto encoder_el = claim_pooled_pipeline(*encoder_key, video_session->session_id);
+        if (encoder_el) { // built with a throwaway bitrate
+          set_encoder_bitrate(encoder_el.get(), (int)bitrate);
+        }
+        return encoder_el;
+      });
+      // No leaking here: dropping encoded access units would corrupt every frame until the next IDR
+      pipeline = fmt::format("interpipesrc name=shared_encoder_src listen-to={} is-live=true stream-sync=restart-ts "
+                             "max-bytes=0 max-buffers=0 block=false !\n{}",
+                             shared_encoder->sink_name(),
+                             split->packetizer);
+    }
+  } else if ((pipeline_el = claim_pooled_pipeline(pool_key, video_session->session_id))) {
+    // Everything but the session id was built with throwaway values
+    set_encoder_bitrate(pipeline_el.get(), (int)bitrate);
+    if (auto payloader = gst_bin_get_by_name(GST_BIN(pipeline_el.get()), "moonlight_pay")) {
+      g_object_set(payloader,
+                   "payload_size",
+                   video_session->packet_size,
+                   "fec_percentage",
+                   video_session->fec_percentage,
+                   "min_required_fec_packets",
+                   video_session->min_required_fec_packets,
+                   NULL);
+      gst_object_unref(payloader);
+    }
+  }
+  logs::log(logs::debug, "Starting video pipeline{}: \n{}", pipeline_el ? " (pooled)" : "", pipeline);
+  if (!pipeline_el && !(pipeline_el = parse_pipeline(pipeline))) {
+    return;
+  }
 
   std::shared_ptr<custom_sink::UDPSink> udp_sink = std::make_shared<custom_sink::UDPSink>(custom_sink::UDPSink{
       .socket = video_socket,
       .client_endpoint = std::make_shared<udp::endpoint>(boost::asio::ip::make_address(client_ip), client_port)});
+  udp_sink->loss_simulator = LossSimulator::from_env();
+
+  std::shared_ptr<control::CongestionController> congestion;
+  if (control::adaptive_bitrate_enabled()) {
+    auto limits = control::congestion_limits_from_env((int)bitrate, video_session->fec_percentage);
+    congestion = std::make_shared<control::CongestionController>(limits,
+                                                                 (int)bitrate,
+                                                                 video_session->fec_percentage,
+                                                                 video_session->display_mode.refreshRate);
+  }
 
-  run_pipeline(pipeline, [video_session, event_bus, udp_sink](auto pipeline, auto loop) {
+  std::shared_ptr<PausableStream> stream;
+  run_pipeline(pipeline_el, [&stream, video_session, event_bus, udp_sink, shared_encoder, congestion](auto pipeline,
+                                                                                                      auto loop) {
     if (auto app_sink_el = gst_bin_get_by_name(GST_BIN(pipeline.get()), "wolf_udp_sink")) {
       logs::log(logs::debug, "Setting up wolf_udp_sink");
       g_assert(GST_IS_APP_SINK(app_sink_el));
@@ -247,56 +497,151 @@ void start_streaming_video(immer::box<events::VideoSession> video_session,
       gst_object_unref(app_sink_el);
     }
 
+    auto force_idr = [pipeline, shared_encoder]() {
+      if (shared_encoder) { // our pipeline has no encoder, the IDR goes to all the viewers
+        shared_encoder->force_idr();
+        return;
+      }
+      logs::log(logs::debug, "[GSTREAMER] Forcing IDR");
+      // Force IDR event, see: https://github.com/centricular/gstwebrtc-demos/issues/186
+      // https://gstreamer.freedesktop.org/documentation/additional/design/keyframe-force.html?gi-language=c
+      wolf::core::gstreamer::send_message(
+          pipeline.get(),
+          gst_structure_new("GstForceKeyUnit", "all-headers", G_TYPE_BOOLEAN, TRUE, NULL));
+    };
+
+    /*
+     * While paused a shared encoder keeps going for the other viewers,
+     * we stop listening to it so that its access units don't pile up in our interpipesrc
+     */
+    auto listen_to_shared_encoder = [pipeline, shared_encoder](bool listen) {
+      if (!shared_encoder) {
+        return;
+      }
+      if (auto src = gst_bin_get_by_name(GST_BIN(pipeline.get()), "shared_encoder_src")) {
+        g_object_set(src, "listen-to", listen ? shared_encoder->sink_name().c_str() : nullptr, NULL);
+        gst_object_unref(src);
+      }
+    };
+
+    stream = std::make_shared<PausableStream>(
+        video_session->session_id,
+        video_settings(video_session),
+        pipeline,
+        loop,
+        [listen_to_shared_encoder]() { listen_to_shared_encoder(false); },
+        [pipeline, udp_sink, shared_encoder, force_idr, listen_to_shared_encoder](
+            std::size_t paused_session_id,
+            const std::optional<StreamRebind> &rebind) {
+          if (rebind) {
+            udp_sink->client_endpoint =
+                std::make_shared<udp::endpoint>(boost::asio::ip::make_address(rebind->client_ip), rebind->client_port);
+            reset_payloader(pipeline.get());
+            if (shared_encoder) {
+              shared_encoder->release_bitrate(paused_session_id);
+            }
+          }
+          listen_to_shared_encoder(true);
+          // The client has reset its decoder, the encoder is still warm so this comes out right away
+          force_idr();
+        });
+
     /*
      * The force IDR event will be triggered by the control stream.
      * We have to pass this back into the gstreamer pipeline
      * in order to force the encoder to produce a new IDR packet
      */
     auto idr_handler = event_bus->register_handler<immer::box<events::IDRRequestEvent>>(
-        [sess_id = video_session->session_id, pipeline](const immer::box<events::IDRRequestEvent> &ctrl_ev) {
-          if (ctrl_ev->session_id == sess_id) {
-            logs::log(logs::debug, "[GSTREAMER] Forcing IDR");
-            // Force IDR event, see: https://github.com/centricular/gstwebrtc-demos/issues/186
-            // https://gstreamer.freedesktop.org/documentation/additional/design/keyframe-force.html?gi-language=c
-            wolf::core::gstreamer::send_message(
-                pipeline.get(),
-                gst_structure_new("GstForceKeyUnit", "all-headers", G_TYPE_BOOLEAN, TRUE, NULL));
+        [stream = stream, force_idr](const immer::box<events::IDRRequestEvent> &ctrl_ev) {
+          if (ctrl_ev->session_id == stream->session_id()) {
+            force_idr();
+          }
+        });
+
+    /*
+     * The client reports lost frames and pings us periodically over the control stream,
+     * the congestion controller turns that into a new bitrate and FEC percentage that we apply live
+     */
+    auto stats_handler = event_bus->register_handler<immer::box<events::ClientNetworkStatsEvent>>(
+        [stream = stream, pipeline, shared_encoder, congestion](const immer::box<events::ClientNetworkStatsEvent> &ev) {
+          auto sess_id = stream->session_id();
+          if (ev->session_id != sess_id || !congestion) {
+            return;
+          }
+
+          congestion->on_rtt(ev->rtt_ms);
+          if (ev->interval_ms > 0) {
+            congestion->on_loss_report(ev->lost_frames, ev->interval_ms);
+          }
+          if (ev->frame_invalidated) {
+            congestion->on_frame_invalidated();
+          }
+
+          if (auto decision = congestion->update()) {
+            if (auto payloader = gst_bin_get_by_name(GST_BIN(pipeline.get()), "moonlight_pay")) {
+              g_object_set(payloader, "fec_percentage", decision->fec_percentage, NULL);
+              gst_object_unref(payloader);
+            }
+            if (shared_encoder) { // the other viewers might not be able to take more
+              shared_encoder->request_bitrate(sess_id, decision->bitrate_kbps);
+            } else if (!set_encoder_bitrate(pipeline.get(), decision->bitrate_kbps)) {
+              logs::log(logs::debug, "[GSTREAMER] No encoder bitrate to adapt in pipeline: {}", sess_id);
+            }
           }
         });
 
     auto pause_handler = event_bus->register_handler<immer::box<events::PauseStreamEvent>>(
-        [sess_id = video_session->session_id, loop](const immer::box<events::PauseStreamEvent> &ev) {
+        [stream = stream, loop](const immer::box<events::PauseStreamEvent> &ev) {
+          auto sess_id = stream->session_id();
           if (ev->session_id == sess_id) {
-            logs::log(logs::debug, "[GSTREAMER] Pausing pipeline: {}", sess_id);
-
             /**
-             * Unfortunately here we can't just pause the pipeline,
-             * when a pipeline will be resumed there are a lot of breaking changes
-             * like:
+             * When the client comes back a lot of things might have changed, like:
              *  - Client IP:PORT
              *  - AES key and IV for encrypted payloads
-             *  - Client resolution, framerate, and encoding
              *
-             *  The only solution is to kill the pipeline and re-create it again
-             * when a resume happens
+             * Those are rebound in place (see resume_paused_video()), so we keep the encoder around.
+             * A client coming back with a different resolution, framerate, codec, pipeline or bitrate gets a new
+             * pipeline instead.
              */
+            if (stream->pause()) {
+              logs::log(logs::debug, "[GSTREAMER] Pausing pipeline: {}", sess_id);
+              park_stream(StreamKind::VIDEO, stream);
+            } else {
+              logs::log(logs::debug, "[GSTREAMER] Stopping paused pipeline: {}", sess_id);
+              g_main_loop_quit(loop.get());
+            }
+          }
+        });
 
-            g_main_loop_quit(loop.get());
+    auto resume_handler = event_bus->register_handler<immer::box<events::ResumeStreamEvent>>(
+        [stream = stream](const immer::box<events::ResumeStreamEvent> &ev) {
+          if (ev->session_id == stream->session_id() && unpark_stream(StreamKind::VIDEO, ev->session_id)) {
+            logs::log(logs::debug, "[GSTREAMER] Resuming pipeline: {}", ev->session_id);
+            stream->resume(std::nullopt);
           }
         });
 
     auto stop_handler = event_bus->register_handler<immer::box<events::StopStreamEvent>>(
-        [sess_id = video_session->session_id, loop](const immer::box<events::StopStreamEvent> &ev) {
-          if (ev->session_id == sess_id) {
-            logs::log(logs::debug, "[GSTREAMER] Stopping pipeline: {}", sess_id);
+        [stream = stream, loop](const immer::box<events::StopStreamEvent> &ev) {
+          if (ev->session_id == stream->session_id()) {
+            logs::log(logs::debug, "[GSTREAMER] Stopping pipeline: {}", ev->session_id);
             g_main_loop_quit(loop.get());
           }
         });
 
     return immer::array<immer::box<events::EventBusHandlers>>{std::move(idr_handler),
+                                                              std::move(stats_handler),
                                                               std::move(pause_handler),
+                                                              std::move(resume_handler),
                                                               std::move(stop_handler)};
   });
+
+  if (stream) {
+    unpark_stream(StreamKind::VIDEO, stream->session_id());
+    if (shared_encoder) {
+      shared_encoder->release_bitrate(stream->session_id());
+    }
+  }
 }
 
 /**
@@ -309,9 +654,10 @@ void start_streaming_audio(immer::box<events::AudioSession> audio_session,
                            std::shared_ptr<udp::socket> audio_socket,
                            const std::string &sink_name,
                            const std::string &server_name) {
-  auto pipeline = fmt::format(
+  // Everything that only depends on the session is left as a placeholder, see pipeline_pool.hpp
+  auto pool_key = fmt::format(
       fmt::runtime(audio_session->gst_pipeline),
-      fmt::arg("session_id", audio_session->session_id),
+      fmt::arg("session_id", "{session_id}"),
       fmt::arg("channels", audio_session->audio_mode.channels),
       fmt::arg("bitrate", audio_session->audio_mode.bitrate),
       // TODO: opusenc hardcodes those two
@@ -321,19 +667,44 @@ void start_streaming_audio(immer::box<events::AudioSession> audio_session,
       fmt::arg("sink_name", sink_name),
       fmt::arg("server_name", server_name),
       fmt::arg("packet_duration", audio_session->packet_duration),
-      fmt::arg("aes_key", audio_session->aes_key),
-      fmt::arg("aes_iv", audio_session->aes_iv),
+      fmt::arg("aes_key", "{aes_key}"),
+      fmt::arg("aes_iv", "{aes_iv}"),
       fmt::arg("encrypt", audio_session->encrypt_audio),
-      fmt::arg("client_port", client_port),
-      fmt::arg("client_ip", client_ip),
-      fmt::arg("host_port", audio_session->port));
-  logs::log(logs::debug, "Starting audio pipeline: \n{}", pipeline);
+      fmt::arg("client_port", "{client_port}"),
+      fmt::arg("client_ip", "{client_ip}"),
+      fmt::arg("host_port", "{host_port}"));
+  auto pipeline = format_pool_key(pool_key,
+                                  PoolSessionArgs{.session_id = std::to_string(audio_session->session_id),
+                                                  .client_ip = client_ip,
+                                                  .client_port = client_port,
+                                                  .host_port = audio_session->port,
+                                                  .aes_key = audio_session->aes_key,
+                                                  .aes_iv = audio_session->aes_iv});
+
+  auto pipeline_el = claim_pooled_pipeline(pool_key, audio_session->session_id);
+  if (pipeline_el) {
+    if (auto payloader = gst_bin_get_by_name(GST_BIN(pipeline_el.get()), "moonlight_pay")) {
+      g_object_set(payloader,
+                   "aes_key",
+                   audio_session->aes_key.c_str(),
+                   "aes_iv",
+                   audio_session->aes_iv.c_str(),
+                   NULL);
+      gst_object_unref(payloader);
+    }
+  }
+  logs::log(logs::debug, "Starting audio pipeline{}: \n{}", pipeline_el ? " (pooled)" : "", pipeline);
+  if (!pipeline_el && !(pipeline_el = parse_pipeline(pipeline))) {
+    return;
+  }
 
   std::shared_ptr<custom_sink::UDPSink> udp_sink = std::make_shared<custom_sink::UDPSink>(custom_sink::UDPSink{
       .socket = audio_socket,
       .client_endpoint = std::make_shared<udp::endpoint>(boost::asio::ip::make_address(client_ip), client_port)});
 
-  run_pipeline(pipeline, [session_id = audio_session->session_id, udp_sink, event_bus](auto pipeline, auto loop) {
+  std::shared_ptr<PausableStream> stream;
+  auto session_id = audio_session->session_id;
+  run_pipeline(pipeline_el, [&stream, session_id, udp_sink, event_bus](auto pipeline, auto loop) {
     if (auto app_sink_el = gst_bin_get_by_name(GST_BIN(pipeline.get()), "wolf_udp_sink")) {
       logs::log(logs::debug, "Setting up wolf_udp_sink");
       g_assert(GST_IS_APP_SINK(app_sink_el));
@@ -341,37 +712,64 @@ void start_streaming_audio(immer::box<events::AudioSession> audio_session,
       gst_object_unref(app_sink_el);
     }
 
+    stream = std::make_shared<PausableStream>(
+        session_id,
+        std::string(),
+        pipeline,
+        loop,
+        []() {},
+        [pipeline, udp_sink](std::size_t, const std::optional<StreamRebind> &rebind) {
+          if (!rebind) {
+            return;
+          }
+          udp_sink->client_endpoint =
+              std::make_shared<udp::endpoint>(boost::asio::ip::make_address(rebind->client_ip), rebind->client_port);
+          reset_payloader(pipeline.get());
+          if (auto payloader = gst_bin_get_by_name(GST_BIN(pipeline.get()), "moonlight_pay")) {
+            g_object_set(payloader, "aes_key", rebind->aes_key.c_str(), "aes_iv", rebind->aes_iv.c_str(), NULL);
+            gst_object_unref(payloader);
+          }
+        });
+
     auto pause_handler = event_bus->register_handler<immer::box<events::PauseStreamEvent>>(
-        [session_id, loop](const immer::box<events::PauseStreamEvent> &ev) {
+        [stream = stream, loop](const immer::box<events::PauseStreamEvent> &ev) {
+          auto session_id = stream->session_id();
           if (ev->session_id == session_id) {
-            logs::log(logs::debug, "[GSTREAMER] Pausing pipeline: {}", session_id);
-
-            /**
-             * Unfortunately here we can't just pause the pipeline,
-             * when a pipeline will be resumed there are a lot of breaking changes
-             * like:
-             *  - Client IP:PORT
-             *  - AES key and IV for encrypted payloads
-             *  - Client resolution, framerate, and encoding
-             *
-             *  The only solution is to kill the pipeline and re-create it again
-             * when a resume happens
-             */
+            // The new AES key and IV are rebound in place when the client comes back, see resume_paused_audio()
+            if (stream->pause()) {
+              logs::log(logs::debug, "[GSTREAMER] Pausing pipeline: {}", session_id);
+              park_stream(StreamKind::AUDIO, stream);
+            } else {
+              logs::log(logs::debug, "[GSTREAMER] Stopping paused pipeline: {}", session_id);
+              g_main_loop_quit(loop.get());
+            }
+          }
+        });
 
-            g_main_loop_quit(loop.get());
+    auto resume_handler = event_bus->register_handler<immer::box<events::ResumeStreamEvent>>(
+        [stream = stream](const immer::box<events::ResumeStreamEvent> &ev) {
+          if (ev->session_id == stream->session_id() && unpark_stream(StreamKind::AUDIO, ev->session_id)) {
+            logs::log(logs::debug, "[GSTREAMER] Resuming pipeline: {}", ev->session_id);
+            stream->resume(std::nullopt);
           }
         });
 
     auto stop_handler = event_bus->register_handler<immer::box<events::StopStreamEvent>>(
-        [session_id, loop](const immer::box<events::StopStreamEvent> &ev) {
-          if (ev->session_id == session_id) {
-            logs::log(logs::debug, "[GSTREAMER] Stopping pipeline: {}", session_id);
+        [stream = stream, loop](const immer::box<events::StopStreamEvent> &ev) {
+          if (ev->session_id == stream->session_id()) {
+            logs::log(logs::debug, "[GSTREAMER] Stopping pipeline: {}", ev->session_id);
             g_main_loop_quit(loop.get());
           }
         });
 
-    return immer::array<immer::box<events::EventBusHandlers>>{std::move(pause_handler), std::move(stop_handler)};
+    return immer::array<immer::box<events::EventBusHandlers>>{std::move(pause_handler),
+                                                              std::move(resume_handler),
+                                                              std::move(stop_handler)};
   });
+
+  if (stream) {
+    unpark_stream(StreamKind::AUDIO, stream->session_id());
+  }
 }
 
 } // namespace streaming
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <core/virtual-display.hpp>
 #include <core/events.hpp>
 #include <fmt/format.h>
+#include <gst-plugin/gstmoonlightdamageroi.hpp>
 #include <gst-plugin/gstrtpmoonlightpay_audio.hpp>
 #include <gst-plugin/gstrtpmoonlightpay_video.hpp>
 #include <gst-plugin/video.hpp>
@@ -57,10 +58,52 @@ void start_streaming_audio(immer::box<events::AudioSession> audio_session,
                            const std::string &sink_name,
                            const std::string &server_name);
 
-static bool run_pipeline(
-    const std::string &pipeline_desc,
-    const std::function<immer::array<immer::box<events::EventBusHandlers>>(
-        gstreamer::gst_element_ptr /* pipeline */, gstreamer::gst_main_loop_ptr /* main_loop */)> &on_pipeline_ready) {
+/**
+ * The video pipeline the Hyprland desktop sessions are started with (see rest/endpoints.hpp),
+ * software H264 encoding: nvh264enc causes hanging
+ */
+constexpr auto HYPRLAND_VIDEO_PIPELINE = "x264enc";
+
+/**
+ * Builds spare video pipelines from gst_pipeline for every mode listed in WOLF_PIPELINE_POOL_MODES,
+ * ex: "1920x1080@60,2560x1440@120,3840x2160@60", so that even the first session in those modes starts right away.
+ * When the sessions would share their encoder only that half is built, see shared_encoder.hpp
+ */
+void prewarm_video_pipelines(const std::string &gst_pipeline);
+
+/**
+ * A client coming back to a paused stream: the new session and where to send it the stream
+ */
+struct StreamRebind {
+  std::size_t session_id;
+  std::string client_ip;
+  unsigned short client_port;
+
+  /* Audio only, the keys of the new session */
+  std::string aes_key;
+  std::string aes_iv;
+};
+
+/**
+ * Hands a paused video stream over to a new session (ex: from the /resume endpoint) and starts it again,
+ * the encoder is still initialised so the client only waits for the next IDR.
+ * The paused stream has to encode what video_session asks for: same mode, pipeline (and so codec) and bitrate,
+ * otherwise it's stopped.
+ * @return false if there's no matching paused stream for paused_session_id, a new pipeline has to be started
+ */
+bool resume_paused_video(std::size_t paused_session_id,
+                         const immer::box<events::VideoSession> &video_session,
+                         const StreamRebind &rebind);
+
+/**
+ * Same as resume_paused_video() for the audio stream
+ */
+bool resume_paused_audio(std::size_t paused_session_id, const StreamRebind &rebind);
+
+/**
+ * @return the pipeline described by pipeline_desc, nullptr if it can't be parsed
+ */
+static gstreamer::gst_element_ptr parse_pipeline(const std::string &pipeline_desc) {
   GError *error = nullptr;
   gstreamer::gst_element_ptr pipeline(gst_parse_launch(pipeline_desc.c_str(), &error), [](const auto &pipeline) {
     logs::log(logs::trace, "~pipeline");
@@ -70,13 +113,22 @@ static bool run_pipeline(
   if (!pipeline) {
     logs::log(logs::error, "[GSTREAMER] Pipeline parse error: {}", error->message);
     g_error_free(error);
-    return false;
+    return nullptr;
   } else if (error) { // Please note that you might get a return value that is not NULL even though the error is set. In
                       // this case there was a recoverable parsing error and you can try to play the pipeline.
     logs::log(logs::warning, "[GSTREAMER] Pipeline parse error (recovered): {}", error->message);
     g_error_free(error);
   }
+  return pipeline;
+}
+
+using on_pipeline_ready_fn = std::function<immer::array<immer::box<events::EventBusHandlers>>(
+    gstreamer::gst_element_ptr /* pipeline */, gstreamer::gst_main_loop_ptr /* main_loop */)>;
 
+/**
+ * Runs an already built pipeline (ex: taken from the pipeline pool) until someone quits its main loop
+ */
+static bool run_pipeline(gstreamer::gst_element_ptr pipeline, const on_pipeline_ready_fn &on_pipeline_ready) {
   gstreamer::gst_main_context_ptr context = {g_main_context_new(), ::g_main_context_unref};
   g_main_context_push_thread_default(context.get());
   gstreamer::gst_main_loop_ptr loop(g_main_loop_new(context.get(), FALSE), ::g_main_loop_unref);
@@ -112,6 +164,14 @@ static bool run_pipeline(
   return true;
 }
 
+static bool run_pipeline(const std::string &pipeline_desc, const on_pipeline_ready_fn &on_pipeline_ready) {
+  auto pipeline = parse_pipeline(pipeline_desc);
+  if (!pipeline) {
+    return false;
+  }
+  return run_pipeline(pipeline, on_pipeline_ready);
+}
+
 /**
  * @return the Gstreamer version we are linked to
  */
@@ -134,6 +194,7 @@ inline void init() {
 
   gst_element_register(nullptr, "rtpmoonlightpay_video", GST_RANK_PRIMARY, gst_TYPE_rtp_moonlight_pay_video);
   gst_element_register(nullptr, "rtpmoonlightpay_audio", GST_RANK_PRIMARY, gst_TYPE_rtp_moonlight_pay_audio);
+  gst_element_register(nullptr, "moonlightdamageroi", GST_RANK_NONE, gst_TYPE_moonlight_damage_roi);
 
   moonlight::fec::init();
 }
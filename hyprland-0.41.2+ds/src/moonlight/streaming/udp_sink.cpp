@@ -0,0 +1,229 @@
+#include <core/logger.hpp>
+#include <cstring>
+#include <gstreamer-1.0/gst/app/gstappsink.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <streaming/udp_sink.hpp>
+
+namespace streaming::custom_sink {
+
+/* Kernel limits for a single UDP_SEGMENT send */
+constexpr std::size_t GSO_MAX_SEGMENTS = 64;
+constexpr std::size_t GSO_MAX_BYTES = 65507;
+constexpr std::size_t MMSG_MAX_BATCH = 1024;
+
+/**
+ * Waits (briefly) until the socket can take more data, asio keeps the fd in non-blocking mode
+ */
+static bool wait_writable(int fd) {
+  pollfd pfd = {.fd = fd, .events = POLLOUT, .revents = 0};
+  return poll(&pfd, 1, 100) > 0;
+}
+
+#ifdef UDP_SEGMENT
+/**
+ * Sends iovs[from, from + count) as a single GSO super-datagram: the kernel splits it in segment_size datagrams.
+ * Only the last segment is allowed to be shorter than segment_size.
+ */
+static bool send_gso(int fd, UDPSink *udp_sink, std::size_t from, std::size_t count, uint16_t segment_size) {
+  char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+  msghdr msg = {};
+  msg.msg_name = udp_sink->client_endpoint->data();
+  msg.msg_namelen = udp_sink->client_endpoint->size();
+  msg.msg_iov = &udp_sink->iovs[from];
+  msg.msg_iovlen = count;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_UDP;
+  cm->cmsg_type = UDP_SEGMENT;
+  cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  *reinterpret_cast<uint16_t *>(CMSG_DATA(cm)) = segment_size;
+
+  while (sendmsg(fd, &msg, 0) < 0) {
+    if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(fd)) {
+      continue;
+    }
+    if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+      logs::log(logs::warning, "UDP GSO not available ({}), falling back to sendmmsg", strerror(errno));
+      udp_sink->gso_supported = false;
+    } else {
+      logs::log(logs::error, "Error sending UDP GSO batch: {}", strerror(errno));
+    }
+    return false;
+  }
+  return true;
+}
+#endif
+
+/**
+ * Sends iovs[from, from + count) as count separate datagrams with as few sendmmsg() calls as possible
+ */
+static bool send_mmsg(int fd, UDPSink *udp_sink, std::size_t from, std::size_t count) {
+  udp_sink->msgs.resize(count);
+  for (std::size_t i = 0; i < count; i++) {
+    auto &hdr = udp_sink->msgs[i].msg_hdr;
+    hdr = {};
+    hdr.msg_name = udp_sink->client_endpoint->data();
+    hdr.msg_namelen = udp_sink->client_endpoint->size();
+    hdr.msg_iov = &udp_sink->iovs[from + i];
+    hdr.msg_iovlen = 1;
+  }
+
+  std::size_t sent = 0;
+  while (sent < count) {
+    auto batch = std::min(count - sent, MMSG_MAX_BATCH);
+    int res = sendmmsg(fd, &udp_sink->msgs[sent], batch, 0);
+    if (res < 0) {
+      if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(fd)) {
+        continue;
+      }
+      logs::log(logs::error, "Error sending UDP batch: {}", strerror(errno));
+      return false;
+    }
+    sent += res;
+  }
+  return true;
+}
+
+static GstFlowReturn
+send_buffer(std::shared_ptr<GstBuffer> buffer, std::shared_ptr<GstSample> sample, UDPSink *udp_sink) {
+  GstMapInfo map;
+  if (gst_buffer_map(buffer.get(), &map, GST_MAP_READ)) {
+    if (udp_sink->loss_simulator && udp_sink->loss_simulator->drop(map.size)) {
+      udp_sink->packets_dropped++;
+      gst_buffer_unmap(buffer.get(), &map);
+      return GST_FLOW_OK;
+    }
+    std::shared_ptr<GstMapInfo> map_ptr = std::make_shared<GstMapInfo>(map);
+    if (!udp_sink->socket->is_open()) {
+      logs::log(logs::warning, "UDP Socket is not open");
+      udp_sink->socket->open(udp::v4());
+    }
+    udp_sink->socket->async_send_to(
+        boost::asio::buffer(map.data, map.size),
+        *udp_sink->client_endpoint,
+        [buffer, sample, map_ptr](const boost::system::error_code &error, std::size_t bytes_sent) {
+          if (error) {
+            logs::log(logs::error, "Error sending UDP packet: {}", error.message());
+          }
+          gst_buffer_unmap(buffer.get(), map_ptr.get());
+        });
+    return GST_FLOW_OK;
+  } else {
+    logs::log(logs::error, "Failed to map buffer");
+    return GST_FLOW_ERROR;
+  }
+}
+
+/**
+ * Maps every packet of the list once and hands them to the kernel in one go:
+ *  - UDP_SEGMENT (GSO) when all packets share the same size (true for video with add_padding): one syscall per 64
+ *  - sendmmsg() otherwise: one syscall per up to 1024 packets
+ * The kernel copies the payloads, so everything is unmapped before returning.
+ */
+GstFlowReturn send_buffer_list(GstBufferList *buffer_list, UDPSink *udp_sink) {
+  if (!udp_sink->socket->is_open()) {
+    logs::log(logs::warning, "UDP Socket is not open");
+    udp_sink->socket->open(udp::v4());
+  }
+
+  auto n_packets = gst_buffer_list_length(buffer_list);
+  udp_sink->maps.resize(n_packets);
+  udp_sink->iovs.resize(n_packets);
+
+  guint mapped = 0;
+  bool same_size = true;
+  for (; mapped < n_packets; ++mapped) {
+    GstBuffer *buffer = gst_buffer_list_get(buffer_list, mapped);
+    if (!gst_buffer_map(buffer, &udp_sink->maps[mapped], GST_MAP_READ)) {
+      logs::log(logs::error, "Failed to map buffer");
+      break;
+    }
+    udp_sink->iovs[mapped] = {.iov_base = udp_sink->maps[mapped].data, .iov_len = udp_sink->maps[mapped].size};
+    // Only the very last packet is allowed to be shorter in a GSO send
+    if (mapped > 0 && udp_sink->iovs[mapped - 1].iov_len != udp_sink->iovs[0].iov_len) {
+      same_size = false;
+    }
+  }
+
+  int fd = udp_sink->socket->native_handle();
+  bool ok = mapped == n_packets; // send errors are logged and the frame dropped, like the async path did
+  std::size_t sent = 0;
+  std::size_t to_send = n_packets;
+
+  // Removing packets keeps the "all the same size but the last one" property that GSO relies on
+  if (ok && udp_sink->loss_simulator) {
+    to_send = 0;
+    for (guint i = 0; i < n_packets; ++i) {
+      if (!udp_sink->loss_simulator->drop(udp_sink->iovs[i].iov_len)) {
+        udp_sink->iovs[to_send++] = udp_sink->iovs[i];
+      } else {
+        udp_sink->packets_dropped++;
+      }
+    }
+  }
+
+#ifdef UDP_SEGMENT
+  if (ok && to_send > 1 && udp_sink->iovs[to_send - 1].iov_len > udp_sink->iovs[0].iov_len) {
+    same_size = false;
+  }
+
+  if (ok && same_size && udp_sink->gso_supported && to_send > 1 && udp_sink->iovs[0].iov_len > 0) {
+    auto segment_size = udp_sink->iovs[0].iov_len;
+    auto per_send = std::min(GSO_MAX_SEGMENTS, std::max<std::size_t>(1, GSO_MAX_BYTES / segment_size));
+    while (ok && sent < to_send && udp_sink->gso_supported) {
+      auto count = std::min<std::size_t>(per_send, to_send - sent);
+      if (send_gso(fd, udp_sink, sent, count, segment_size)) {
+        sent += count;
+      } else if (udp_sink->gso_supported) { // a real send error, not a missing feature
+        ok = false;
+      }
+    }
+  }
+#endif
+
+  // No GSO (or it got disabled midway): whatever is left goes out with sendmmsg
+  if (ok && sent < to_send) {
+    ok = send_mmsg(fd, udp_sink, sent, to_send - sent);
+  }
+
+  for (guint i = 0; i < mapped; ++i) {
+    gst_buffer_unmap(gst_buffer_list_get(buffer_list, i), &udp_sink->maps[i]);
+  }
+
+  return mapped == n_packets ? GST_FLOW_OK : GST_FLOW_ERROR;
+}
+
+static GstFlowReturn on_new_sample(GstAppSink *appsink, gpointer user_data) {
+  std::shared_ptr<GstSample> sample(gst_app_sink_pull_sample(appsink), gst_sample_unref);
+  if (!sample) {
+    logs::log(logs::warning, "Custom sink: failed to create sample");
+    return GST_FLOW_ERROR;
+  }
+
+  UDPSink *udp_sink = static_cast<UDPSink *>(user_data);
+
+  if (GstBufferList *buffer_list = gst_sample_get_buffer_list(sample.get())) {
+    return send_buffer_list(buffer_list, udp_sink);
+  } else if (GstBuffer *buffer = gst_sample_get_buffer(sample.get())) {
+    std::shared_ptr<GstBuffer> buffer_ptr(gst_buffer_ref(buffer), gst_buffer_unref);
+    return send_buffer(buffer_ptr, sample, udp_sink);
+  } else {
+    logs::log(logs::warning, "Custom sink: failed to get buffer");
+    return GST_FLOW_ERROR;
+  }
+}
+
+void configure_appsink(GstElement *appsink, UDPSink *udp_sink) {
+  g_object_set(appsink, "emit-signals", FALSE, NULL);
+  g_object_set(appsink, "buffer-list", TRUE, NULL);
+
+  GstAppSinkCallbacks callbacks = {nullptr};
+  callbacks.new_sample = on_new_sample;
+  gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, udp_sink, nullptr);
+}
+
+} // namespace streaming::custom_sink
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <gst/gst.h>
+#include <memory>
+#include <optional>
+#include <streaming/loss_simulator.hpp>
+#include <sys/socket.h>
+#include <vector>
+
+namespace streaming::custom_sink {
+
+using boost::asio::ip::udp;
+
+/**
+ * Where an appsink at the end of a Moonlight pipeline (`wolf_udp_sink`) sends its RTP packets to.
+ * Only used from the appsink streaming thread.
+ */
+struct UDPSink {
+  std::shared_ptr<udp::socket> socket;
+  std::shared_ptr<udp::endpoint> client_endpoint;
+
+  /* Set to false the first time the kernel (or the NIC driver) refuses UDP_SEGMENT */
+  bool gso_supported = true;
+
+  /* Scratch space reused across samples so that sending a frame doesn't allocate */
+  std::vector<GstMapInfo> maps;
+  std::vector<iovec> iovs;
+  std::vector<mmsghdr> msgs;
+
+  /* Only set when WOLF_SIMULATE_VIDEO_LOSS is, see LossSimulator */
+  std::optional<LossSimulator> loss_simulator;
+  /* Packets the loss simulator kept from being sent */
+  uint64_t packets_dropped = 0;
+};
+
+/**
+ * Sends all the packets of a sample (a whole video frame, FEC included) to the client, see udp_sink.cpp
+ */
+GstFlowReturn send_buffer_list(GstBufferList *buffer_list, UDPSink *udp_sink);
+
+/**
+ * Hands every sample that reaches `appsink` over to `udp_sink`, which has to outlive the pipeline
+ */
+void configure_appsink(GstElement *appsink, UDPSink *udp_sink);
+
+} // namespace streaming::custom_sink
@@ -30,12 +30,15 @@ struct whisper_full_params {};
 #endif
 
 // System includes
+#include <cctype>
 #include <cmath>
 #include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <string_view>
 #include <unistd.h>
+#include <sys/eventfd.h>
 #include <pulse/simple.h>
 #include <pulse/error.h>
 #include <jsoncpp/json/json.h>
@@ -49,15 +52,69 @@ struct whisper_full_params {};
 // CWhisperManager Implementation
 // ===============================
 
+// Voice activity is decided on frames of this duration
+static constexpr int VAD_FRAME_MS = 20;
+// Highest rate we size the buffers for, WebRTC and Moonlight audio are 48kHz
+static constexpr int MAX_SAMPLE_RATE = 48000;
+// Independent accumulators for the reductions below. With a single one every iteration depends on the previous and
+// the compiler isn't allowed to reorder float math, with 8 of them it can keep them in vector registers.
+static constexpr size_t SIMD_LANES = 8;
+
+static size_t vadFrameSamples(int sample_rate) {
+    return static_cast<size_t>(sample_rate) * VAD_FRAME_MS / 1000;
+}
+
+static void mixToMono(const float* src, float* dst, size_t count, int channels) {
+    if (channels == 1) {
+        std::copy_n(src, count, dst);
+    } else if (channels == 2) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+        }
+    } else {
+        const float scale = 1.0f / channels;
+        for (size_t i = 0; i < count; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; ++c) {
+                sum += src[i * channels + c];
+            }
+            dst[i] = sum * scale;
+        }
+    }
+}
+
+// Whisper changes punctuation and case between decodes more often than words
+static bool sameWord(const std::string& a, const std::string& b) {
+    auto next = [](const std::string& s, size_t& i) {
+        while (i < s.size() && !std::isalnum(static_cast<unsigned char>(s[i]))) ++i;
+        return i < s.size() ? std::tolower(static_cast<unsigned char>(s[i++])) : -1;
+    };
+    
+    size_t i = 0, j = 0;
+    while (true) {
+        int ca = next(a, i);
+        int cb = next(b, j);
+        if (ca != cb) return false;
+        if (ca < 0) return true;
+    }
+}
+
 CWhisperManager::CWhisperManager() {
     Debug::log(Debug::LOG, "WhisperManager: Creating voice transcription manager");
     
+    // Lives as long as the manager, so that a late producer never writes to a closed fd
+    m_wake_fd = eventfd(0, EFD_CLOEXEC);
+    
     // Initialize default voice commands
     initializeDefaultCommands();
 }
 
 CWhisperManager::~CWhisperManager() {
     shutdown();
+    
+    if (m_wake_fd >= 0) {
+        close(m_wake_fd);
+    }
 }
 
 bool CWhisperManager::initialize(const std::string& model_path) {
@@ -76,8 +133,25 @@ bool CWhisperManager::initialize(const std::string& model_path) {
         return false;
     }
     
+    if (m_wake_fd < 0) {
+        Debug::log(Debug::ERR, "WhisperManager: eventfd failed: {}", strerror(errno));
+        return false;
+    }
+    
+    // Everything the audio path needs is allocated here, not per chunk
+    if (!m_audio_ring) {
+        m_audio_ring = std::make_unique<SPSCRing<float>>(
+            static_cast<size_t>(m_config.audio_buffer_ms) * MAX_SAMPLE_RATE / 1000);
+    }
+    m_frame.reserve(vadFrameSamples(MAX_SAMPLE_RATE));
+    m_audio_buffer.reserve(static_cast<size_t>(m_config.max_speech_duration_ms) * MAX_SAMPLE_RATE / 1000 +
+                           vadFrameSamples(MAX_SAMPLE_RATE));
+    m_resampled.reserve(static_cast<size_t>(std::max(m_config.max_speech_duration_ms, m_config.stream_window_ms)) *
+                        16000 / 1000 + vadFrameSamples(16000));
+    
     // Start processing thread
     m_should_shutdown.store(false);
+    m_wake_pending.store(false);
     m_processing_thread = std::thread(&CWhisperManager::processingThreadMain, this);
     
     m_initialized.store(true);
@@ -97,6 +171,12 @@ void CWhisperManager::shutdown() {
     
     m_should_shutdown.store(true);
     
+    // Wake the processing thread up, it may be waiting for audio that's never coming
+    uint64_t one = 1;
+    if (write(m_wake_fd, &one, sizeof(one)) < 0) {
+        Debug::log(Debug::ERR, "WhisperManager: eventfd write failed: {}", strerror(errno));
+    }
+    
     if (m_processing_thread.joinable()) {
         m_processing_thread.join();
     }
@@ -157,36 +237,66 @@ void CWhisperManager::cleanupWhisper() {
 }
 
 void CWhisperManager::processAudioChunk(const float* audio_data, size_t sample_count, int sample_rate) {
+    processInterleavedAudio(audio_data, sample_count, 1, sample_rate);
+}
+
+void CWhisperManager::processAudioChunk(const int16_t* audio_data, size_t sample_count, int sample_rate) {
     if (!m_initialized.load() || !audio_data || sample_count == 0) {
         return;
     }
     
-    AudioBuffer buffer;
-    buffer.samples.assign(audio_data, audio_data + sample_count);
-    buffer.timestamp = std::chrono::steady_clock::now();
-    buffer.sample_rate = sample_rate;
-    buffer.energy = calculateAudioEnergy(audio_data, sample_count);
-    buffer.is_speech = detectVoiceActivity(audio_data, sample_count);
-    
-    std::lock_guard<std::mutex> lock(m_audio_mutex);
-    m_audio_queue.push(std::move(buffer));
+    // Converted straight into the ring
+    m_ring_sample_rate.store(sample_rate, std::memory_order_relaxed);
+    size_t written = m_audio_ring->write(sample_count, [&](float* dst, size_t offset, size_t count) {
+        convertToFloat(audio_data + offset, dst, count);
+    });
+    onSamplesWritten(sample_count, written, sample_rate);
 }
 
-void CWhisperManager::processAudioChunk(const int16_t* audio_data, size_t sample_count, int sample_rate) {
-    if (!audio_data || sample_count == 0) return;
+void CWhisperManager::processInterleavedAudio(const float* audio_data, size_t frame_count, int channels, int sample_rate) {
+    if (!m_initialized.load() || !audio_data || frame_count == 0 || channels < 1) {
+        return;
+    }
     
-    // Convert int16 to float
-    std::vector<float> float_samples(sample_count);
-    convertToFloat(audio_data, float_samples.data(), sample_count);
+    // Whisper only wants mono, channels are averaged while writing to the ring
+    m_ring_sample_rate.store(sample_rate, std::memory_order_relaxed);
+    size_t written = m_audio_ring->write(frame_count, [&](float* dst, size_t offset, size_t count) {
+        mixToMono(audio_data + offset * channels, dst, count, channels);
+    });
+    onSamplesWritten(frame_count, written, sample_rate);
+}
+
+void CWhisperManager::onSamplesWritten(size_t requested, size_t written, int sample_rate) {
+    if (written < requested) {
+        m_dropped_samples.fetch_add(requested - written, std::memory_order_relaxed);
+    }
     
-    processAudioChunk(float_samples.data(), sample_count, sample_rate);
+    // Nothing to do for the processing thread until there's a whole VAD frame, and a single wakeup is enough
+    // until it drains the ring
+    if (m_audio_ring->size() >= vadFrameSamples(sample_rate) && !m_wake_pending.exchange(true)) {
+        uint64_t one = 1;
+        if (write(m_wake_fd, &one, sizeof(one)) < 0) {
+            m_wake_pending.store(false);
+        }
+    }
 }
 
 float CWhisperManager::calculateAudioEnergy(const float* samples, size_t count) {
     if (!samples || count == 0) return 0.0f;
     
+    float lanes[SIMD_LANES] = {};
+    size_t i = 0;
+    for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+        for (size_t lane = 0; lane < SIMD_LANES; ++lane) {
+            lanes[lane] += samples[i + lane] * samples[i + lane];
+        }
+    }
+    
     float energy = 0.0f;
-    for (size_t i = 0; i < count; ++i) {
+    for (float lane : lanes) {
+        energy += lane;
+    }
+    for (; i < count; ++i) {
         energy += samples[i] * samples[i];
     }
     return energy / count;
@@ -203,114 +313,296 @@ void CWhisperManager::processingThreadMain() {
     Debug::log(Debug::LOG, "WhisperManager: Processing thread started");
     
     while (!m_should_shutdown.load()) {
-        AudioBuffer buffer;
-        bool has_buffer = false;
-        
-        {
-            std::lock_guard<std::mutex> lock(m_audio_mutex);
-            if (!m_audio_queue.empty()) {
-                buffer = std::move(m_audio_queue.front());
-                m_audio_queue.pop();
-                has_buffer = true;
-            }
+        // Blocks until the producer has buffered a whole VAD frame, or shutdown() wakes us up
+        uint64_t count = 0;
+        if (read(m_wake_fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+            Debug::log(Debug::ERR, "WhisperManager: eventfd read failed: {}", strerror(errno));
+            break;
         }
         
-        if (has_buffer) {
-            processAudioBuffer(buffer);
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        // Reset before draining so that samples written while we drain wake us up again
+        m_wake_pending.store(false);
+        drainAudioRing();
     }
     
     Debug::log(Debug::LOG, "WhisperManager: Processing thread stopped");
 }
 
-void CWhisperManager::processAudioBuffer(const AudioBuffer& buffer) {
-    auto now = std::chrono::steady_clock::now();
+void CWhisperManager::drainAudioRing() {
+    const int sample_rate = m_ring_sample_rate.load(std::memory_order_relaxed);
+    const size_t frame_samples = vadFrameSamples(sample_rate);
+    if (frame_samples == 0) return;
+    
+    // Within the reserved capacity, unless the sample rate is above MAX_SAMPLE_RATE
+    m_frame.resize(frame_samples);
+    while (!m_should_shutdown.load() && m_audio_ring->size() >= frame_samples) {
+        m_audio_ring->read(m_frame.data(), frame_samples);
+        processAudioFrame(m_frame.data(), frame_samples, sample_rate);
+    }
+    
+    if (const auto dropped = m_dropped_samples.exchange(0); dropped > 0) {
+        Debug::log(Debug::WARN, "WhisperManager: audio buffer full, dropped {} samples", dropped);
+    }
+}
+
+void CWhisperManager::processAudioFrame(const float* samples, size_t count, int sample_rate) {
+    const auto to_ms = [sample_rate](size_t samples) { return static_cast<int>(samples * 1000 / sample_rate); };
     
     // Voice activity detection
-    if (buffer.is_speech) {
+    if (detectVoiceActivity(samples, count)) {
         if (!m_in_speech) {
             m_in_speech = true;
-            m_speech_start_time = now;
             if (onSpeechActivity) {
                 onSpeechActivity(true);
             }
         }
-        m_last_speech_time = now;
+        m_silence_samples = 0;
         
         // Accumulate audio samples
-        m_audio_buffer.insert(m_audio_buffer.end(), buffer.samples.begin(), buffer.samples.end());
-    } else {
+        m_audio_buffer.insert(m_audio_buffer.end(), samples, samples + count);
+        
+        if (m_config.enable_streaming) {
+            // Decode while speaking, the window is bounded and so is the cost of each decode
+            m_stream_pending_samples += count;
+            if (to_ms(m_stream_pending_samples) >= m_config.stream_step_ms) {
+                streamStep(sample_rate, false);
+            }
+        } else if (to_ms(m_audio_buffer.size()) >= m_config.max_speech_duration_ms) {
+            // Prevent buffer from growing too large
+            transcribeSpeech(sample_rate);
+        }
+    } else if (m_in_speech) {
         // Check if we should process accumulated speech
-        if (m_in_speech) {
-            auto silence_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - m_last_speech_time).count();
+        m_silence_samples += count;
+        
+        if (to_ms(m_silence_samples) >= m_config.silence_duration_ms) {
+            endUtterance(sample_rate);
+        }
+    }
+}
+
+void CWhisperManager::endUtterance(int sample_rate) {
+    const bool long_enough = m_audio_buffer.size() * 1000 / sample_rate >= static_cast<size_t>(m_config.min_speech_duration_ms);
+    
+    if (m_config.enable_streaming) {
+        // Nothing left to agree with, the last decode of the window is taken as it is
+        if (!m_audio_buffer.empty() && (long_enough || !m_stream_text.empty())) {
+            streamStep(sample_rate, true);
+        }
+        
+        if (!m_stream_text.empty()) {
+            char last_char = m_stream_text.back();
+            if (m_config.enable_punctuation && last_char != '.' && last_char != '!' && last_char != '?') {
+                m_stream_text += '.';
+                typeText(".");
+            }
             
-            if (silence_duration >= m_config.silence_duration_ms) {
-                // Process the accumulated speech
-                if (!m_audio_buffer.empty()) {
-                    auto speech_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        m_last_speech_time - m_speech_start_time).count();
-                    
-                    if (speech_duration >= m_config.min_speech_duration_ms) {
-                        m_processing.store(true);
-                        std::string transcription = transcribeAudio(m_audio_buffer, buffer.sample_rate);
-                        
-                        if (!transcription.empty()) {
-                            processTranscription(transcription, 1.0f);  // TODO: Get actual confidence
-                        }
-                        m_processing.store(false);
-                    }
-                }
-                
-                m_audio_buffer.clear();
-                m_in_speech = false;
-                
-                if (onSpeechActivity) {
-                    onSpeechActivity(false);
-                }
+            Debug::log(Debug::LOG, "WhisperManager: Streamed: '{}'", m_stream_text);
+            if (onTranscriptionReady) {
+                onTranscriptionReady(m_stream_text, 1.0f);
             }
         }
+        
+        // The prompt is kept, the next utterance most likely follows this one
+        m_stream_hypothesis.clear();
+        m_stream_text.clear();
+        m_stream_pending_samples = 0;
+    } else if (long_enough) {
+        transcribeSpeech(sample_rate);
     }
     
-    // Prevent buffer from growing too large
-    auto buffer_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now - m_speech_start_time).count();
+    m_audio_buffer.clear();
+    m_in_speech = false;
     
-    if (buffer_duration > m_config.max_speech_duration_ms) {
-        if (!m_audio_buffer.empty()) {
-            m_processing.store(true);
-            std::string transcription = transcribeAudio(m_audio_buffer, buffer.sample_rate);
-            
-            if (!transcription.empty()) {
-                processTranscription(transcription, 1.0f);
+    if (onSpeechActivity) {
+        onSpeechActivity(false);
+    }
+}
+
+void CWhisperManager::streamStep(int sample_rate, bool last_step) {
+    m_stream_pending_samples = 0;
+    
+    m_processing.store(true);
+    auto words = decodeWindow(sample_rate);
+    m_processing.store(false);
+    
+    // Local agreement: a word is stable once two consecutive decodes of the growing window agree on it, and on
+    // everything before it
+    size_t stable = 0;
+    if (last_step) {
+        stable = words.size();
+    } else {
+        while (stable < words.size() && stable < m_stream_hypothesis.size() &&
+               sameWord(words[stable].text, m_stream_hypothesis[stable].text)) {
+            ++stable;
+        }
+    }
+    
+    m_stream_hypothesis = std::move(words);
+    if (stable > 0) {
+        // The window restarts right after the committed words, their text goes on as the prompt instead
+        commitStreamWords(stable, m_stream_hypothesis[stable - 1].end_sample);
+    }
+    
+    // No agreement on a whole window (ex: mumbling): the oldest words are taken as they are, whisper won't get
+    // more audio for them anyway. The cut stays on a word boundary unless there's no word at all to commit.
+    const size_t max_samples = static_cast<size_t>(std::max(m_config.stream_window_ms - m_config.stream_step_ms, 0)) *
+                               sample_rate / 1000;
+    if (!last_step && m_audio_buffer.size() > max_samples) {
+        const size_t cut = m_audio_buffer.size() - max_samples;
+        size_t forced = 0;
+        while (forced < m_stream_hypothesis.size() && m_stream_hypothesis[forced].end_sample <= cut) {
+            ++forced;
+        }
+        commitStreamWords(forced, forced > 0 ? m_stream_hypothesis[forced - 1].end_sample : cut);
+    }
+}
+
+void CWhisperManager::commitStreamWords(size_t count, size_t cut_samples) {
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        text += m_stream_hypothesis[i].text;
+        
+        m_stream_prompt.insert(m_stream_prompt.end(), m_stream_hypothesis[i].tokens.begin(),
+                               m_stream_hypothesis[i].tokens.end());
+    }
+    
+    const size_t max_prompt = static_cast<size_t>(std::max(m_config.stream_prompt_tokens, 0));
+    if (m_stream_prompt.size() > max_prompt) {
+        m_stream_prompt.erase(m_stream_prompt.begin(), m_stream_prompt.end() - max_prompt);
+    }
+    
+    // Whisper puts a space before every word, not wanted at the start of an utterance
+    if (m_stream_text.empty()) {
+        text.erase(0, text.find_first_not_of(" \t\n\r"));
+        if (m_config.enable_capitalization && !text.empty()) {
+            text[0] = std::toupper(text[0]);
+        }
+    }
+    
+    if (!text.empty()) {
+        m_stream_text += text;
+        if (m_config.enable_keyboard_injection) {
+            typeText(text);
+        }
+    }
+    
+    cut_samples = std::min(cut_samples, m_audio_buffer.size());
+    m_audio_buffer.erase(m_audio_buffer.begin(), m_audio_buffer.begin() + cut_samples);
+    m_stream_hypothesis.erase(m_stream_hypothesis.begin(), m_stream_hypothesis.begin() + count);
+    for (auto& word : m_stream_hypothesis) {
+        word.end_sample = word.end_sample > cut_samples ? word.end_sample - cut_samples : 0;
+    }
+}
+
+std::vector<CWhisperManager::StreamWord> CWhisperManager::decodeWindow(int sample_rate) {
+    std::vector<StreamWord> words;
+    
+#if defined(HAVE_WHISPER) && HAVE_WHISPER
+    if (!m_whisper_ctx || !m_whisper_state || m_audio_buffer.empty()) {
+        return words;
+    }
+    
+    // Always a copy, the window is decoded again at the next step and preprocessing works in place
+    if (sample_rate != 16000) {
+        resampleAudio(m_audio_buffer, m_resampled, sample_rate, 16000);
+    } else {
+        m_resampled.assign(m_audio_buffer.begin(), m_audio_buffer.end());
+    }
+    
+    if (m_config.enable_preprocessing) {
+        preprocessAudio(m_resampled.data(), m_resampled.size());
+    }
+    
+    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.language = m_config.language.c_str();
+    params.translate = m_config.translate;
+    params.n_threads = m_config.num_threads;
+    params.print_progress = false;
+    params.print_timestamps = false;
+    params.print_realtime = false;
+    
+    // One segment per word, each with the timestamp the window is cut at once it's committed
+    params.token_timestamps = true;
+    params.max_len = 1;
+    params.split_on_word = true;
+    
+    // The only context is the committed text, not whatever the previous (overlapping) decode came up with
+    params.no_context = true;
+    params.prompt_tokens = m_stream_prompt.empty() ? nullptr : m_stream_prompt.data();
+    params.prompt_n_tokens = static_cast<int>(m_stream_prompt.size());
+    
+    int result = whisper_full_with_state(m_whisper_ctx, m_whisper_state, params,
+                                        m_resampled.data(), m_resampled.size());
+    if (result != 0) {
+        Debug::log(Debug::ERR, "WhisperManager: Streaming decode failed with code {}", result);
+        return words;
+    }
+    
+    const whisper_token eot = whisper_token_eot(m_whisper_ctx);
+    const int n_segments = whisper_full_n_segments_from_state(m_whisper_state);
+    words.reserve(n_segments);
+    
+    for (int i = 0; i < n_segments; ++i) {
+        const char* text = whisper_full_get_segment_text_from_state(m_whisper_state, i);
+        if (!text || std::string_view(text).find_first_not_of(" \t\n\r") == std::string_view::npos) {
+            continue;
+        }
+        
+        // Timestamps are in 10ms units
+        const int64_t t1 = whisper_full_get_segment_t1_from_state(m_whisper_state, i);
+        StreamWord word{.text = text,
+                        .end_sample = std::min(static_cast<size_t>(std::max<int64_t>(t1, 0)) * sample_rate / 100,
+                                               m_audio_buffer.size()),
+                        .tokens = {}};
+        
+        const int n_tokens = whisper_full_n_tokens_from_state(m_whisper_state, i);
+        for (int j = 0; j < n_tokens; ++j) {
+            const whisper_token id = whisper_full_get_token_id_from_state(m_whisper_state, i, j);
+            if (id < eot) {
+                word.tokens.push_back(id);
             }
-            m_processing.store(false);
         }
         
-        m_audio_buffer.clear();
-        m_in_speech = false;
+        words.push_back(std::move(word));
     }
+#else
+    Debug::log(Debug::LOG, "WhisperManager: Stub streaming decode - would process {} samples", m_audio_buffer.size());
+#endif
+    
+    return words;
 }
 
-std::string CWhisperManager::transcribeAudio(const std::vector<float>& samples, int sample_rate) {
+void CWhisperManager::transcribeSpeech(int sample_rate) {
+    if (!m_audio_buffer.empty()) {
+        m_processing.store(true);
+        std::string transcription = transcribeAudio(m_audio_buffer, sample_rate);
+        
+        if (!transcription.empty()) {
+            processTranscription(transcription, 1.0f);  // TODO: Get actual confidence
+        }
+        m_processing.store(false);
+    }
+    
+    m_audio_buffer.clear();
+}
+
+std::string CWhisperManager::transcribeAudio(std::vector<float>& samples, int sample_rate) {
 #if defined(HAVE_WHISPER) && HAVE_WHISPER
     if (!m_whisper_ctx || !m_whisper_state || samples.empty()) {
         return "";
     }
     
-    // Resample to 16kHz if needed
-    std::vector<float> resampled_samples;
+    // Resample to 16kHz if needed, otherwise the samples are used (and preprocessed) in place
+    std::vector<float>* pcm = &samples;
     if (sample_rate != 16000) {
-        resampleAudio(samples, resampled_samples, sample_rate, 16000);
-    } else {
-        resampled_samples = samples;
+        resampleAudio(samples, m_resampled, sample_rate, 16000);
+        pcm = &m_resampled;
     }
     
     // Preprocess audio
     if (m_config.enable_preprocessing) {
-        preprocessAudio(resampled_samples);
+        preprocessAudio(pcm->data(), pcm->size());
     }
     
     // Set up whisper parameters
@@ -324,7 +616,7 @@ std::string CWhisperManager::transcribeAudio(const std::vector<float>& samples,
     
     // Run inference
     int result = whisper_full_with_state(m_whisper_ctx, m_whisper_state, params, 
-                                        resampled_samples.data(), resampled_samples.size());
+                                        pcm->data(), pcm->size());
     
     if (result != 0) {
         Debug::log(Debug::ERR, "WhisperManager: Transcription failed with code {}", result);
@@ -489,6 +781,11 @@ void CWhisperManager::executeVoiceCommand(const std::string& command, const std:
 }
 
 void CWhisperManager::typeText(const std::string& text) {
+    if (m_offline_transcript) {
+        *m_offline_transcript += text;
+        return;
+    }
+    
     Debug::log(Debug::LOG, "WhisperManager: Typing text: '{}'", text);
     
     for (char c : text) {
@@ -506,6 +803,10 @@ void CWhisperManager::typeText(const std::string& text) {
 }
 
 void CWhisperManager::injectKeystroke(int keycode, bool pressed, uint32_t modifiers) {
+    if (m_offline_transcript) {
+        return;
+    }
+    
     if (onKeyboardEvent) {
         onKeyboardEvent(keycode, pressed, modifiers);
     }
@@ -581,48 +882,137 @@ std::vector<std::pair<std::string, std::string>> CWhisperManager::getVoiceComman
 }
 
 size_t CWhisperManager::getQueueSize() const {
-    std::lock_guard<std::mutex> lock(m_audio_mutex);
-    return m_audio_queue.size();
+    return m_audio_ring ? m_audio_ring->size() : 0;
 }
 
 void CWhisperManager::convertToFloat(const int16_t* input, float* output, size_t count) {
+    // A multiplication, unlike a division it vectorizes without -ffast-math
+    constexpr float scale = 1.0f / 32768.0f;
     for (size_t i = 0; i < count; ++i) {
-        output[i] = static_cast<float>(input[i]) / 32768.0f;
+        output[i] = static_cast<float>(input[i]) * scale;
     }
 }
 
-void CWhisperManager::preprocessAudio(std::vector<float>& samples) {
-    if (samples.empty()) return;
+std::string CWhisperManager::transcribeWavFile(const std::string& path) {
+    std::vector<float> samples;
+    int sample_rate = 0;
+    if (!readWavFile(path, samples, sample_rate)) {
+        return "";
+    }
+    
+    const size_t frame_samples = vadFrameSamples(sample_rate);
+    if (frame_samples == 0) {
+        Debug::log(Debug::ERR, "WhisperManager: Unsupported sample rate {} in {}", sample_rate, path);
+        return "";
+    }
     
-    // Normalize audio
-    normalizeAudio(samples);
+    std::string transcript;
+    m_offline_transcript = &transcript;
     
-    // Apply high-pass filter to remove low-frequency noise
-    applyHighPassFilter(samples, 80.0f, 16000);
+    for (size_t offset = 0; offset + frame_samples <= samples.size(); offset += frame_samples) {
+        processAudioFrame(samples.data() + offset, frame_samples, sample_rate);
+    }
+    
+    // Recordings often stop right after the last word, as if the speaker went quiet
+    if (m_in_speech) {
+        endUtterance(sample_rate);
+    }
+    
+    m_offline_transcript = nullptr;
+    return transcript;
 }
 
-void CWhisperManager::normalizeAudio(std::vector<float>& samples) {
-    if (samples.empty()) return;
+bool CWhisperManager::readWavFile(const std::string& path, std::vector<float>& samples, int& sample_rate) {
+    std::ifstream file(path, std::ios::binary);
+    char header[12];
+    if (!file.read(header, sizeof(header)) || std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0) {
+        Debug::log(Debug::ERR, "WhisperManager: {} is not a WAV file", path);
+        return false;
+    }
     
-    // Find peak amplitude
-    float peak = 0.0f;
-    for (float sample : samples) {
-        peak = std::max(peak, std::abs(sample));
+    uint16_t format = 0, channels = 0, bits = 0;
+    char id[4];
+    uint32_t size = 0;
+    while (file.read(id, sizeof(id)) && file.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+        if (std::memcmp(id, "fmt ", 4) == 0 && size >= 16) {
+            std::vector<char> fmt(size + (size & 1));
+            if (!file.read(fmt.data(), fmt.size())) break;
+            
+            uint32_t rate = 0;
+            std::memcpy(&format, fmt.data(), 2);
+            std::memcpy(&channels, fmt.data() + 2, 2);
+            std::memcpy(&rate, fmt.data() + 4, 4);
+            std::memcpy(&bits, fmt.data() + 14, 2);
+            // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the actual format tag
+            if (format == 0xFFFE && size >= 26) {
+                std::memcpy(&format, fmt.data() + 24, 2);
+            }
+            sample_rate = static_cast<int>(rate);
+        } else if (std::memcmp(id, "data", 4) == 0) {
+            const bool pcm16 = format == 1 && bits == 16;
+            const bool float32 = format == 3 && bits == 32;
+            if (channels == 0 || (!pcm16 && !float32)) {
+                Debug::log(Debug::ERR, "WhisperManager: {}: only 16 bit PCM and 32 bit float WAV are supported", path);
+                return false;
+            }
+            
+            const size_t frames = size / (bits / 8) / channels;
+            std::vector<float> interleaved(frames * channels);
+            if (pcm16) {
+                std::vector<int16_t> pcm(interleaved.size());
+                file.read(reinterpret_cast<char*>(pcm.data()), pcm.size() * sizeof(int16_t));
+                convertToFloat(pcm.data(), interleaved.data(), pcm.size());
+            } else {
+                file.read(reinterpret_cast<char*>(interleaved.data()), interleaved.size() * sizeof(float));
+            }
+            
+            samples.resize(frames);
+            mixToMono(interleaved.data(), samples.data(), frames, channels);
+            return true;
+        } else {
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
     }
     
-    // Normalize to 0.9 to prevent clipping
-    if (peak > 0.0f) {
-        float scale = 0.9f / peak;
-        for (float& sample : samples) {
-            sample *= scale;
+    Debug::log(Debug::ERR, "WhisperManager: No audio data in {}", path);
+    return false;
+}
+
+void CWhisperManager::preprocessAudio(float* samples, size_t count) {
+    if (!samples || count == 0) return;
+    
+    // Normalize to 0.9 to prevent clipping. The filter is linear so the gain is applied while filtering,
+    // a single pass over the samples instead of two
+    float peak = peakAmplitude(samples, count);
+    float gain = peak > 0.0f ? 0.9f / peak : 1.0f;
+    
+    // Apply high-pass filter to remove low-frequency noise
+    applyHighPassFilter(samples, count, 80.0f, 16000, gain);
+}
+
+float CWhisperManager::peakAmplitude(const float* samples, size_t count) {
+    float lanes[SIMD_LANES] = {};
+    size_t i = 0;
+    for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+        for (size_t lane = 0; lane < SIMD_LANES; ++lane) {
+            lanes[lane] = std::max(lanes[lane], std::abs(samples[i + lane]));
         }
     }
+    
+    float peak = 0.0f;
+    for (float lane : lanes) {
+        peak = std::max(peak, lane);
+    }
+    for (; i < count; ++i) {
+        peak = std::max(peak, std::abs(samples[i]));
+    }
+    return peak;
 }
 
-void CWhisperManager::applyHighPassFilter(std::vector<float>& samples, float cutoff_freq, int sample_rate) {
-    if (samples.empty()) return;
+void CWhisperManager::applyHighPassFilter(float* samples, size_t count, float cutoff_freq, int sample_rate, float gain) {
+    if (!samples || count == 0) return;
     
-    // Simple high-pass filter implementation
+    // Simple high-pass filter implementation, each output depends on the previous one so this stays scalar
     float rc = 1.0f / (2.0f * M_PI * cutoff_freq);
     float dt = 1.0f / sample_rate;
     float alpha = rc / (rc + dt);
@@ -630,11 +1020,12 @@ void CWhisperManager::applyHighPassFilter(std::vector<float>& samples, float cut
     float prev_input = 0.0f;
     float prev_output = 0.0f;
     
-    for (float& sample : samples) {
-        float output = alpha * (prev_output + sample - prev_input);
-        prev_input = sample;
+    for (size_t i = 0; i < count; ++i) {
+        float input = samples[i] * gain;
+        float output = alpha * (prev_output + input - prev_input);
+        prev_input = input;
         prev_output = output;
-        sample = output;
+        samples[i] = output;
     }
 }
 
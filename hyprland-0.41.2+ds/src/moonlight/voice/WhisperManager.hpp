@@ -10,6 +10,8 @@
 #include <functional>
 #include <chrono>
 
+#include "../core/spsc_ring.hpp"
+
 // Forward declaration for whisper.cpp
 struct whisper_context;
 struct whisper_state;
@@ -29,9 +31,15 @@ public:
     bool initialize(const std::string& model_path = "");
     void shutdown();
     
-    // Audio processing
+    // Audio processing, a single producer thread: samples are converted straight into a preallocated ring
     void processAudioChunk(const float* audio_data, size_t sample_count, int sample_rate = 16000);
     void processAudioChunk(const int16_t* audio_data, size_t sample_count, int sample_rate = 16000);
+    void processInterleavedAudio(const float* audio_data, size_t frame_count, int channels, int sample_rate);
+    
+    // Offline transcription of a PCM16 or float WAV file, through the same VAD, resampling and decoding as live
+    // audio; runs on the calling thread so don't feed live audio meanwhile. Nothing is injected, the text that
+    // would have been typed is returned instead.
+    std::string transcribeWavFile(const std::string& path);
     
     // Configuration
     struct Config {
@@ -47,9 +55,15 @@ public:
         int silence_duration_ms = 1000;                     // Silence before processing
         
         // Audio processing
-        int audio_buffer_ms = 3000;                         // Audio buffer duration
+        int audio_buffer_ms = 3000;                         // Audio buffered while a transcription runs
         bool enable_preprocessing = true;                    // Audio preprocessing (denoise, etc.)
         
+        // Streaming transcription, voice commands are only detected on whole utterances
+        bool enable_streaming = false;                      // Type text while speaking, not after each utterance
+        int stream_step_ms = 1000;                          // New speech between two decodes
+        int stream_window_ms = 8000;                        // Longest audio decoded at once
+        int stream_prompt_tokens = 224;                     // Committed text carried over as prompt
+        
         // Text processing
         bool enable_punctuation = true;                     // Add punctuation
         bool enable_capitalization = true;                  // Proper capitalization
@@ -74,7 +88,7 @@ public:
     // Status
     bool isInitialized() const { return m_initialized.load(); }
     bool isProcessing() const { return m_processing.load(); }
-    size_t getQueueSize() const;
+    size_t getQueueSize() const;                            // Samples waiting for the processing thread
     
     // Voice commands
     void registerVoiceCommand(const std::string& command, const std::string& description);
@@ -82,15 +96,6 @@ public:
     std::vector<std::pair<std::string, std::string>> getVoiceCommands() const;
 
 private:
-    // Audio buffer management
-    struct AudioBuffer {
-        std::vector<float> samples;
-        std::chrono::steady_clock::time_point timestamp;
-        int sample_rate;
-        bool is_speech = false;
-        float energy = 0.0f;
-    };
-    
     // State
     std::atomic<bool> m_initialized{false};
     std::atomic<bool> m_processing{false};
@@ -101,28 +106,55 @@ private:
     whisper_state* m_whisper_state = nullptr;
     
     // Audio processing
-    std::queue<AudioBuffer> m_audio_queue;
-    mutable std::mutex m_audio_mutex;
+    std::unique_ptr<SPSCRing<float>> m_audio_ring;     // Mono samples, allocated in initialize()
+    std::atomic<int> m_ring_sample_rate{16000};
+    std::atomic<size_t> m_dropped_samples{0};
+    int m_wake_fd = -1;                                 // eventfd, written once a whole VAD frame is buffered
+    std::atomic<bool> m_wake_pending{false};
     std::thread m_processing_thread;
     
+    // Only accessed from the processing thread, reserved upfront so that steady state doesn't allocate
+    std::vector<float> m_frame;                 // VAD frame read from the ring
     std::vector<float> m_audio_buffer;          // Accumulating audio buffer
-    std::chrono::steady_clock::time_point m_last_speech_time;
-    std::chrono::steady_clock::time_point m_speech_start_time;
+    std::vector<float> m_resampled;             // m_audio_buffer at 16kHz
+    size_t m_silence_samples = 0;               // Since the last speech frame
     bool m_in_speech = false;
     
+    // Streaming transcription, m_audio_buffer only holds the speech that hasn't been committed yet
+    struct StreamWord {
+        std::string text;
+        size_t end_sample;                      // In m_audio_buffer
+        std::vector<int32_t> tokens;            // whisper_token
+    };
+    std::vector<StreamWord> m_stream_hypothesis;    // Previous decode of the window
+    std::vector<int32_t> m_stream_prompt;           // Tokens of the committed text
+    std::string m_stream_text;                      // Committed text of the current utterance
+    size_t m_stream_pending_samples = 0;            // Speech since the previous decode
+    
+    std::string* m_offline_transcript = nullptr;    // Set by transcribeWavFile()
+    
     // Voice activity detection
     float calculateAudioEnergy(const float* samples, size_t count);
     bool detectVoiceActivity(const float* samples, size_t count);
     
-    // Audio preprocessing
-    void preprocessAudio(std::vector<float>& samples);
-    void normalizeAudio(std::vector<float>& samples);
-    void applyHighPassFilter(std::vector<float>& samples, float cutoff_freq, int sample_rate);
+    // Audio preprocessing, in place
+    void preprocessAudio(float* samples, size_t count);
+    float peakAmplitude(const float* samples, size_t count);
+    void applyHighPassFilter(float* samples, size_t count, float cutoff_freq, int sample_rate, float gain = 1.0f);
     
     // Processing
     void processingThreadMain();
-    void processAudioBuffer(const AudioBuffer& buffer);
-    std::string transcribeAudio(const std::vector<float>& samples, int sample_rate);
+    void onSamplesWritten(size_t requested, size_t written, int sample_rate);
+    void drainAudioRing();
+    void processAudioFrame(const float* samples, size_t count, int sample_rate);
+    void transcribeSpeech(int sample_rate);
+    void endUtterance(int sample_rate);
+    
+    // Streaming
+    void streamStep(int sample_rate, bool last_step);
+    std::vector<StreamWord> decodeWindow(int sample_rate);
+    void commitStreamWords(size_t count, size_t cut_samples);
+    std::string transcribeAudio(std::vector<float>& samples, int sample_rate);
     
     // Text processing
     std::string postProcessText(const std::string& raw_text);
@@ -148,6 +180,7 @@ private:
     
     // Audio format conversion
     void convertToFloat(const int16_t* input, float* output, size_t count);
+    bool readWavFile(const std::string& path, std::vector<float>& samples, int& sample_rate);
     void resampleAudio(const std::vector<float>& input, std::vector<float>& output, 
                       int input_rate, int output_rate);
 };
@@ -12,14 +12,14 @@
 #include <filesystem>
 #include <rfl/toml.hpp>
 #include <fmt/format.h>
-#include <gst/allocators/gstdmabuf.h>
-#include <gst/video/video.h>
 
 // Wolf REST server includes - only declarations to avoid linker conflicts
 #include "../rest/rest.hpp"
 
 // Wolf streaming includes for event handler implementation
 #include "../streaming/streaming.hpp"
+#include "../gst-plugin/capture_timestamp.hpp"
+#include "../gst-plugin/HyprlandFrameSource.hpp"
 #include "../streaming/rtp/udp-ping.hpp"
 #include "../streaming/rtsp/net.hpp"
 #include "../control/control.hpp"
@@ -114,7 +114,7 @@ std::shared_ptr<StreamSession> MoonlightState::getSession(const std::string& ses
 
 // StreamingEngine implementation
 StreamingEngine::StreamingEngine(std::shared_ptr<MoonlightState> state) 
-    : state_(state), pipeline_(nullptr), app_src_(nullptr), encoder_(nullptr), 
+    : state_(state), pipeline_(nullptr), frame_src_(nullptr), encoder_(nullptr), 
       payloader_(nullptr), sink_(nullptr), running_(false) {
 }
 
@@ -149,7 +149,7 @@ void StreamingEngine::shutdown() {
 }
 
 void StreamingEngine::pushFrame(const void* frame_data, size_t size, int width, int height, uint32_t format) {
-    if (!running_ || !app_src_) {
+    if (!running_ || !frame_src_) {
         return;
     }
 
@@ -164,79 +164,66 @@ void StreamingEngine::pushFrame(const void* frame_data, size_t size, int width,
     if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
         memcpy(map.data, frame_data, size);
         gst_buffer_unmap(buffer, &map);
+        gst_buffer_set_capture_timestamp(buffer, monotonic_now_ns());
 
-        // Push buffer to app source
-        GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(app_src_), buffer);
-        if (ret != GST_FLOW_OK) {
-            Debug::log(WARN, "WolfStreamingEngine: Failed to push buffer: {}", (int)ret);
-        }
+        // Same latest-wins mailbox as the DMA-BUF frames
+        gst_hyprland_frame_src_push_gst_buffer(GST_HYPRLAND_FRAME_SRC(frame_src_), buffer);
     } else {
         Debug::log(ERR, "WolfStreamingEngine: Failed to map GstBuffer");
         gst_buffer_unref(buffer);
     }
 }
 
-void StreamingEngine::pushFrameDMABuf(int dmabuf_fd, uint32_t stride, uint64_t modifier, int width, int height, uint32_t format, wlr_buffer* buffer_ref) {
-    if (!running_ || !app_src_) {
+void StreamingEngine::pushFrameDMABuf(wlr_buffer* buffer_ref, const std::vector<DamageRect>& damage, uint64_t capture_ns) {
+    if (!running_ || !frame_src_) {
         if (buffer_ref) {
             wlr_buffer_unlock(buffer_ref); // Release buffer if we can't process
         }
         return;
     }
 
-    Debug::log(LOG, "WolfStreamingEngine: Zero-copy DMA-BUF frame - fd: {}, {}x{}, stride: {}, modifier: {}",
-              dmabuf_fd, width, height, stride, modifier);
-
-    // Create GStreamer buffer from DMA-BUF file descriptor
-    // Use gst_dmabuf_allocator for zero-copy GPU buffer sharing
-    GstAllocator* dmabuf_allocator = gst_dmabuf_allocator_new();
-    if (!dmabuf_allocator) {
-        Debug::log(ERR, "WolfStreamingEngine: Failed to create DMA-BUF allocator");
-        if (buffer_ref) {
-            wlr_buffer_unlock(buffer_ref); // Release on error
-        }
-        return;
+    // One ROI per damaged rect, moonlightdamageroi turns these into encoder QP hints
+    std::vector<pixman_box32_t> boxes;
+    boxes.reserve(damage.size());
+    for (const auto& rect : damage) {
+        boxes.push_back({rect.x, rect.y, rect.x + rect.width, rect.y + rect.height});
     }
 
-    // Create memory object wrapping the DMA-BUF
-    size_t dmabuf_size = stride * height;
-    GstMemory* dmabuf_memory = gst_dmabuf_allocator_alloc(dmabuf_allocator, dmabuf_fd, dmabuf_size);
+    // hyprlandframesrc wraps the DMA-BUF planes and takes its own lock on the wlr_buffer until downstream is done.
+    // It never blocks: a frame the encoder hasn't picked up yet is replaced by this one.
+    gst_hyprland_frame_src_push_buffer(GST_HYPRLAND_FRAME_SRC(frame_src_), buffer_ref, boxes.data(), (int)boxes.size(),
+                                       capture_ns ? capture_ns : GST_CLOCK_TIME_NONE);
 
-    if (!dmabuf_memory) {
-        Debug::log(ERR, "WolfStreamingEngine: Failed to wrap DMA-BUF fd {} in GstMemory", dmabuf_fd);
-        gst_object_unref(dmabuf_allocator);
-        if (buffer_ref) {
-            wlr_buffer_unlock(buffer_ref); // Release on error
-        }
-        return;
+    // The lock the renderer handed over keeps the buffer around for repeatLastFrame()
+    std::lock_guard<std::mutex> lock(last_frame_mutex_);
+    if (last_frame_) {
+        wlr_buffer_unlock(last_frame_);
     }
+    last_frame_ = buffer_ref;
+}
 
-    // Create GStreamer buffer using the DMA-BUF memory
-    GstBuffer* buffer = gst_buffer_new();
-    gst_buffer_append_memory(buffer, dmabuf_memory);
-
-    // Add video metadata for proper format handling
-    gst_buffer_add_video_meta(buffer, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_FORMAT_BGRx, width, height);
-
-    // Attach buffer reference for cleanup when GStreamer finishes processing
-    if (buffer_ref) {
-        gst_mini_object_set_qdata(GST_MINI_OBJECT(buffer),
-                                 g_quark_from_static_string("wlr_buffer_ref"),
-                                 buffer_ref,
-                                 (GDestroyNotify)wlr_buffer_unlock);
+void StreamingEngine::repeatLastFrame() {
+    if (!running_ || !frame_src_) {
+        return;
     }
 
-    // Push zero-copy buffer to app source
-    GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(app_src_), buffer);
-    if (ret != GST_FLOW_OK) {
-        Debug::log(WARN, "WolfStreamingEngine: Failed to push DMA-BUF buffer: {}", (int)ret);
-        // Buffer cleanup will happen automatically via qdata destructor
-    } else {
-        Debug::log(LOG, "WolfStreamingEngine: Successfully pushed zero-copy DMA-BUF frame");
+    std::lock_guard<std::mutex> lock(last_frame_mutex_);
+    if (!last_frame_) {
+        return;
     }
 
-    gst_object_unref(dmabuf_allocator);
-    // Note: wlr_buffer will be unlocked automatically when GStreamer finishes with the buffer
+    // Nothing was rendered, so there's no vblank to refer to: the repeat is captured now. No damage either, so the
+    // encoder doesn't boost those areas again and turns the identical content into an all-skip frame
+    gst_hyprland_frame_src_push_buffer(GST_HYPRLAND_FRAME_SRC(frame_src_), last_frame_, nullptr, 0, monotonic_now_ns());
+}
+
+void StreamingEngine::releaseLastFrame() {
+    std::lock_guard<std::mutex> lock(last_frame_mutex_);
+    // The encoder may still hold its own lock, the wlr_buffer is released once that one goes too
+    if (last_frame_) {
+        wlr_buffer_unlock(last_frame_);
+        last_frame_ = nullptr;
+    }
 }
 
 bool StreamingEngine::startStreaming(const std::string& session_id) {
@@ -275,6 +262,9 @@ bool StreamingEngine::isStreaming(const std::string& session_id) const {
 }
 
 bool StreamingEngine::setupGStreamerPipeline() {
+    // Statically linked, like Wolf's own elements (see streaming::init())
+    gst_hyprland_frame_src_plugin_init(nullptr);
+
     std::string pipeline_desc = buildPipelineDescription();
     Debug::log(LOG, "WolfStreamingEngine: Creating pipeline: {}", pipeline_desc);
     
@@ -288,30 +278,28 @@ bool StreamingEngine::setupGStreamerPipeline() {
     }
     
     // Get references to key elements
-    app_src_ = gst_bin_get_by_name(GST_BIN(pipeline_), "hyprland_src");
-    if (!app_src_) {
-        Debug::log(ERR, "WolfStreamingEngine: Failed to get app source element");
+    frame_src_ = gst_bin_get_by_name(GST_BIN(pipeline_), "hyprland_src");
+    if (!frame_src_) {
+        Debug::log(ERR, "WolfStreamingEngine: Failed to get frame source element");
         return false;
     }
     
-    // Configure app source
-    g_object_set(app_src_,
-        "caps", gst_caps_from_string("video/x-raw,format=BGRA,width=2360,height=1640,framerate=120/1"),
-        "format", GST_FORMAT_TIME,
-        "is-live", TRUE,
-        nullptr);
-    
     return true;
 }
 
 void StreamingEngine::cleanupGStreamerPipeline() {
+    releaseLastFrame();
+
     if (pipeline_) {
         gst_element_set_state(pipeline_, GST_STATE_NULL);
         gst_object_unref(pipeline_);
         pipeline_ = nullptr;
     }
     
-    app_src_ = nullptr;
+    if (frame_src_) {
+        gst_object_unref(frame_src_);
+        frame_src_ = nullptr;
+    }
     encoder_ = nullptr;
     payloader_ = nullptr;
     sink_ = nullptr;
@@ -360,21 +348,13 @@ void StreamingEngine::gstreamerThreadMain() {
 }
 
 std::string StreamingEngine::buildPipelineDescription() const {
-    const auto& config = state_->getConfig();
-    
-    // Build a simple pipeline for now
+    // Publish the desktop once for every session: the default video source (`interpipesrc listen-to=hyprland_video`)
+    // is the same for all of them, so sessions in the same mode end up sharing one encoder (see streaming/shared_encoder.hpp)
+    // hyprlandframesrc hands the renderer's DMA-BUFs over as they are, through a mailbox the compositor never waits on
     std::stringstream ss;
-    ss << "appsrc name=hyprland_src ! ";
-    ss << "videoconvert ! ";
-    
-    // Use software encoding (nvh264enc causes server hanging)
-    // x264enc provides reliable encoding for streaming
-    ss << "x264enc bitrate=" << config.video.bitrate << " ! ";
-    
-    ss << "h264parse ! ";
-    ss << "rtph264pay ! ";
-    ss << "udpsink host=127.0.0.1 port=" << config.video_port;
-    
+    ss << "hyprlandframesrc name=hyprland_src width=2360 height=1640 framerate=120/1 format=BGRx ! ";
+    ss << "interpipesink name=hyprland_video sync=false async=false max-buffers=1";
+
     return ss.str();
 }
 
@@ -927,9 +907,21 @@ void WolfMoonlightServer::onFrameReady(const void* frame_data, size_t size, int
     }
 }
 
-void WolfMoonlightServer::onFrameReadyDMABuf(int dmabuf_fd, uint32_t stride, uint64_t modifier, int width, int height, uint32_t format, wlr_buffer* buffer_ref) {
+void WolfMoonlightServer::onFrameReadyDMABuf(wlr_buffer* buffer_ref, const std::vector<DamageRect>& damage, uint64_t capture_ns) {
     if (streaming_engine_) {
-        streaming_engine_->pushFrameDMABuf(dmabuf_fd, stride, modifier, width, height, format, buffer_ref);
+        streaming_engine_->pushFrameDMABuf(buffer_ref, damage, capture_ns);
+    }
+}
+
+void WolfMoonlightServer::repeatLastFrame() {
+    if (streaming_engine_) {
+        streaming_engine_->repeatLastFrame();
+    }
+}
+
+void WolfMoonlightServer::releaseLastFrame() {
+    if (streaming_engine_) {
+        streaming_engine_->releaseLastFrame();
     }
 }
 
@@ -1048,6 +1040,9 @@ void WolfMoonlightServer::initializeWolfAppState() {
     config.apps = std::make_shared<immer::atom<immer::vector<immer::box<events::App>>>>(apps);
     logs::log(logs::warning, "WolfMoonlightServer: Initialized Config with Hyprland desktop app");
 
+    // Get spare pipelines ready for the desktop sessions, they will claim them instead of building their own
+    streaming::prewarm_video_pipelines(streaming::HYPRLAND_VIDEO_PIPELINE);
+
     app_state->config = immer::box<state::Config>(config);
 
     // Initialize host information with proper certificate paths
@@ -1412,7 +1407,7 @@ void WolfMoonlightServer::startStreamingForSession(const std::string& session_id
     }
 
     // CRITICAL: This call tells Wolf's StreamingEngine about the active session
-    // This sets running_ = true and initializes app_src_ so pushFrame() won't drop frames
+    // This sets running_ = true and initializes frame_src_ so pushFrame() won't drop frames
     if (streaming_engine_->startStreaming(session_id)) {
         Debug::log(WARN, "WolfMoonlightServer: StreamingEngine activated for session {} - frames will now be processed", session_id);
         current_session_id_ = session_id;
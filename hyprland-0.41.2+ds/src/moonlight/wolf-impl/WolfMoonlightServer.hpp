@@ -76,6 +76,14 @@ struct StreamSession {
     std::chrono::system_clock::time_point start_time;
 };
 
+// Region of a frame that changed since the previous one, in buffer pixels
+struct DamageRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
 // Frame callback for Hyprland integration
 using FrameCallback = std::function<void(const void* frame_data, size_t size, int width, int height, uint32_t format)>;
 
@@ -118,7 +126,10 @@ public:
     
     // Frame input from Hyprland
     void pushFrame(const void* frame_data, size_t size, int width, int height, uint32_t format);
-    void pushFrameDMABuf(int dmabuf_fd, uint32_t stride, uint64_t modifier, int width, int height, uint32_t format, wlr_buffer* buffer_ref);
+    // Takes over the renderer's lock on buffer_ref. capture_ns: CLOCK_MONOTONIC vblank the frame was rendered for, 0 when unknown
+    void pushFrameDMABuf(wlr_buffer* buffer_ref, const std::vector<DamageRect>& damage = {}, uint64_t capture_ns = 0);
+    void repeatLastFrame();
+    void releaseLastFrame();
     
     // Session control
     bool startStreaming(const std::string& session_id);
@@ -130,10 +141,14 @@ private:
     
     // GStreamer pipeline components
     GstElement* pipeline_;
-    GstElement* app_src_;
+    GstElement* frame_src_; // hyprlandframesrc
     GstElement* encoder_;
     GstElement* payloader_;
     GstElement* sink_;
+
+    // Last frame pushed, locked until replaced or released. Re-sent as keep-alive while the desktop is idle
+    wlr_buffer* last_frame_ = nullptr;
+    std::mutex last_frame_mutex_;
     
     // Threading
     std::thread gst_thread_;
@@ -234,7 +249,9 @@ public:
     
     // Frame input from Hyprland renderer
     void onFrameReady(const void* frame_data, size_t size, int width, int height, uint32_t format);
-    void onFrameReadyDMABuf(int dmabuf_fd, uint32_t stride, uint64_t modifier, int width, int height, uint32_t format, wlr_buffer* buffer_ref);
+    void onFrameReadyDMABuf(wlr_buffer* buffer_ref, const std::vector<DamageRect>& damage = {}, uint64_t capture_ns = 0);
+    void repeatLastFrame();
+    void releaseLastFrame();
     
     // Configuration
     void updateConfig(const MoonlightConfig& config);
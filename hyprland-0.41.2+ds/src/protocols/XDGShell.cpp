@@ -373,7 +373,7 @@ CXDGSurfaceResource::CXDGSurfaceResource(SP<CXdgSurface> resource_, SP<CXDGWMBas
 
         LOGM(LOG, "xdg_surface {:x} gets a toplevel {:x}", (uintptr_t)owner.get(), (uintptr_t)RESOURCE.get());
 
-        g_pCompositor->m_vWindows.emplace_back(CWindow::create(self.lock()));
+        g_pCompositor->addWindow(CWindow::create(self.lock()));
 
         for (auto& p : popups) {
             if (!p)
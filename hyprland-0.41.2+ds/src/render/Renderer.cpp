@@ -1733,6 +1733,8 @@ void CHyprRenderer::damageSurface(SP<CWLSurfaceResource> pSurface, double x, dou
 }
 
 void CHyprRenderer::damageWindow(PHLWINDOW pWindow, bool forceFull) {
+    g_pCompositor->m_windowHitIndex.invalidate(pWindow);
+
     if (g_pCompositor->m_bUnsafeState)
         return;
 
@@ -2624,6 +2626,9 @@ bool CHyprRenderer::beginRender(CMonitor* pMonitor, CRegion& damage, eRenderMode
             return false;
         }
 
+        if (g_pMoonlightManager)
+            g_pMoonlightManager->onRenderBegin(pMonitor);
+
         m_pCurrentWlrBuffer = wlr_swapchain_acquire(pMonitor->output->swapchain, &bufferAge);
         if (!m_pCurrentWlrBuffer) {
             Debug::log(ERR, "Failed to acquire swapchain buffer for {}", pMonitor->szName);
@@ -2644,9 +2649,15 @@ bool CHyprRenderer::beginRender(CMonitor* pMonitor, CRegion& damage, eRenderMode
     }
 
     if (mode == RENDER_MODE_NORMAL) {
-        damage = pMonitor->damage.getBufferDamage(bufferAge);
+        damage                = pMonitor->damage.getBufferDamage(bufferAge);
+        m_rCurrentFrameDamage = pMonitor->damage.getBufferDamage(1);
         pMonitor->damage.rotate();
-    }
+
+        // the ring is in monitor space, encoders get the buffer, which is rotated / flipped by the output transform
+        wlr_region_transform(m_rCurrentFrameDamage.pixman(), m_rCurrentFrameDamage.pixman(), wlr_output_transform_invert(pMonitor->transform),
+                             (int)pMonitor->vecTransformedSize.x, (int)pMonitor->vecTransformedSize.y);
+    } else
+        m_rCurrentFrameDamage = CBox{{}, pMonitor->vecPixelSize};
 
     m_pCurrentRenderbuffer->bind();
     if (simple)
@@ -2692,7 +2703,7 @@ void CHyprRenderer::endRender() {
     }
 
     if (g_pMoonlightManager && m_pCurrentWlrBuffer) {
-        moonlight_took_buffer = g_pMoonlightManager->onFrameReady(PMONITOR, m_pCurrentWlrBuffer);
+        moonlight_took_buffer = g_pMoonlightManager->onFrameReady(PMONITOR, m_pCurrentWlrBuffer, m_rCurrentFrameDamage);
         if (render_count % 60 == 0) {
             Debug::log(ERR, "[RENDER DEBUG] onFrameReady() called, took_buffer={}", moonlight_took_buffer);
         }
@@ -2703,14 +2714,8 @@ void CHyprRenderer::endRender() {
         wlr_buffer_unlock(m_pCurrentWlrBuffer);
     }
 
-    // CRITICAL: Force continuous rendering when streaming is active
-    if (g_pMoonlightManager && g_pMoonlightManager->isStreaming()) {
-        if (render_count % 120 == 0) { // Log every 120 renders (once every 2 seconds at 60fps)
-            Debug::log(ERR, "[STREAMING DEBUG] Forcing continuous render for moonlight streaming (frame #{})", render_count);
-        }
-        // Schedule next frame immediately to maintain continuous streaming
-        wlr_output_schedule_frame(PMONITOR->output);
-    }
+    // No forced frame scheduling while streaming: renderMonitor() only gets here when the monitor
+    // has damage, and CMoonlightManager's keep-alive timer covers idle periods.
 
     m_pCurrentRenderbuffer->unbind();
 
@@ -124,6 +124,7 @@ class CHyprRenderer {
     CRenderbuffer* m_pCurrentRenderbuffer = nullptr;
     wlr_buffer*    m_pCurrentWlrBuffer    = nullptr;
     WP<IWLBuffer>  m_pCurrentHLBuffer     = {};
+    CRegion        m_rCurrentFrameDamage; // what changed since the previous frame in buffer coordinates, for stream encoders
     eRenderMode    m_eRenderMode          = RENDER_MODE_NORMAL;
 
     bool           m_bNvidia = false;
@@ -59,6 +59,9 @@ Vector2D CDecorationPositioner::getEdgeDefinedPoint(uint32_t edges, PHLWINDOW pW
 void CDecorationPositioner::uncacheDecoration(IHyprWindowDecoration* deco) {
     std::erase_if(m_vWindowPositioningDatas, [&](const auto& data) { return !data->pWindow.lock() || data->pDecoration == deco; });
 
+    if (const auto PWINDOW = deco->m_pWindow.lock())
+        g_pCompositor->m_windowHitIndex.invalidate(PWINDOW);
+
     const auto WIT = std::find_if(m_mWindowDatas.begin(), m_mWindowDatas.end(), [&](const auto& other) { return other.first.lock() == deco->m_pWindow.lock(); });
     if (WIT == m_mWindowDatas.end())
         return;
@@ -141,6 +144,8 @@ void CDecorationPositioner::onWindowUpdate(PHLWINDOW pWindow) {
     WINDOWDATA->needsRecalc    = false;
     const bool EPHEMERAL       = pWindow->m_vRealSize.isBeingAnimated();
 
+    g_pCompositor->m_windowHitIndex.invalidate(pWindow);
+
     std::sort(datas.begin(), datas.end(), [](const auto& a, const auto& b) { return a->positioningInfo.priority > b->positioningInfo.priority; });
 
     CBox wb = pWindow->getWindowMainSurfaceBox();
@@ -280,10 +285,12 @@ void CDecorationPositioner::onWindowUpdate(PHLWINDOW pWindow) {
 void CDecorationPositioner::onWindowUnmap(PHLWINDOW pWindow) {
     std::erase_if(m_vWindowPositioningDatas, [&](const auto& data) { return data->pWindow.lock() == pWindow; });
     m_mWindowDatas.erase(pWindow);
+    g_pCompositor->m_windowHitIndex.invalidate(pWindow);
 }
 
 void CDecorationPositioner::onWindowMap(PHLWINDOW pWindow) {
     m_mWindowDatas[pWindow] = {};
+    g_pCompositor->m_windowHitIndex.invalidate(pWindow);
 }
 
 SBoxExtents CDecorationPositioner::getWindowDecorationReserved(PHLWINDOW pWindow) {
@@ -41,7 +41,7 @@ void CXWM::handleCreate(xcb_create_notify_event_t* e) {
     Debug::log(LOG, "[xwm] New XSurface at {:x} with xid of {}", (uintptr_t)XSURF.get(), e->window);
 
     const auto WINDOW = CWindow::create(XSURF);
-    g_pCompositor->m_vWindows.emplace_back(WINDOW);
+    g_pCompositor->addWindow(WINDOW);
     WINDOW->m_pSelf = WINDOW;
     Debug::log(LOG, "[xwm] New XWayland window at {:x} for surf {:x}", (uintptr_t)WINDOW.get(), (uintptr_t)XSURF.get());
 }